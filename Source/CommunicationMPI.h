@@ -24,6 +24,6 @@
 
 namespace Beagle {
 namespace MPI {
-	enum MPI_TAGS { eEvolutionEnd=0, eIndividual, eFitness, eMessageSize, eNbIndividual };
+	enum MPI_TAGS { eEvolutionEnd=0, eIndividual, eFitness, eMessageSize, eNbIndividual, eBlock, eFitnessBlock, eSharedIndividual, eSharedFitness, ePullRound, eHeartbeat, eCancel, eRejectionBound };
 }
 }
@@ -0,0 +1,53 @@
+/*
+ *  GPBenchmarkTree.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ *  \file   GPBenchmarkTree.hpp
+ *  \brief  GP tree shared by the benchmarks.
+ */
+
+#ifndef GPBenchmarkTree_H
+#define GPBenchmarkTree_H
+
+#include "beagle/GP.hpp"
+
+/*!
+ *  \brief Append a full tree of given depth to the genotype, in prefix order.
+ *
+ *  The functions cycle through ADD, SUB, MUL and DIV, the terminals alternate
+ *  between X and an ephemeral constant.
+ */
+inline void buildTree(Beagle::GP::Tree& ioTree, Beagle::GP::PrimitiveSet& inSet, Beagle::GP::Context& ioContext,
+					  unsigned int inDepth)
+{
+	static const char* lFunctions[] = { "ADD", "SUB", "MUL", "DIV" };
+	const unsigned int lIndex = ioTree.size();
+	if(inDepth <= 1) {
+		Beagle::GP::Primitive::Handle lTerminal = inSet.getPrimitiveByName(((lIndex % 2) == 0) ? "X" : "E");
+		ioTree.push_back(Beagle::GP::Node(lTerminal->giveReference(0, ioContext), 1));
+		return;
+	}
+	ioTree.push_back(Beagle::GP::Node(inSet.getPrimitiveByName(lFunctions[lIndex % 4]), 0));
+	buildTree(ioTree, inSet, ioContext, inDepth-1);
+	buildTree(ioTree, inSet, ioContext, inDepth-1);
+	ioTree[lIndex].mSubTreeSize = ioTree.size() - lIndex;
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+ *  GPInterpreterBenchmark.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ *  \file   GPInterpreterBenchmark.cpp
+ *  \brief  Compare the case by case and the vector interpretation of a GP tree.
+ *
+ *  A GP individual of the given depth is evaluated as in the symbreg example,
+ *  the squared error against \f$x^4 + x^3 + x^2 + x + 1\f$ being summed over
+ *  the fitness cases, once with Beagle::GP::Individual::run for each fitness
+ *  case and once with MPI::GP::VectorInterpreter over all of them. Both
+ *  results must agree. The tree is then compiled by MPI::GP::NativeCompiler
+ *  with the default ec.mpi.gp.native.cmd, whose results must be identical to
+ *  those of the vector interpreter for every fitness case.
+ *  Usage: GPInterpreterBenchmark [depth] [cases] [repetitions]
+ */
+
+#include "beagle/GP.hpp"
+#include "GPBenchmarkTree.hpp"
+#include "MPI_GP_NativeCompiler.hpp"
+#include "MPI_GP_VectorInterpreter.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <Util/Timer.hpp>
+
+using namespace std;
+using namespace Beagle;
+
+int main(int argc, char *argv[]) {
+	try {
+		const unsigned int lDepth = (argc > 1) ? std::atoi(argv[1]) : 8;
+		const unsigned int lNbCases = (argc > 2) ? std::atoi(argv[2]) : 10000;
+		const unsigned int lRepetitions = (argc > 3) ? std::atoi(argv[3]) : 10;
+
+		GP::PrimitiveSet::Handle lSet = new GP::PrimitiveSet;
+		lSet->insert(new GP::Add);
+		lSet->insert(new GP::Subtract);
+		lSet->insert(new GP::Multiply);
+		lSet->insert(new GP::Divide);
+		lSet->insert(new GP::TokenT<Double>("X"));
+		lSet->insert(new GP::EphemeralDouble);
+		GP::System::Handle lSystem = new GP::System(lSet);
+		int lArgc = 1;
+		lSystem->initialize(lArgc, argv);
+		lSystem->postInit();
+
+		GP::Context::Handle lContext = new GP::Context;
+		lContext->setSystemHandle(lSystem);
+
+		GP::Individual::Handle lIndividual = new GP::Individual(new GP::Tree::Alloc, new FitnessSimple::Alloc, 1);
+		buildTree(*(*lIndividual)[0], *lSet, *lContext, lDepth);
+
+		//Fitness cases of the symbreg example, spread over [-1,1]
+		std::vector<double> lX(lNbCases);
+		std::vector<double> lY(lNbCases);
+		for(unsigned int i = 0; i < lNbCases; ++i) {
+			lX[i] = (lNbCases > 1) ? (-1.0 + 2.0*i/(lNbCases-1)) : 0.0;
+			lY[i] = lX[i]*(lX[i]*(lX[i]*(lX[i]+1.0)+1.0)+1.0);
+		}
+
+		cout << "Individual of " << (*lIndividual)[0]->size() << " nodes, " << lNbCases;
+		cout << " fitness cases, " << lRepetitions << " repetitions" << endl;
+
+		//Case by case interpretation
+		GP::Primitive::Handle lToken = lSet->getPrimitiveByName("X");
+		double lCaseError = 0.0;
+		PACC::Timer lTimer;
+		for(unsigned int r = 0; r < lRepetitions; ++r) {
+			lCaseError = 0.0;
+			for(unsigned int i = 0; i < lNbCases; ++i) {
+				lToken->setValue(Double(lX[i]));
+				Double lResult;
+				lIndividual->run(lResult, *lContext);
+				const double lError = lY[i]-lResult;
+				lCaseError += lError*lError;
+			}
+		}
+		const double lCaseTime = lTimer.getValue();
+
+		//Vector interpretation
+		MPI::GP::VectorInterpreter lInterpreter;
+		lInterpreter.setInput("X", lX);
+		std::vector<double> lResults;
+		double lVectorError = 0.0;
+		lTimer.reset();
+		for(unsigned int r = 0; r < lRepetitions; ++r) {
+			lVectorError = 0.0;
+			if(!lInterpreter.run(*(*lIndividual)[0], lResults)) {
+				cerr << "The tree is not supported by the vector interpreter!" << endl;
+				return 1;
+			}
+			for(unsigned int i = 0; i < lNbCases; ++i) {
+				const double lError = lY[i]-lResults[i];
+				lVectorError += lError*lError;
+			}
+		}
+		const double lVectorTime = lTimer.getValue();
+
+		cout << "Case by case interpretation: " << (lCaseTime/lRepetitions)*1000. << " ms per individual" << endl;
+		cout << "Vector interpretation:       " << (lVectorTime/lRepetitions)*1000. << " ms per individual" << endl;
+		if(lVectorTime > 0.) cout << "Speedup: " << lCaseTime/lVectorTime << endl;
+
+		if(std::fabs(lCaseError-lVectorError) > 1e-9*(1.0+std::fabs(lCaseError))) {
+			cerr << "Squared errors differ: " << lCaseError << " and " << lVectorError << endl;
+			return 1;
+		}
+		cout << "Squared errors are identical: " << lCaseError << endl;
+
+		//Native code, which must round as the vector interpreter
+		const MPI::GP::Bytecode* lProgram = lInterpreter.compile(*(*lIndividual)[0]);
+		std::vector<MPI::GP::Bytecode> lPrograms(1, *lProgram);
+		MPI::GP::NativeCompiler lCompiler;
+		std::vector<MPI::GP::NativeCompiler::Function> lFunctions;
+		std::string lError;
+		if(!lCompiler.compile(lPrograms, "c++ -O2 -ffp-contract=off -shared -fPIC", lFunctions, lError)) {
+			cerr << "Native compilation failed, the native code is not checked: " << lError << endl;
+			return 0;
+		}
+		std::vector<const double*> lInputs;
+		lInterpreter.getInputs(lInputs);
+		const std::vector<double>& lConstants = lPrograms[0].getConstants();
+		std::vector<double> lNativeResults(lNbCases);
+		lTimer.reset();
+		for(unsigned int r = 0; r < lRepetitions; ++r) {
+			lFunctions[0](&lInputs[0], lConstants.empty() ? NULL : &lConstants[0], lNbCases, &lNativeResults[0]);
+		}
+		const double lNativeTime = lTimer.getValue();
+		cout << "Native code:                 " << (lNativeTime/lRepetitions)*1000. << " ms per individual" << endl;
+		for(unsigned int i = 0; i < lNbCases; ++i) {
+			if(lNativeResults[i] != lResults[i]) {
+				cerr << "Native code and vector interpreter differ on the " << (i+1) << "th fitness case: ";
+				cerr << lNativeResults[i] << " and " << lResults[i] << endl;
+				return 1;
+			}
+		}
+		cout << "Native code results are identical to the vector interpreter" << endl;
+	}
+	catch(Exception& inException) {
+		inException.terminate();
+	}
+	catch(exception& inException) {
+		cerr << "Standard exception catched:" << endl;
+		cerr << inException.what() << endl << flush;
+		return 1;
+	}
+	catch(...) {
+		cerr << "Unknown exception catched!" << endl << flush;
+		return 1;
+	}
+	return 0;
+}
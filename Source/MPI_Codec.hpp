@@ -0,0 +1,132 @@
+/*
+ *  MPI_Codec.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_Codec_H
+#define MPI_Codec_H
+
+#include <string>
+#include <cstring>
+
+#include "beagle/config.hpp"
+#include "beagle/macros.hpp"
+#include "beagle/Object.hpp"
+#include "beagle/PointerT.hpp"
+#include "beagle/Container.hpp"
+#include "beagle/ContainerT.hpp"
+#include "beagle/Individual.hpp"
+#include "beagle/Context.hpp"
+#include "beagle/System.hpp"
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class Codec MPI_Codec.hpp "MPI_Codec.hpp"
+ *  \brief Abstract wire format of the individuals sent to the evaluators.
+ *
+ *  The codecs of an evaluation operator are kept in a bag, and the index of a
+ *  codec in that bag is written as the first byte of each message. Binary
+ *  codecs assume that all the processes share the same byte order and type sizes.
+ */
+class Codec : public Object {
+public:
+	//! Codec handle type.
+	typedef PointerT<Codec,Object::Handle>
+	Handle;
+	//! Codec bag type.
+	typedef ContainerT<Codec,Container>
+	Bag;
+
+	explicit Codec(std::string inName) : mName(inName) { }
+	virtual ~Codec() { }
+
+	/*!
+	 *  \brief Append the encoding of an individual to a message.
+	 *  \param inIndividual Individual to encode.
+	 *  \param inPeer Rank of the receiving process.
+	 *  \param ioContext Evolutionary context.
+	 *  \param ioMessage Message to append to.
+	 *  \return False if the individual cannot be represented by this codec. The message is then left unchanged.
+	 */
+	virtual bool encodeIndividual(const Individual& inIndividual, int inPeer, Context& ioContext, std::string& ioMessage) = 0;
+
+	/*!
+	 *  \brief Decode an individual encoded by this codec.
+	 *  \param inBuffer Encoded individual.
+	 *  \param inSize Size of the encoded individual.
+	 *  \param inPeer Rank of the sending process.
+	 *  \param ioIndividual Individual to fill.
+	 *  \param ioContext Evolutionary context.
+	 */
+	virtual void decodeIndividual(const char* inBuffer, unsigned int inSize, int inPeer, Individual& ioIndividual, Context& ioContext) = 0;
+
+	/*!
+	 *  \brief Initialize the codec, registering its parameters.
+	 *  \param ioSystem System of the evolution.
+	 */
+	virtual void initialize(System& ioSystem) { }
+
+	/*!
+	 *  \brief Append to the compression dictionary strings frequent in the messages.
+	 *  \param ioContext Evolutionary context.
+	 *  \param ioDictionary Dictionary to append to, the same on every process.
+	 */
+	virtual void appendDictionary(Context& ioContext, std::string& ioDictionary) { }
+
+	/*!
+	 *  \brief Return how many bytes this codec would save by sending an individual to a given process.
+	 *  \param inIndividual Individual to send.
+	 *  \param inPeer Rank of the receiving process.
+	 *  \return Bytes saved compared to another process, 0 when the receiver does not matter.
+	 *
+	 *  Used to route the individuals to the evaluators holding state about them.
+	 */
+	virtual unsigned int getPeerAffinity(const Individual& inIndividual, int inPeer) { return 0; }
+
+	//! Return true if the encoding depends on the receiving process, preventing the forwarding of the messages.
+	virtual bool isPeerSpecific() const { return false; }
+
+	//! Return the name of the codec, as used by parameter ec.mpi.codec.
+	virtual const std::string& getName() const { return mName; }
+
+protected:
+	//! Append the raw bytes of a value to a message.
+	template <class T>
+	static void appendValue(std::string& ioMessage, const T& inValue) {
+		ioMessage.append(reinterpret_cast<const char*>(&inValue), sizeof(T));
+	}
+
+	//! Read a raw value at the cursor position and move the cursor past it.
+	template <class T>
+	static T readValue(const char*& ioCursor, const char* inEnd) {
+		if(ioCursor+sizeof(T) > inEnd) throw Beagle_IOExceptionMessageM("truncated message");
+		T lValue;
+		std::memcpy(&lValue, ioCursor, sizeof(T));
+		ioCursor += sizeof(T);
+		return lValue;
+	}
+
+	std::string mName;  //!< Name of the codec.
+};
+
+}
+}
+
+#endif
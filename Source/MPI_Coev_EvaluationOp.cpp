@@ -34,6 +34,7 @@
 
 #include "CommunicationMPI.h"
 #include "VectorUtil.h"
+#include "MPI_XMLStreamDecoder.hpp"
 
 using namespace Beagle;
 
@@ -277,6 +278,7 @@ void Beagle::MPI::Coev::EvaluationOp::initialize(System& ioSystem)
 										   );
 		ioSystem.getRegister().addEntry("ec.hof.demesize", mDemeHOFSize, lDescription);
 	}
+	mCompressor->initialize(ioSystem);
 }
 
 
@@ -476,6 +478,7 @@ void Beagle::MPI::Coev::EvaluationOp::distributeIndividuals(vector<Individual::B
 		std::ostringstream lStreamOut;
 		
 		PACC::XML::Streamer lXMLStream(lStreamOut);
+		XMLStreamDecoder lDecoder;
 		
 		//char lSizeMessage[256];
 		int lMessageSize;
@@ -519,9 +522,8 @@ void Beagle::MPI::Coev::EvaluationOp::distributeIndividuals(vector<Individual::B
 						inIndividuals[lCurrentIndGroup][i]->getFitness()->setInvalid();
 						lStreamOut.str("");
 						inIndividuals[lCurrentIndGroup][i]->write(lXMLStream);
-						lMessageSize = lStreamOut.str().size()+1;
-						MPI_Send(&lMessageSize, 1, MPI_INT, lProcessIdx, eMessageSize, MPI_COMM_WORLD);
-						MPI_Send(const_cast<char*>(lStreamOut.str().data()), lMessageSize, MPI_CHAR, lProcessIdx, eIndividual, MPI_COMM_WORLD);
+						const std::string lIndividualMessage = lStreamOut.str();
+						sendMessage(lIndividualMessage.c_str(), lIndividualMessage.size()+1, lProcessIdx, eIndividual);
 					}
 					unsigned int lGeneration = ioContext.getGeneration();
 					MPI_Send(&lGeneration, 1, MPI_INT, lProcessIdx, eIndividual, MPI_COMM_WORLD);
@@ -541,8 +543,8 @@ void Beagle::MPI::Coev::EvaluationOp::distributeIndividuals(vector<Individual::B
 				//Receive the evaluated fitness
 				lSource = lStatus.MPI_SOURCE;
 				MPI_Recv(&lMessageSize, 1, MPI_INT, lSource, eMessageSize, MPI_COMM_WORLD, &lStatus);
-				char *lMessage = new char[lMessageSize];
-				MPI_Recv(lMessage, lMessageSize, MPI_CHAR, lSource, eFitness, MPI_COMM_WORLD, &lStatus);
+				unsigned int lFitnessSize;
+				const char* lMessage = receiveMessage(lSource, eFitness, lMessageSize, lFitnessSize);
 				lRecvIndividualIdx = lProcess[lSource];
 				lProcess[lSource] = -1;
 				++lNbReceived;
@@ -555,18 +557,8 @@ void Beagle::MPI::Coev::EvaluationOp::distributeIndividuals(vector<Individual::B
 								 );
 				
 				//Read the received fitness
-				std::istringstream lStreamIn(lMessage);
-				PACC::XML::Document lXMLParser;
-				
-				lXMLParser.parse(lStreamIn);
-				
 				Fitness::Handle lFitness = castHandleT<Fitness>(inIndividuals[lRecvIndividualIdx][0]->getFitnessAlloc()->allocate());
-				PACC::XML::ConstIterator lFitnessRootNode = lXMLParser.getFirstRoot(); 
-				
-				lFitness->read(lFitnessRootNode);
-				
-				//Free message space
-				delete [] lMessage;
+				lDecoder.readFitness(lMessage, lFitnessSize, *lFitness);
 				
 				//Assign the fitness
 				if(inAssignmentVector[lRecvIndividualIdx] == 0) {
@@ -25,7 +25,10 @@
 #include <beagle/System.hpp>
 #include <beagle/Context.hpp>
 #include <mpi.h>
+#include <algorithm>
 #include "CommunicationMPI.h"
+#include "MPI_XMLStreamDecoder.hpp"
+#include "MPI_Compressor.hpp"
 
 #include "beagle/FitnessSimple.hpp"
 
@@ -54,6 +57,10 @@ void Beagle::MPI::Coev::FitnessEvaluationClient::operate(Allocator::Handle inCon
 		int lNbIndividuals = 0;
 		MPI_Status lStatus;
 		int lSource;
+		XMLStreamDecoder lDecoder;
+		Compressor lCompressor;
+		std::vector<char> lFrame;
+		std::string lFrameOut;
 		
 		bool lDone = false;
 		while(!lDone) {
@@ -71,22 +78,15 @@ void Beagle::MPI::Coev::FitnessEvaluationClient::operate(Allocator::Handle inCon
 				Individual::Bag lIndividuals;
 				for(unsigned int i = 0; i < lNbIndividuals; ++i) {
 					MPI_Recv(&lMessageSize, 1, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
-					char *lMessage = new char[lMessageSize];
-					MPI_Recv(lMessage, lMessageSize, MPI_CHAR, lSource, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
-					
-					//Parse the received individual
-					std::istringstream lStreamIn(lMessage);
-					PACC::XML::Document lXMLParser;
-					lXMLParser.parse(lStreamIn);
-					PACC::XML::ConstIterator lIndividualRootNode = lXMLParser.getFirstRoot(); 
+					lFrame.resize(std::max(lMessageSize, 1));
+					MPI_Recv(&lFrame[0], lMessageSize, MPI_CHAR, lSource, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
+					unsigned int lIndividualSize;
+					const char* lMessage = lCompressor.unpack(&lFrame[0], lMessageSize, lIndividualSize);
 					
 					//Read the received individual
 					lEvolContext->getDeme().resize(0);
 					Individual::Handle lIndividual = new Individual(inGenotypeAlloc[i]);
-					lIndividual->readWithContext(lIndividualRootNode,*lEvolContext);
-					
-					//Free message std::string
-					delete [] lMessage;
+					lDecoder.readIndividual(lMessage, lIndividualSize, *lIndividual, *lEvolContext);
 					
 					lIndividuals.push_back(lIndividual);
 				}
@@ -110,7 +110,9 @@ void Beagle::MPI::Coev::FitnessEvaluationClient::operate(Allocator::Handle inCon
 				
 				lFitness->write(lXMLStream);
 				//std::cout << "Sending fitness of size " << lStreamOut.str().size()+1 << ":" << std::endl << lStreamOut.str() << std::endl;
-				lMessageSize = lStreamOut.str().size()+1;
+				const std::string lFitnessMessage = lStreamOut.str();
+				lCompressor.pack(lFitnessMessage.c_str(), lFitnessMessage.size()+1, lFrameOut);
+				lMessageSize = lFrameOut.size();
 				
 				FitnessSimple::Handle lLogFitness = castHandleT<FitnessSimple>(lFitness);
 				
@@ -121,7 +123,7 @@ void Beagle::MPI::Coev::FitnessEvaluationClient::operate(Allocator::Handle inCon
 								 );
 				
 				MPI_Send(&lMessageSize, 1, MPI_INT, lSource, eMessageSize, MPI_COMM_WORLD);
-				MPI_Send(const_cast<char*>(lStreamOut.str().data()), lMessageSize, MPI_CHAR, lSource, eFitness, MPI_COMM_WORLD);
+				MPI_Send(const_cast<char*>(lFrameOut.data()), lMessageSize, MPI_CHAR, lSource, eFitness, MPI_COMM_WORLD);
 			}
 		}
 	} catch(Exception& inException) {
@@ -0,0 +1,272 @@
+/*
+ *  MPI_Compressor.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/Beagle.hpp"
+#include "MPI_Compressor.hpp"
+
+#include <mpi.h>
+#include <cstring>
+
+using namespace Beagle;
+
+namespace {
+	const double       gSmoothing = 0.2;          //!< Weight of a new measure in the estimates.
+	const unsigned int gProbeInterval = 32;       //!< A message out of this many is always compressed.
+	const unsigned int gMinTimedTransfer = 65536; //!< Smallest send used to measure the bandwidth.
+	const unsigned int gHeaderSize = 1 + sizeof(unsigned int);
+}
+
+/*!
+ *  \brief Construct a compressor with default estimates.
+ */
+Beagle::MPI::Compressor::Compressor() :
+mDeflateReady(false),
+mInflateReady(false),
+mBandwidth(-1.),
+mSpeed(50e6),
+mRatio(0.5),
+mNbCandidates(0)
+{ }
+
+/*!
+ *  \brief Release the zlib streams.
+ */
+Beagle::MPI::Compressor::~Compressor()
+{
+	if(mDeflateReady) deflateEnd(&mDeflateStream);
+	if(mInflateReady) inflateEnd(&mInflateStream);
+}
+
+/*!
+ *  \brief Register the parameters of the compressor.
+ *  \param ioSystem System of the evolution.
+ */
+void Beagle::MPI::Compressor::initialize(System& ioSystem)
+{
+	if(ioSystem.getRegister().isRegistered("ec.mpi.compress.mode")) {
+		mMode = castHandleT<String>(ioSystem.getRegister().getEntry("ec.mpi.compress.mode"));
+	} else {
+		mMode = new String("auto");
+		std::string lLongDescript = "Compression of the messages exchanged with the evaluators: ";
+		lLongDescript += "\"never\", \"always\" (above the threshold), or \"auto\" to compress only when ";
+		lLongDescript += "it is faster than sending the message raw on the measured link.";
+		Register::Description lDescription(
+										   "MPI messages compression",
+										   "String",
+										   "auto",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.compress.mode", mMode, lDescription);
+	}
+
+	if(ioSystem.getRegister().isRegistered("ec.mpi.compress.threshold")) {
+		mThreshold = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.compress.threshold"));
+	} else {
+		mThreshold = new UInt(4096);
+		Register::Description lDescription(
+										   "MPI compression threshold",
+										   "UInt",
+										   "4096",
+										   "Size in bytes under which the messages are never compressed."
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.compress.threshold", mThreshold, lDescription);
+	}
+
+	if(ioSystem.getRegister().isRegistered("ec.mpi.compress.level")) {
+		mLevel = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.compress.level"));
+	} else {
+		mLevel = new UInt(1);
+		Register::Description lDescription(
+										   "MPI compression level",
+										   "UInt",
+										   "1",
+										   "zlib compression level of the messages, from 1 (fastest) to 9 (best)."
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.compress.level", mLevel, lDescription);
+	}
+
+	if(ioSystem.getRegister().isRegistered("ec.mpi.compress.bandwidth")) {
+		mInitBandwidth = castHandleT<Float>(ioSystem.getRegister().getEntry("ec.mpi.compress.bandwidth"));
+	} else {
+		mInitBandwidth = new Float(100.);
+		std::string lLongDescript = "Initial estimate of the bandwidth between the processes, in MB/s. ";
+		lLongDescript += "The estimate is then updated from the time taken by large sends.";
+		Register::Description lDescription(
+										   "MPI link bandwidth",
+										   "Float",
+										   "100",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.compress.bandwidth", mInitBandwidth, lDescription);
+	}
+
+	if(ioSystem.getRegister().isRegistered("ec.mpi.compress.dict")) {
+		mUseDictionary = castHandleT<Bool>(ioSystem.getRegister().getEntry("ec.mpi.compress.dict"));
+	} else {
+		mUseDictionary = new Bool(true);
+		std::string lLongDescript = "Use a preset compression dictionary built from the codecs, ";
+		lLongDescript += "such as the XML tags and GP primitive names.";
+		Register::Description lDescription(
+										   "MPI compression dictionary",
+										   "Bool",
+										   "1",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.compress.dict", mUseDictionary, lDescription);
+	}
+}
+
+/*!
+ *  \brief Set the preset dictionary. Only its last 32 kB are kept, as zlib would.
+ */
+void Beagle::MPI::Compressor::setDictionary(const std::string& inDictionary)
+{
+	if(inDictionary.size() > 32768) mDictionary = inDictionary.substr(inDictionary.size()-32768);
+	else mDictionary = inDictionary;
+}
+
+/*!
+ *  \brief Wrap a message in a frame, deflating it if worthwhile.
+ *  \param inMessage Message to send.
+ *  \param inSize Size of the message.
+ *  \param outFrame Frame to send.
+ */
+void Beagle::MPI::Compressor::pack(const char* inMessage, unsigned int inSize, std::string& outFrame)
+{
+	if(shouldCompress(inSize) && deflateMessage(inMessage, inSize, outFrame)) return;
+	outFrame.reserve(inSize+1);
+	outFrame.assign(1, static_cast<char>(eRaw));
+	outFrame.append(inMessage, inSize);
+}
+
+/*!
+ *  \brief Extract the message of a received frame.
+ *  \param inFrame Received frame.
+ *  \param inSize Size of the frame.
+ *  \param outSize Size of the message.
+ *  \return Message, pointing in the frame or in an internal buffer valid until the next call.
+ */
+const char* Beagle::MPI::Compressor::unpack(const char* inFrame, unsigned int inSize, unsigned int& outSize)
+{
+	if(inSize == 0) throw Beagle_IOExceptionMessageM("empty message frame");
+	if(inFrame[0] == eRaw) {
+		outSize = inSize-1;
+		return inFrame+1;
+	}
+	if(((inFrame[0] != eDeflate) && (inFrame[0] != eDeflateDictionary)) || (inSize < gHeaderSize)) {
+		throw Beagle_IOExceptionMessageM("invalid message frame");
+	}
+	std::memcpy(&outSize, inFrame+1, sizeof(unsigned int));
+
+	if(!mInflateReady) {
+		std::memset(&mInflateStream, 0, sizeof(z_stream));
+		if(inflateInit(&mInflateStream) != Z_OK) throw Beagle_RunTimeExceptionM("unable to initialize zlib");
+		mInflateReady = true;
+	} else inflateReset(&mInflateStream);
+
+	mInflateBuffer.resize(outSize+1);
+	mInflateStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(inFrame+gHeaderSize));
+	mInflateStream.avail_in = inSize-gHeaderSize;
+	mInflateStream.next_out = reinterpret_cast<Bytef*>(&mInflateBuffer[0]);
+	mInflateStream.avail_out = outSize;
+	int lResult = inflate(&mInflateStream, Z_FINISH);
+	if(lResult == Z_NEED_DICT) {
+		if(mDictionary.empty()) {
+			throw Beagle_IOExceptionMessageM("message compressed with a dictionary, but no dictionary is set");
+		}
+		inflateSetDictionary(&mInflateStream, reinterpret_cast<const Bytef*>(mDictionary.data()), mDictionary.size());
+		lResult = inflate(&mInflateStream, Z_FINISH);
+	}
+	if((lResult != Z_STREAM_END) || (mInflateStream.avail_out != 0)) {
+		throw Beagle_IOExceptionMessageM("corrupted compressed message");
+	}
+	return &mInflateBuffer[0];
+}
+
+/*!
+ *  \brief Update the bandwidth estimate with the duration of a blocking send.
+ *
+ *  Small sends are ignored, they usually return before the data is transferred.
+ */
+void Beagle::MPI::Compressor::recordTransfer(unsigned int inNbBytes, double inSeconds)
+{
+	if((inNbBytes < gMinTimedTransfer) || (inSeconds <= 0.)) return;
+	if(mBandwidth < 0.) mBandwidth = (mInitBandwidth == NULL) ? 100e6 : mInitBandwidth->getWrappedValue()*1e6;
+	mBandwidth = (1.-gSmoothing)*mBandwidth + gSmoothing*(inNbBytes/inSeconds);
+}
+
+/*!
+ *  \brief Decide if a message of given size should be compressed.
+ */
+bool Beagle::MPI::Compressor::shouldCompress(unsigned int inSize)
+{
+	const std::string lMode = (mMode == NULL) ? std::string("auto") : mMode->getWrappedValue();
+	if(lMode == "never") return false;
+	if(inSize < ((mThreshold == NULL) ? 4096 : mThreshold->getWrappedValue())) return false;
+	if(lMode == "always") return true;
+
+	if(mBandwidth < 0.) mBandwidth = (mInitBandwidth == NULL) ? 100e6 : mInitBandwidth->getWrappedValue()*1e6;
+	if((mNbCandidates++ % gProbeInterval) == 0) return true;
+	//Decompression is estimated to take a quarter of the compression time
+	const double lCodingTime = 1.25 * inSize / mSpeed;
+	const double lSavedTime = (1.-mRatio) * inSize / mBandwidth;
+	return lSavedTime > lCodingTime;
+}
+
+/*!
+ *  \brief Deflate a message in a frame, updating the compression estimates.
+ *  \return False if the compressed frame is not smaller than the raw one.
+ */
+bool Beagle::MPI::Compressor::deflateMessage(const char* inMessage, unsigned int inSize, std::string& outFrame)
+{
+	const double lStart = MPI_Wtime();
+	if(!mDeflateReady) {
+		std::memset(&mDeflateStream, 0, sizeof(z_stream));
+		const int lLevel = (mLevel == NULL) ? Z_BEST_SPEED : mLevel->getWrappedValue();
+		if(deflateInit(&mDeflateStream, lLevel) != Z_OK) throw Beagle_RunTimeExceptionM("unable to initialize zlib");
+		mDeflateReady = true;
+	} else deflateReset(&mDeflateStream);
+
+	FrameType lType = eDeflate;
+	if(!mDictionary.empty() && useDictionary()) {
+		deflateSetDictionary(&mDeflateStream, reinterpret_cast<const Bytef*>(mDictionary.data()), mDictionary.size());
+		lType = eDeflateDictionary;
+	}
+	const unsigned int lBound = deflateBound(&mDeflateStream, inSize);
+	outFrame.resize(gHeaderSize+lBound);
+	outFrame[0] = static_cast<char>(lType);
+	std::memcpy(&outFrame[1], &inSize, sizeof(unsigned int));
+	mDeflateStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(inMessage));
+	mDeflateStream.avail_in = inSize;
+	mDeflateStream.next_out = reinterpret_cast<Bytef*>(&outFrame[gHeaderSize]);
+	mDeflateStream.avail_out = lBound;
+	if(deflate(&mDeflateStream, Z_FINISH) != Z_STREAM_END) {
+		throw Beagle_RunTimeExceptionM("zlib compression of a message failed");
+	}
+	const unsigned int lCompressedSize = lBound - mDeflateStream.avail_out;
+
+	const double lElapsed = MPI_Wtime() - lStart;
+	if(lElapsed > 0.) mSpeed = (1.-gSmoothing)*mSpeed + gSmoothing*(inSize/lElapsed);
+	mRatio = (1.-gSmoothing)*mRatio + gSmoothing*(double(lCompressedSize)/inSize);
+
+	if(gHeaderSize+lCompressedSize >= inSize+1) return false;
+	outFrame.resize(gHeaderSize+lCompressedSize);
+	return true;
+}
@@ -0,0 +1,106 @@
+/*
+ *  MPI_Compressor.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_Compressor_H
+#define MPI_Compressor_H
+
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "beagle/config.hpp"
+#include "beagle/macros.hpp"
+#include "beagle/Object.hpp"
+#include "beagle/PointerT.hpp"
+#include "beagle/System.hpp"
+#include "beagle/UInt.hpp"
+#include "beagle/Float.hpp"
+#include "beagle/Bool.hpp"
+#include "beagle/String.hpp"
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class Compressor MPI_Compressor.hpp "MPI_Compressor.hpp"
+ *  \brief Adaptive zlib compression of the messages exchanged with the evaluators.
+ *
+ *  Each message is wrapped in a frame whose first byte tells if the rest is
+ *  raw or deflated. Messages smaller than ec.mpi.compress.threshold are always
+ *  sent raw. For larger ones, in "auto" mode, the message is deflated only if the
+ *  transfer time saved at the measured bandwidth is bigger than the time spent
+ *  compressing and decompressing it, both measured on the previous messages.
+ *  The compression is still tried now and then to keep the estimates current.
+ *
+ *  A preset dictionary, usually built from the codecs (tag and primitive names),
+ *  can be given. It must be the same on both ends.
+ */
+class Compressor : public Object {
+public:
+	//! Compressor handle type.
+	typedef PointerT<Compressor,Object::Handle>
+	Handle;
+
+	//! Frame types.
+	enum FrameType { eRaw=0, eDeflate, eDeflateDictionary };
+
+	Compressor();
+	virtual ~Compressor();
+
+	void initialize(System& ioSystem);
+	void setDictionary(const std::string& inDictionary);
+	//! Return true if the preset dictionary must be used.
+	bool useDictionary() const { return (mUseDictionary == NULL) || mUseDictionary->getWrappedValue(); }
+
+	void        pack(const char* inMessage, unsigned int inSize, std::string& outFrame);
+	const char* unpack(const char* inFrame, unsigned int inSize, unsigned int& outSize);
+	void        recordTransfer(unsigned int inNbBytes, double inSeconds);
+
+protected:
+	bool shouldCompress(unsigned int inSize);
+	bool deflateMessage(const char* inMessage, unsigned int inSize, std::string& outFrame);
+
+	String::Handle mMode;            //!< Compression mode: "auto", "always" or "never".
+	UInt::Handle   mThreshold;       //!< Size under which messages are never compressed.
+	UInt::Handle   mLevel;           //!< zlib compression level.
+	Float::Handle  mInitBandwidth;   //!< Initial estimate of the link bandwidth, in MB/s.
+	Bool::Handle   mUseDictionary;   //!< Use the preset dictionary.
+
+	z_stream          mDeflateStream;   //!< Compression stream, reset for each message.
+	z_stream          mInflateStream;   //!< Decompression stream, reset for each message.
+	bool              mDeflateReady;    //!< True when the compression stream is initialized.
+	bool              mInflateReady;    //!< True when the decompression stream is initialized.
+	std::string       mDictionary;      //!< Preset dictionary.
+	std::vector<char> mInflateBuffer;   //!< Buffer of the last decompressed message.
+
+	double       mBandwidth;      //!< Estimated link bandwidth, in bytes/s.
+	double       mSpeed;          //!< Estimated compression speed, in bytes/s.
+	double       mRatio;          //!< Estimated compressed to raw size ratio.
+	unsigned int mNbCandidates;   //!< Number of messages above threshold.
+
+private:
+	Compressor(const Compressor&);
+	void operator=(const Compressor&);
+};
+
+}
+}
+
+#endif
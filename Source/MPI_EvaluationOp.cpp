@@ -39,23 +39,153 @@
 #include <algorithm>
 #include <string>
 #include <sstream>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <cmath>
+#include <cfloat>
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include <XML.hpp>
 
 #include <beagle/GA.hpp>
 #include "CommunicationMPI.h"
 #include "VectorUtil.h"
+#include "MPI_XMLStreamDecoder.hpp"
+#include "MPI_XMLCodec.hpp"
 
 using namespace Beagle;
 
+namespace {
+	//! Individual of a block waiting for a worker of a sub-master.
+	struct BlockItem {
+		unsigned int mBlock;    //!< Sequence number of the block.
+		unsigned int mIndex;    //!< Index of the individual in the deme of rank 0.
+		std::string  mMessage;  //!< Encoded individual.
+	};
+
+	//! Block being evaluated by the workers of a sub-master.
+	struct OpenBlock {
+		unsigned int mGeneration;  //!< Generation of the individuals.
+		unsigned int mRemaining;   //!< Number of fitnesses still expected.
+		std::string  mReply;       //!< Fitnesses received so far.
+	};
+
+	//! Append an unsigned integer to a block.
+	void appendUInt(std::string& ioBlock, unsigned int inValue)
+	{
+		ioBlock.append(reinterpret_cast<const char*>(&inValue), sizeof(unsigned int));
+	}
+
+	//! Read an unsigned integer of a block and move the cursor past it.
+	unsigned int readUInt(const char*& ioCursor, const char* inEnd)
+	{
+		if(ioCursor+sizeof(unsigned int) > inEnd) throw Beagle_IOExceptionMessageM("truncated block");
+		unsigned int lValue;
+		std::memcpy(&lValue, ioCursor, sizeof(unsigned int));
+		ioCursor += sizeof(unsigned int);
+		return lValue;
+	}
+
+	//! Add the fitness of an individual to its block, returning true when the block is complete.
+	bool closeItem(OpenBlock& ioBlock, unsigned int inIndex, const char* inFitness, unsigned int inSize)
+	{
+		appendUInt(ioBlock.mReply, inIndex);
+		appendUInt(ioBlock.mReply, inSize);
+		ioBlock.mReply.append(inFitness, inSize);
+		if(--ioBlock.mRemaining > 0) return false;
+		//The evaluation time is only measured by the evaluators receiving blocks
+		const double lEvaluationTime = 0.;
+		ioBlock.mReply.append(reinterpret_cast<const char*>(&lEvaluationTime), sizeof(double));
+		return true;
+	}
+}
+
 
 /*!
  *  \brief Construct a new evaluation operator.
  *  \param inName Name of the operator.
  */
 Beagle::MPI::EvaluationOp::EvaluationOp(std::string inName) :
-Beagle::EvaluationOp(inName)
-{ }
+Beagle::EvaluationOp(inName),
+mCodecIndex(-1),
+mCompressor(new Compressor),
+mDictionaryReady(false),
+mHierarchy(new Hierarchy),
+mSharedChannel(new SharedChannel),
+mShardGroup(new ShardGroup),
+mScheduler(new Scheduler),
+mWorkQueue(new WorkQueue),
+mHeartbeatTarget(-1),
+mQueueDisabled(false),
+mTerminationMet(false),
+mCancelled(false),
+mInWatchdog(false),
+mForkLogged(false),
+mTimedOut(false),
+mDeadline(0.),
+mNextHeartbeat(0.),
+mSentBound(-DBL_MAX),
+mRejectionBound(-DBL_MAX),
+mRejected(false),
+mNbSkipped(0),
+mNbRejected(0),
+mNbSkippedCases(0)
+{
+	mCodecs.push_back(new XMLCodec);
+}
+
+
+/*!
+ *  \brief Add a codec for the individuals sent to the evaluators.
+ *  \param inCodec Codec to add.
+ *
+ *  With ec.mpi.codec set to "auto", the codecs are tried from the last added to
+ *  the first one, the XML codec. Codecs must be added in the same order on every
+ *  process, usually from the constructor of the evaluation operator.
+ */
+void Beagle::MPI::EvaluationOp::addCodec(Codec::Handle inCodec)
+{
+	if(mCodecs.size() > 255) {
+		throw Beagle_RunTimeExceptionM("Too many codecs added to the MPI evaluation operator");
+	}
+	mCodecs.push_back(inCodec);
+}
+
+
+/*!
+ *  \brief Return the codec of given name.
+ *  \param inName Name of the codec.
+ *  \return Handle to the codec, NULL if no codec of that name was added.
+ */
+Beagle::MPI::Codec::Handle Beagle::MPI::EvaluationOp::getCodec(const std::string& inName) const
+{
+	for(unsigned int i = 0; i < mCodecs.size(); ++i) {
+		if(mCodecs[i]->getName() == inName) return mCodecs[i];
+	}
+	return NULL;
+}
+
+
+/*!
+ *  \brief Return the expected cost of the evaluation of an individual.
+ *  \param inIndividual Individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \return Expected cost, in any unit common to all the individuals.
+ *
+ *  Used to order the dispatch of the individuals. The default cost is the size
+ *  of the individual, the number of nodes of the GP trees or the length of the
+ *  GA genomes. Override when the evaluation cost depends on something else.
+ */
+double Beagle::MPI::EvaluationOp::getEvaluationCost(const Individual& inIndividual, Context& ioContext)
+{
+	return inIndividual.getSize();
+}
 
 
 /*!
@@ -202,6 +332,192 @@ void Beagle::MPI::EvaluationOp::initialize(System& ioSystem)
 										   );
 		ioSystem.getRegister().addEntry("ec.hof.demesize", mDemeHOFSize, lDescription);
 	}
+	
+	if(ioSystem.getRegister().isRegistered("ec.mpi.codec")) {
+		mCodecName = castHandleT<String>(ioSystem.getRegister().getEntry("ec.mpi.codec"));
+	} else {
+		mCodecName = new String("auto");
+		std::string lLongDescript = "Wire format of the individuals sent to the evaluators. ";
+		lLongDescript += "With \"auto\", the most specialized codec able to encode an individual is used, ";
+		lLongDescript += "otherwise the named codec is used (e.g. \"xml\" or \"gptree\"), falling back to ";
+		lLongDescript += "XML for the individuals it cannot encode.";
+		Register::Description lDescription(
+										   "MPI individual codec",
+										   "String",
+										   "auto",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.codec", mCodecName, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.route.window")) {
+		mRoutingWindow = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.route.window"));
+	} else {
+		mRoutingWindow = new UInt(4);
+		std::string lLongDescript = "Number of pending individuals among which the one sent to an idle ";
+		lLongDescript += "evaluator is chosen, preferring the individuals the evaluator can receive in ";
+		lLongDescript += "fewer bytes (e.g. from its delta cache). A value of 0 or 1 sends them in order.";
+		Register::Description lDescription(
+										   "MPI routing window",
+										   "UInt",
+										   "4",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.route.window", mRoutingWindow, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.backup")) {
+		mBackupCopies = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.backup"));
+	} else {
+		mBackupCopies = new UInt(0);
+		std::string lLongDescript = "Maximum number of backup copies of an outstanding evaluation sent to ";
+		lLongDescript += "idle evaluators once every individual of the deme is sent. The first fitness ";
+		lLongDescript += "received is kept. A value of 0 disables the backup copies.";
+		Register::Description lDescription(
+										   "MPI backup copies",
+										   "UInt",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.backup", mBackupCopies, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.eval.timeout")) {
+		mEvaluationTimeout = castHandleT<Float>(ioSystem.getRegister().getEntry("ec.mpi.eval.timeout"));
+	} else {
+		mEvaluationTimeout = new Float(0.);
+		std::string lLongDescript = "Maximum time in seconds of the evaluation of an individual. When positive, ";
+		lLongDescript += "isCancelled returns true once an evaluation ran that long, the individual then ";
+		lLongDescript += "getting the fitness of ec.mpi.eval.penalty. Evaluations which do not poll ";
+		lLongDescript += "isCancelled run to the end, unless ec.mpi.eval.fork is set. A value of 0 ";
+		lLongDescript += "disables the timeout.";
+		Register::Description lDescription(
+										   "MPI evaluation timeout",
+										   "Float",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.eval.timeout", mEvaluationTimeout, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.eval.fork")) {
+		mForkEvaluation = castHandleT<Bool>(ioSystem.getRegister().getEntry("ec.mpi.eval.fork"));
+	} else {
+		mForkEvaluation = new Bool(false);
+		std::string lLongDescript = "Run each evaluation under ec.mpi.eval.timeout in a forked process, killed ";
+		lLongDescript += "after the timeout, so that evaluations which never return are stopped. The state ";
+		lLongDescript += "updated by the evaluation stays in the forked process, which disables the caches ";
+		lLongDescript += "and the timings of the GP interpreter, and the MPI transport must support fork.";
+		Register::Description lDescription(
+										   "MPI forked evaluations",
+										   "Bool",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.eval.fork", mForkEvaluation, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.eval.penalty")) {
+		mPenaltyFitness = castHandleT<String>(ioSystem.getRegister().getEntry("ec.mpi.eval.penalty"));
+	} else {
+		mPenaltyFitness = new String("");
+		std::string lLongDescript = "XML fitness given to the individuals whose evaluation failed, e.g. ";
+		lLongDescript += "<Fitness type=\"simple\">0</Fitness>. When empty, the fitness built by the ";
+		lLongDescript += "fitness allocator is used.";
+		Register::Description lDescription(
+										   "MPI penalty fitness",
+										   "String",
+										   "\"\"",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.eval.penalty", mPenaltyFitness, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.worker.timeout")) {
+		mWorkerTimeout = castHandleT<Float>(ioSystem.getRegister().getEntry("ec.mpi.worker.timeout"));
+	} else {
+		mWorkerTimeout = new Float(0.);
+		std::string lLongDescript = "Time in seconds per individual after which rank 0 considers an evaluator ";
+		lLongDescript += "unresponsive and sends its individuals to other evaluators. Should exceed ";
+		lLongDescript += "ec.mpi.eval.timeout. A value of 0 disables the timeout.";
+		Register::Description lDescription(
+										   "MPI evaluator timeout",
+										   "Float",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.worker.timeout", mWorkerTimeout, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.race.quantile")) {
+		mRaceQuantile = castHandleT<Float>(ioSystem.getRegister().getEntry("ec.mpi.race.quantile"));
+	} else {
+		mRaceQuantile = new Float(0.);
+		std::string lLongDescript = "Quantile of the fitnesses of the last evaluation of a deme sent to the ";
+		lLongDescript += "evaluators as rejection bound, e.g. 0.25 for the first quartile. Evaluation ";
+		lLongDescript += "operators may stop the evaluation of an individual which cannot reach that bound. ";
+		lLongDescript += "Only used with FitnessSimple. A value of 0 disables the bound.";
+		Register::Description lDescription(
+										   "MPI rejection quantile",
+										   "Float",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.race.quantile", mRaceQuantile, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.term.early")) {
+		mEarlyTermination = castHandleT<Bool>(ioSystem.getRegister().getEntry("ec.mpi.term.early"));
+	} else {
+		mEarlyTermination = new Bool(false);
+		std::string lLongDescript = "Check the fitness termination criteria of the evolver on each fitness ";
+		lLongDescript += "received. Once one is met, rank 0 stops sending individuals, cancels the ";
+		lLongDescript += "evaluations in progress and removes the unevaluated individuals from the deme. ";
+		lLongDescript += "Used when rank 0 serves the evaluators directly, with or without the work ";
+		lLongDescript += "queue, but not with sub-masters.";
+		Register::Description lDescription(
+										   "MPI early termination",
+										   "Bool",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.term.early", mEarlyTermination, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.heartbeat")) {
+		mHeartbeatPeriod = castHandleT<Float>(ioSystem.getRegister().getEntry("ec.mpi.heartbeat"));
+	} else {
+		mHeartbeatPeriod = new Float(0.);
+		std::string lLongDescript = "Period in seconds of the heartbeats sent by the evaluators to the process ";
+		lLongDescript += "which sent them individuals, while an evaluation runs under ec.mpi.eval.timeout, ";
+		lLongDescript += "when the evaluation polls isCancelled or from the watchdog of ec.mpi.eval.fork. ";
+		lLongDescript += "Rank 0 then counts ec.mpi.worker.timeout from the last heartbeat, so that only ";
+		lLongDescript += "lost evaluators are considered unresponsive. A value of 0 disables the heartbeats.";
+		Register::Description lDescription(
+										   "MPI heartbeat period",
+										   "Float",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.heartbeat", mHeartbeatPeriod, lDescription);
+	}
+	if(ioSystem.getRegister().isRegistered("ec.mpi.overprov")) {
+		mOverProvision = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.overprov"));
+	} else {
+		mOverProvision = new UInt(0);
+		std::string lLongDescript = "Number of over-provisioned offspring per deme. The evaluation of a deme ";
+		lLongDescript += "ends as soon as all but this number of its new individuals are evaluated, the ";
+		lLongDescript += "remaining ones being removed from the deme. Set ec.pop.size to the wanted size plus ";
+		lLongDescript += "this number so that the extra offspring are bred. Only used without sub-masters ";
+		lLongDescript += "and work queue.";
+		Register::Description lDescription(
+										   "MPI over-provisioning",
+										   "UInt",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.overprov", mOverProvision, lDescription);
+	}
+	for(unsigned int i = 0; i < mCodecs.size(); ++i) {
+		mCodecs[i]->initialize(ioSystem);
+	}
+	mCompressor->initialize(ioSystem);
+	mHierarchy->initialize(ioSystem);
+	mSharedChannel->initialize(ioSystem);
+	mShardGroup->initialize(ioSystem);
+	mScheduler->initialize(ioSystem);
+	mWorkQueue->initialize(ioSystem);
 }
 
 
@@ -213,15 +529,269 @@ void Beagle::MPI::EvaluationOp::initialize(System& ioSystem)
 void Beagle::MPI::EvaluationOp::operate(Deme& ioDeme, Context& ioContext)
 {
 	if(mProcessSize == 1)
-		Beagle::EvaluationOp::operate(ioDeme,ioContext);
+		evolverOperate(ioDeme, ioContext);
 	else {
+		if(mHierarchy->isEnabled() && mShardGroup->isEnabled()) {
+			throw Beagle_RunTimeExceptionM("ec.mpi.shard.size cannot be used with ec.mpi.hierarchy.arity");
+		}
+		mHierarchy->build();
+		mSharedChannel->build();
+		mShardGroup->build();
+		mWorkQueue->build();
 		if(mRank == 0) { 
+			//The members of the shard groups are only reached through their leader
+			mLostWorkers.resize(mProcessSize, false);
+			for(int i = 1; i < mProcessSize; ++i) {
+				if(mShardGroup->isMember(i)) mLostWorkers[i] = true;
+			}
 			evolverOperate(ioDeme, ioContext);
 		}
+		else if(mHierarchy->getRole() == Hierarchy::eSubMaster) {
+			subMasterOperate(ioContext);
+		}
+		else if(mShardGroup->getRole() == ShardGroup::eMember) {
+			shardMemberOperate(ioContext);
+		}
 		else {
 			evaluatorOperate(ioDeme, ioContext);
+			if(mShardGroup->getRole() == ShardGroup::eLeader) stopShardMembers();
+		}
+		//Only rank 0 comes back every generation, it releases the windows when stopping the evaluators
+		if(mRank != 0) releaseWindows();
+	}
+}
+
+/*!
+ *  \brief Free the one-sided windows at the end of the evolution.
+ *
+ *  Collective, it must be called once by every process after the evolution
+ *  ended: by rank 0 once the evaluators are stopped, and by the other
+ *  processes when their loop returns.
+ */
+void Beagle::MPI::EvaluationOp::releaseWindows()
+{
+	mWorkQueue->teardown();
+	mSharedChannel->teardown();
+}
+
+/*!
+ *  \brief Encode an individual with the selected codec, the codec index being the first byte.
+ *  \param inIndividual Individual to encode.
+ *  \param inDestination Rank of the receiving process, -1 if not known in advance.
+ *  \param ioContext Evolutionary context.
+ *  \param outMessage Encoded message.
+ */
+void Beagle::MPI::EvaluationOp::encodeIndividual(const Individual& inIndividual, int inDestination, Context& ioContext, std::string& outMessage)
+{
+	if(mCodecIndex == -1) {
+		if(mCodecName->getWrappedValue() != "auto") {
+			for(unsigned int i = 0; i < mCodecs.size(); ++i) {
+				if(mCodecs[i]->getName() == mCodecName->getWrappedValue()) mCodecIndex = i;
+			}
+			if(mCodecIndex == -1) {
+				throw Beagle_RunTimeExceptionM(std::string("Unknown MPI codec \"")+mCodecName->getWrappedValue()+"\"");
+			}
+		}
+	}
+	//Messages may be forwarded by a sub-master or taken from the work queue by any evaluator,
+	//the codecs keeping state per receiver are then skipped
+	const bool lForwarded = mHierarchy->isEnabled() || (inDestination < 0);
+	outMessage.resize(1);
+	if((mCodecIndex > 0) && !(lForwarded && mCodecs[mCodecIndex]->isPeerSpecific())) {
+		outMessage[0] = static_cast<char>(mCodecIndex);
+		if(mCodecs[mCodecIndex]->encodeIndividual(inIndividual, inDestination, ioContext, outMessage)) return;
+	} else if(mCodecIndex == -1) {
+		for(unsigned int i = mCodecs.size()-1; i > 0; --i) {
+			if(lForwarded && mCodecs[i]->isPeerSpecific()) continue;
+			outMessage[0] = static_cast<char>(i);
+			if(mCodecs[i]->encodeIndividual(inIndividual, inDestination, ioContext, outMessage)) return;
+		}
+	}
+	outMessage[0] = 0;
+	mCodecs[0]->encodeIndividual(inIndividual, inDestination, ioContext, outMessage);
+}
+
+/*!
+ *  \brief Decode an individual encoded by encodeIndividual.
+ *  \param inMessage Received message.
+ *  \param inSize Size of the message.
+ *  \param inSource Rank of the sending process.
+ *  \param ioIndividual Individual to fill.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::EvaluationOp::decodeIndividual(const char* inMessage, unsigned int inSize, int inSource, Individual& ioIndividual, Context& ioContext)
+{
+	if(inSize == 0) throw Beagle_IOExceptionMessageM("empty individual message");
+	const unsigned int lCodec = static_cast<unsigned char>(inMessage[0]);
+	if(lCodec >= mCodecs.size()) {
+		throw Beagle_IOExceptionMessageM(std::string("unknown codec ")+uint2str(lCodec)+" in individual message");
+	}
+	mCodecs[lCodec]->decodeIndividual(inMessage+1, inSize-1, inSource, ioIndividual, ioContext);
+}
+
+/*!
+ *  \brief Order the individuals to dispatch by their expected evaluation cost.
+ *  \param ioDeme Deme being evaluated.
+ *  \param ioContext Evolutionary context.
+ *  \param ioOrder Deme indices of the individuals to dispatch, reordered.
+ *  \param outCosts Expected cost of the individuals, indexed as in the deme, 0 for the valid ones.
+ */
+void Beagle::MPI::EvaluationOp::scheduleIndividuals(Deme& ioDeme, Context& ioContext, std::vector<unsigned int>& ioOrder,
+													std::vector<double>& outCosts)
+{
+	outCosts.assign(ioDeme.size(), 0.0);
+	for(unsigned int i = 0; i < ioOrder.size(); ++i) {
+		const Individual& lIndividual = *ioDeme[ioOrder[i]];
+		if((lIndividual.getFitness() != NULL) && lIndividual.getFitness()->isValid()) continue;
+		outCosts[ioOrder[i]] = getEvaluationCost(lIndividual, ioContext);
+	}
+	if(mScheduler->isCostOrdered()) mScheduler->order(outCosts, ioOrder);
+}
+
+/*!
+ *  \brief Bring forward the individual to send next to an idle evaluator.
+ *  \param ioDeme Deme being evaluated.
+ *  \param ioOrder Order in which the individuals of the deme are sent.
+ *  \param inCurrent Position in the order of the next individual to send.
+ *  \param inCosts Expected cost of the individuals, indexed as in the deme.
+ *  \param inDestination Rank of the idle evaluator.
+ *  \param inRemaining Number of individuals not yet sent.
+ *
+ *  When fewer individuals remain than there are evaluators, a slow evaluator
+ *  receives the cheapest one, so that the generation does not end waiting on
+ *  it. Otherwise the individual is chosen by routeIndividual.
+ */
+void Beagle::MPI::EvaluationOp::selectIndividual(Deme& ioDeme, std::vector<unsigned int>& ioOrder, unsigned int inCurrent,
+												 const std::vector<double>& inCosts, int inDestination, unsigned int inRemaining)
+{
+	if((inRemaining < (unsigned int)mProcessSize) && mScheduler->isSlow(inDestination)) {
+		unsigned int lCheapest = inCurrent;
+		for(unsigned int i = inCurrent; i < ioOrder.size(); ++i) {
+			const Individual& lIndividual = *ioDeme[ioOrder[i]];
+			if((lIndividual.getFitness() != NULL) && lIndividual.getFitness()->isValid()) continue;
+			if(inCosts[ioOrder[i]] < inCosts[ioOrder[lCheapest]]) lCheapest = i;
+		}
+		std::swap(ioOrder[inCurrent], ioOrder[lCheapest]);
+	} else if(mRoutingWindow->getWrappedValue() > 1) {
+		routeIndividual(ioDeme, ioOrder, inCurrent, inDestination);
+	}
+}
+
+/*!
+ *  \brief Bring forward the pending individual the codecs can send in the fewest bytes to an evaluator.
+ *  \param ioDeme Deme being evaluated.
+ *  \param ioOrder Order in which the individuals of the deme are sent.
+ *  \param inCurrent Position in the order of the next individual to send.
+ *  \param inDestination Rank of the idle evaluator.
+ */
+void Beagle::MPI::EvaluationOp::routeIndividual(Deme& ioDeme, std::vector<unsigned int>& ioOrder, unsigned int inCurrent, int inDestination)
+{
+	const unsigned int lEnd = std::min<unsigned int>(inCurrent+mRoutingWindow->getWrappedValue(), ioOrder.size());
+	unsigned int lBest = inCurrent;
+	unsigned int lBestAffinity = 0;
+	for(unsigned int i = inCurrent; i < lEnd; ++i) {
+		const Individual& lIndividual = *ioDeme[ioOrder[i]];
+		if((lIndividual.getFitness() != NULL) && lIndividual.getFitness()->isValid()) continue;
+		unsigned int lAffinity = 0;
+		for(unsigned int j = 0; j < mCodecs.size(); ++j) {
+			lAffinity = std::max(lAffinity, mCodecs[j]->getPeerAffinity(lIndividual, inDestination));
+		}
+		if(lAffinity > lBestAffinity) {
+			lBest = i;
+			lBestAffinity = lAffinity;
 		}
 	}
+	std::swap(ioOrder[inCurrent], ioOrder[lBest]);
+}
+
+/*!
+ *  \brief Build the compression dictionary from the codecs, on first use.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::EvaluationOp::prepareCompressor(Context& ioContext)
+{
+	if(mDictionaryReady) return;
+	std::string lDictionary;
+	for(unsigned int i = 0; i < mCodecs.size(); ++i) {
+		mCodecs[i]->appendDictionary(ioContext, lDictionary);
+	}
+	mCompressor->setDictionary(lDictionary);
+	mDictionaryReady = true;
+}
+
+/*!
+ *  \brief Send a message, possibly compressed, preceded by the size of its frame.
+ *  \param inMessage Message to send.
+ *  \param inSize Size of the message.
+ *  \param inDestination Rank of the receiving process.
+ *  \param inTag Tag of the message.
+ *  \return False if the receiving process could not be reached.
+ */
+bool Beagle::MPI::EvaluationOp::sendMessage(const char* inMessage, unsigned int inSize, int inDestination, int inTag)
+{
+	mCompressor->pack(inMessage, inSize, mFrameOut);
+	int lFrameSize = mFrameOut.size();
+	if(MPI_Send(&lFrameSize, 1, MPI_INT, inDestination, eMessageSize, MPI_COMM_WORLD) != MPI_SUCCESS) return false;
+	const double lStart = MPI_Wtime();
+	if(MPI_Send(const_cast<char*>(mFrameOut.data()), lFrameSize, MPI_CHAR, inDestination, inTag, MPI_COMM_WORLD) != MPI_SUCCESS) {
+		return false;
+	}
+	mCompressor->recordTransfer(lFrameSize, MPI_Wtime()-lStart);
+	return true;
+}
+
+/*!
+ *  \brief Receive a message sent by sendMessage, once the size of its frame is received.
+ *  \param inSource Rank of the sending process.
+ *  \param inTag Tag of the message.
+ *  \param inFrameSize Size of the frame.
+ *  \param outSize Size of the message.
+ *  \return Message, valid until the next received message.
+ */
+const char* Beagle::MPI::EvaluationOp::receiveMessage(int inSource, int inTag, int inFrameSize, unsigned int& outSize)
+{
+	MPI_Status lStatus;
+	mReceiveBuffer.resize(std::max(inFrameSize, 1));
+	MPI_Recv(&mReceiveBuffer[0], inFrameSize, MPI_CHAR, inSource, inTag, MPI_COMM_WORLD, &lStatus);
+	return mCompressor->unpack(&mReceiveBuffer[0], inFrameSize, outSize);
+}
+
+/*!
+ *  \brief Send an individual to an evaluator, through shared memory if possible.
+ *  \param inMessage Encoded individual.
+ *  \param inDestination Rank of the evaluator.
+ *  \param inGeneration Current generation.
+ *  \return False if the evaluator could not be reached.
+ */
+bool Beagle::MPI::EvaluationOp::sendIndividual(const std::string& inMessage, int inDestination, unsigned int inGeneration)
+{
+	if(mSharedChannel->hasSlot(inDestination) && mSharedChannel->fits(inMessage.size())) {
+		mSharedChannel->write(inDestination, inMessage.data(), inMessage.size(), inGeneration);
+		int lSize = inMessage.size();
+		return MPI_Send(&lSize, 1, MPI_INT, inDestination, eSharedIndividual, MPI_COMM_WORLD) == MPI_SUCCESS;
+	}
+	if(!sendMessage(inMessage.data(), inMessage.size(), inDestination, eIndividual)) return false;
+	return MPI_Send(&inGeneration, 1, MPI_INT, inDestination, eIndividual, MPI_COMM_WORLD) == MPI_SUCCESS;
+}
+
+/*!
+ *  \brief Receive the fitness sent by an evaluator, once probed.
+ *  \param inSource Rank of the evaluator.
+ *  \param inTag Tag of the probed message.
+ *  \param outSize Size of the fitness message.
+ *  \return Fitness message, valid until the next message from that evaluator.
+ */
+const char* Beagle::MPI::EvaluationOp::receiveFitness(int inSource, int inTag, unsigned int& outSize)
+{
+	MPI_Status lStatus;
+	int lSize;
+	if(inTag == eSharedFitness) {
+		unsigned int lGeneration;
+		MPI_Recv(&lSize, 1, MPI_INT, inSource, eSharedFitness, MPI_COMM_WORLD, &lStatus);
+		return mSharedChannel->read(inSource, outSize, lGeneration);
+	}
+	MPI_Recv(&lSize, 1, MPI_INT, inSource, eMessageSize, MPI_COMM_WORLD, &lStatus);
+	return receiveMessage(inSource, eFitness, lSize, outSize);
 }
 
 void Beagle::MPI::EvaluationOp::individualEvaluation(Individual& ioIndividal, Context& ioContext) {
@@ -233,142 +803,1042 @@ void Beagle::MPI::EvaluationOp::individualEvaluation(Individual& ioIndividal, Co
 }
 
 
+/*!
+ *  \brief Assign a fitness received from an evaluator to an individual.
+ *  \param ioDeme Deme being evaluated.
+ *  \param inIndex Index of the individual in the deme.
+ *  \param inMessage Fitness message.
+ *  \param inSize Size of the message.
+ *  \param ioDecoder Decoder of the fitness.
+ *  \param ioContext Evolutionary context.
+ *
+ *  An error reply of the evaluator gives the individual the penalty fitness.
+ */
+void Beagle::MPI::EvaluationOp::assignFitness(Deme& ioDeme, unsigned int inIndex, const char* inMessage, unsigned int inSize,
+											  XMLStreamDecoder& ioDecoder, Context& ioContext)
+{
+	//Read the received fitness
+	Fitness::Handle lFitness;
+	if((inSize >= 6) && (std::strncmp(inMessage, "<Error", 6) == 0)) {
+		Beagle_LogInfoM(
+						ioContext.getSystem().getLogger(),
+						"evaluation", "Beagle::MPIEvaluationOp",
+						std::string("Evaluation of the ")+uint2ordinal(inIndex+1)+std::string(" individual failed: ")+
+						std::string(inMessage, std::find(inMessage, inMessage+inSize, '\0'))+
+						std::string(", assigning the penalty fitness")
+						);
+		lFitness = getPenaltyFitness(*ioDeme[inIndex], ioContext);
+	} else if((inSize >= 9) && (std::strncmp(inMessage, "<Rejected", 9) == 0)) {
+		//Partial fitness of an evaluation stopped by the rejection bound
+		XMLStreamReader lReader(inMessage, inSize);
+		lReader.next();
+		++mNbRejected;
+		mNbSkippedCases += str2uint(lReader.getAttribute("skipped"));
+		if(lReader.next() != XMLStreamReader::eStartTag) throw Beagle_IOExceptionMessageM("tag <Fitness> expected!");
+		lFitness = castHandleT<Fitness>(ioDeme[inIndex]->getFitnessAlloc()->allocate());
+		ioDecoder.readFitness(lReader, *lFitness);
+	} else {
+		lFitness = castHandleT<Fitness>(ioDeme[inIndex]->getFitnessAlloc()->allocate());
+		ioDecoder.readFitness(inMessage, inSize, *lFitness);
+	}
+	
+	//Assign the fitness
+	ioDeme[inIndex]->setFitness(lFitness);
+	ioDeme[inIndex]->getFitness()->setValid();
+	
+	//Update stats
+	ioContext.setProcessedDeme(ioContext.getProcessedDeme()+1);
+	ioContext.setTotalProcessedDeme(ioContext.getTotalProcessedDeme()+1);
+	ioContext.setProcessedVivarium(ioContext.getProcessedVivarium()+1);
+	ioContext.setTotalProcessedVivarium(ioContext.getTotalProcessedVivarium()+1);  
+	
+	Beagle_LogDebugM(
+					 ioContext.getSystem().getLogger(),
+					 "evaluation", "Beagle::MPIEvaluationOp",
+					 std::string("Received fitness of individual: ")+
+					 ioDeme[inIndex]->serialize()
+					 );
+	
+	Beagle_LogDebugM(
+					 ioContext.getSystem().getLogger(),
+					 "evaluation", "Beagle::MPIEvaluationOp",
+					 std::string("The individual\'s fitness is: ")+
+					 ioDeme[inIndex]->getFitness()->serialize()
+					 );
+}
+
+
+/*!
+ *  \brief Assign the fitnesses of a block received from a sub-master or an evaluator.
+ *  \param ioDeme Deme being evaluated.
+ *  \param inMessage Block of fitnesses.
+ *  \param inSize Size of the block.
+ *  \param ioDecoder Decoder of the fitnesses.
+ *  \param ioContext Evolutionary context.
+ *  \param outEvaluationTime Time spent evaluating the block, 0 if not measured.
+ *  \return Number of fitnesses assigned.
+ */
+unsigned int Beagle::MPI::EvaluationOp::assignFitnessBlock(Deme& ioDeme, const char* inMessage, unsigned int inSize,
+														   XMLStreamDecoder& ioDecoder, Context& ioContext, double& outEvaluationTime)
+{
+	const char* lEnd = inMessage+inSize;
+	const unsigned int lNbFitnesses = readUInt(inMessage, lEnd);
+	unsigned int lNbAssigned = 0;
+	for(unsigned int i = 0; i < lNbFitnesses; ++i) {
+		const unsigned int lIndex = readUInt(inMessage, lEnd);
+		const unsigned int lFitnessSize = readUInt(inMessage, lEnd);
+		if((lIndex >= ioDeme.size()) || (lFitnessSize > static_cast<unsigned int>(lEnd-inMessage))) {
+			throw Beagle_IOExceptionMessageM("invalid fitness block");
+		}
+		//Fitnesses already received from a backup copy are dropped
+		if((ioDeme[lIndex]->getFitness() == NULL) || (ioDeme[lIndex]->getFitness()->isValid() == false)) {
+			assignFitness(ioDeme, lIndex, inMessage, lFitnessSize, ioDecoder, ioContext);
+			++lNbAssigned;
+		}
+		inMessage += lFitnessSize;
+	}
+	if(static_cast<unsigned int>(lEnd-inMessage) < sizeof(double)) throw Beagle_IOExceptionMessageM("truncated block");
+	std::memcpy(&outEvaluationTime, inMessage, sizeof(double));
+	return lNbAssigned;
+}
+
+
+/*!
+ *  \brief Distribute the evaluation of the invalid individuals of a deme to the evaluators.
+ *  \param ioDeme Deme to evaluate.
+ *  \param ioContext Evolutionary context.
+ *
+ *  Each idle evaluator receives the next individual, or chunk of individuals.
+ *  Once every individual is sent, idle evaluators receive backup copies of the
+ *  oldest outstanding evaluations, up to ec.mpi.backup copies each. The first
+ *  fitness received is kept, the late replies of the other copies are drained
+ *  and discarded, possibly during the evaluation of the next deme.
+ *
+ *  With ec.mpi.overprov set to k, the deme is closed as soon as all but k of
+ *  its invalid individuals are evaluated. The other ones are left invalid, to
+ *  be removed by evolverOperate, and their late replies are discarded.
+ *
+ *  An evaluator silent for more than ec.mpi.worker.timeout seconds per
+ *  individual, heartbeats included, is considered unresponsive, its
+ *  individuals being sent to other evaluators. Its reply is still used if it
+ *  comes back first. An evaluator still silent after a second timeout, or
+ *  owing the reply of a previous deme for two timeouts, is dropped for the
+ *  rest of the evolution, as is an evaluator that cannot be reached anymore.
+ *  The evolution stops with an error when no evaluator is left.
+ *
+ *  With ec.mpi.term.early, the deme is closed as soon as a received fitness
+ *  meets a termination criterion, the busy evaluators being cancelled.
+ */
 void Beagle::MPI::EvaluationOp::distributeDemeEvaluation(Deme& ioDeme, Context& ioContext) {
+	if(mProcessSize == 1) {
+		evaluateLocally(ioDeme, ioContext);
+		return;
+	}
+	if(mHierarchy->isEnabled()) {
+		distributeBlocks(ioDeme, ioContext);
+		return;
+	}
+	if(mWorkQueue->isEnabled() && distributeQueue(ioDeme, ioContext)) return;
+	mTerminationMet = false;
 	try{
 		std::vector<int> lProcess(mProcessSize, -1);
 		lProcess[0] = -2; //Master should not be pick
-		int lCurrentIndividual = 0;
-		std::ostringstream lStreamOut;
-
-		PACC::XML::Streamer lXMLStream(lStreamOut);
+		//Evaluators still owing the reply of a discarded copy are busy until it is drained
+		mPendingReply.resize(mProcessSize, false);
+		mLostWorkers.resize(mProcessSize, false);
+		for(int i = 1; i < mProcessSize; ++i) {
+			if(mPendingReply[i]) lProcess[i] = -3;
+			if(mLostWorkers[i]) lProcess[i] = -5;
+		}
+		unsigned int lCurrentIndividual = 0;
+		std::vector<unsigned int> lOrder(ioDeme.size());
+		for(unsigned int i = 0; i < lOrder.size(); ++i) lOrder[i] = i;
+		std::vector<double> lCosts;
+		scheduleIndividuals(ioDeme, ioContext, lOrder, lCosts);
+		XMLStreamDecoder lDecoder;
+		prepareCompressor(ioContext);
 
-		//char lSizeMessage[256];
-		int lMessageSize;
 		MPI_Status lStatus;
 		
 		int lFlag;
+		int lMessageSize;
 		unsigned int lSource = 1;
 		unsigned int lProcessIdx = 0;
-		unsigned int lRecvIndividualIdx = 0;
 
 		unsigned int lNbReceived = 0;		
 		unsigned int lNbSent = 0;
 		bool lAllSent = false;
 		
-		while( (lNbReceived < lNbSent) || !lAllSent ) {
-			if(!lAllSent) {
-				lProcessIdx = find(lProcess, -1, 0, lProcess.size());
-				if( lProcessIdx != lProcess.size() ) {
-					if((ioDeme[lCurrentIndividual]->getFitness() == NULL) ||
-					   (ioDeme[lCurrentIndividual]->getFitness()->isValid() == false)) {
-						
-						//There is a process idle
-						Beagle_LogVerboseM(   
-										   ioContext.getSystem().getLogger(),
-										   "evaluation", "Beagle::MPIEvaluationOp",
-										   std::string("Evaluating the fitness of the ")+uint2ordinal(lCurrentIndividual+1)+
-										   " individual"
-										   );
-						
-						ioContext.setIndividualIndex(lCurrentIndividual);
-						ioContext.setIndividualHandle(ioDeme[lCurrentIndividual]);
-						
-						//Send the individual to be evaluated
-						Beagle_LogTraceM(
-										   ioContext.getSystem().getLogger(),
-										   "evaluation", "Beagle::MPIEvaluationOp",
-										   std::string("Sending the ") + uint2ordinal(lCurrentIndividual+1) + std::string(" individual to ")+
-										   uint2ordinal(lProcessIdx) + std::string(" evaluator")
-										   );
-						
-						lStreamOut.str("");
-						ioDeme[lCurrentIndividual]->write(lXMLStream);
-						lMessageSize = lStreamOut.str().size()+1;
-						MPI_Send(&lMessageSize, 1, MPI_INT, lProcessIdx, eMessageSize, MPI_COMM_WORLD);
-						MPI_Send(const_cast<char*>(lStreamOut.str().data()), lMessageSize, MPI_CHAR, lProcessIdx, eIndividual, MPI_COMM_WORLD);
-						//std::cout << "Sending individual : " << lStreamOut.str().data() << std::endl;
-						unsigned int lGeneration = ioContext.getGeneration();
-						MPI_Send(&lGeneration, 1, MPI_INT, lProcessIdx, eIndividual, MPI_COMM_WORLD);
-						lProcess[lProcessIdx] = lCurrentIndividual;	
-						++lNbSent;
-					}
-					++lCurrentIndividual;
-					if(lCurrentIndividual >= ioDeme.size()) {
-						lAllSent = true;
-					}
+		//Individuals sent to each evaluator, several when sending chunks
+		const bool lChunked = mScheduler->isChunked();
+		std::vector<std::vector<unsigned int> > lChunks(mProcessSize);
+		//Time of the last sending to each evaluator, to estimate its speed
+		std::vector<double> lSentAt(mProcessSize, 0.);
+		//Time of the last sending or heartbeat of each evaluator, to detect the unresponsive ones
+		std::vector<double> lLastHeard(mProcessSize, MPI_Wtime());
+		//Number of evaluators working on each individual
+		std::vector<unsigned int> lCopies(ioDeme.size(), 0);
+		//Individuals of the unresponsive evaluators (-4 in lProcess), to send again
+		std::vector<unsigned int> lRetry;
+		const double lWorkerTimeout = mWorkerTimeout->getWrappedValue();
+		double lNextCheck = 0.;
+		unsigned int lNbPending = 0;
+		for(unsigned int i = 0; i < ioDeme.size(); ++i) {
+			if((ioDeme[i]->getFitness() == NULL) || (ioDeme[i]->getFitness()->isValid() == false)) ++lNbPending;
+		}
+		if(lNbPending == 0) lAllSent = true;
+		//With over-provisioning, the deme is closed once all but the last ec.mpi.overprov fitnesses are received
+		const unsigned int lNbExtra = mOverProvision->getWrappedValue();
+		const unsigned int lNbRequired = (lNbPending > lNbExtra) ? lNbPending-lNbExtra : lNbPending;
+		
+		while( ((lNbReceived < lNbSent) || !lAllSent) && (lNbReceived < lNbRequired) ) {
+			lProcessIdx = mScheduler->selectWorker(lProcess);
+			bool lReached = true;
+			if((!lAllSent || !lRetry.empty()) && (lProcessIdx != lProcess.size())) {
+				//There is a process idle
+				const unsigned int lChunkSize =
+					lChunked ? mScheduler->getChunkSize(lNbPending-lNbSent+lRetry.size(), mProcessSize-1, lProcessIdx) : 1;
+				std::vector<unsigned int>& lIndices = lChunks[lProcessIdx];
+				//Individuals of unresponsive evaluators first
+				while((lIndices.size() < lChunkSize) && !lRetry.empty()) {
+					const unsigned int lIndex = lRetry.back();
+					lRetry.pop_back();
+					if((ioDeme[lIndex]->getFitness() != NULL) && ioDeme[lIndex]->getFitness()->isValid()) continue;
+					lIndices.push_back(lIndex);
+					++lCopies[lIndex];
+				}
+				unsigned int lNbNew = 0;
+				while(!lAllSent && (lIndices.size() < lChunkSize) && (lCurrentIndividual < ioDeme.size())) {
+					selectIndividual(ioDeme, lOrder, lCurrentIndividual, lCosts, lProcessIdx, lNbPending-lNbSent-lNbNew);
+					const unsigned int lIndex = lOrder[lCurrentIndividual++];
+					if((ioDeme[lIndex]->getFitness() != NULL) && ioDeme[lIndex]->getFitness()->isValid()) continue;
+					Beagle_LogVerboseM(   
+									   ioContext.getSystem().getLogger(),
+									   "evaluation", "Beagle::MPIEvaluationOp",
+									   std::string("Evaluating the fitness of the ")+uint2ordinal(lIndex+1)+
+									   " individual"
+									   );
+					lIndices.push_back(lIndex);
+					lCopies[lIndex] = 1;
+					++lNbNew;
+				}
+				if((lCurrentIndividual >= ioDeme.size()) || (lNbSent+lNbNew >= lNbPending)) {
+					lAllSent = true;
+				}
+				if(!lIndices.empty()) {
+					lSentAt[lProcessIdx] = lLastHeard[lProcessIdx] = MPI_Wtime();
+					lReached = sendAssignment(ioDeme, ioContext, lIndices, lProcessIdx, lChunked);
+					lProcess[lProcessIdx] = lIndices.front();
+					lNbSent += lNbNew;
+				}
+			} else if(lAllSent && (mBackupCopies->getWrappedValue() > 0) && (lProcessIdx != lProcess.size())) {
+				//Duplicate the oldest outstanding evaluation on the idle evaluator
+				unsigned int lOldest = lProcess.size();
+				for(unsigned int i = 1; i < lProcess.size(); ++i) {
+					if((lProcess[i] < 0) || lChunks[i].empty()) continue;
+					const Individual& lIndividual = *ioDeme[lChunks[i].front()];
+					if((lIndividual.getFitness() != NULL) && lIndividual.getFitness()->isValid()) continue;
+					if(lCopies[lChunks[i].front()] > mBackupCopies->getWrappedValue()) continue;
+					if((lOldest == lProcess.size()) || (lSentAt[i] < lSentAt[lOldest])) lOldest = i;
 				}
+				if(lOldest != lProcess.size()) {
+					Beagle_LogDetailedM(
+										ioContext.getSystem().getLogger(),
+										"evaluation", "Beagle::MPIEvaluationOp",
+										std::string("Sending a backup copy of the work of the ")+uint2ordinal(lOldest)+
+										std::string(" evaluator to the ")+uint2ordinal(lProcessIdx)+" evaluator"
+										);
+					lChunks[lProcessIdx] = lChunks[lOldest];
+					for(unsigned int i = 0; i < lChunks[lProcessIdx].size(); ++i) ++lCopies[lChunks[lProcessIdx][i]];
+					lSentAt[lProcessIdx] = lLastHeard[lProcessIdx] = MPI_Wtime();
+					lReached = sendAssignment(ioDeme, ioContext, lChunks[lProcessIdx], lProcessIdx, lChunked);
+					lProcess[lProcessIdx] = lChunks[lProcessIdx].front();
+				}
+			}
+			if(!lReached) {
+				//Send the individuals of the lost evaluator to other ones
+				markWorkerLost(lProcessIdx, ioContext);
+				for(unsigned int i = 0; i < lChunks[lProcessIdx].size(); ++i) {
+					lRetry.push_back(lChunks[lProcessIdx][i]);
+					--lCopies[lChunks[lProcessIdx][i]];
+				}
+				lChunks[lProcessIdx].clear();
+				lProcess[lProcessIdx] = -5;
 			}
 			
 			//Look if any cruncher sent a fitness back
 			MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &lFlag, &lStatus);
-			if (lFlag) {
-				//Receive the evaluated fitness
-				lSource = lStatus.MPI_SOURCE;
-				MPI_Recv(&lMessageSize, 1, MPI_INT, lSource, eMessageSize, MPI_COMM_WORLD, &lStatus);
-				char *lMessage = new char[lMessageSize];
-				MPI_Recv(lMessage, lMessageSize, MPI_CHAR, lSource, eFitness, MPI_COMM_WORLD, &lStatus);
-				lRecvIndividualIdx = lProcess[lSource];
+			if(!lFlag) {
+				if((lWorkerTimeout > 0.) && (MPI_Wtime() >= lNextCheck)) {
+					//Send the individuals of the unresponsive evaluators to other ones
+					const double lNow = MPI_Wtime();
+					lNextCheck = lNow + std::min(1., lWorkerTimeout/10.);
+					for(int i = 1; i < mProcessSize; ++i) {
+						if((lProcess[i] == -3) || (lProcess[i] == -4)) {
+							//Still silent after a second timeout, or owing a reply that never comes
+							const double lLimit = 2.*lWorkerTimeout*std::max<std::size_t>(lChunks[i].size(), 1);
+							if(lNow-lLastHeard[i] <= lLimit) continue;
+							Beagle_LogInfoM(
+											ioContext.getSystem().getLogger(),
+											"evaluation", "Beagle::MPIEvaluationOp",
+											std::string("The ")+uint2ordinal(i)+std::string(" evaluator is still silent after ")+
+											dbl2str(lNow-lLastHeard[i])+" seconds, dropping it"
+											);
+							for(unsigned int j = 0; j < lChunks[i].size(); ++j) --lCopies[lChunks[i][j]];
+							lChunks[i].clear();
+							lProcess[i] = -5;
+							markWorkerLost(i, ioContext);
+							continue;
+						}
+						if((lProcess[i] < 0) || (lNow-lLastHeard[i] <= lWorkerTimeout*lChunks[i].size())) continue;
+						Beagle_LogInfoM(
+										ioContext.getSystem().getLogger(),
+										"evaluation", "Beagle::MPIEvaluationOp",
+										std::string("The ")+uint2ordinal(i)+std::string(" evaluator was silent for ")+
+										dbl2str(lNow-lLastHeard[i])+" seconds, sending its individuals to other evaluators"
+										);
+						for(unsigned int j = 0; j < lChunks[i].size(); ++j) lRetry.push_back(lChunks[i][j]);
+						lProcess[i] = -4;
+					}
+				}
+				continue;
+			}
+			lSource = lStatus.MPI_SOURCE;
+			if(lStatus.MPI_TAG == eHeartbeat) {
+				MPI_Recv(NULL, 0, MPI_CHAR, lSource, eHeartbeat, MPI_COMM_WORLD, &lStatus);
+				lLastHeard[lSource] = MPI_Wtime();
+				continue;
+			}
+			if(lProcess[lSource] == -3) {
+				//Late reply of a copy sent during a previous deme
+				discardReply(lSource, lStatus.MPI_TAG);
+				mPendingReply[lSource] = false;
 				lProcess[lSource] = -1;
-				++lNbReceived;
-				
+				continue;
+			}
+			if(lProcess[lSource] == -5) {
+				//Late reply of an evaluator dropped as unresponsive
+				discardReply(lSource, lStatus.MPI_TAG);
+				continue;
+			}
+			const double lRoundTrip = MPI_Wtime()-lSentAt[lSource];
+			std::vector<unsigned int>& lIndices = lChunks[lSource];
+			unsigned int lNbAssigned = 0;
+			if(lChunked) {
+				//Receive the fitnesses of a chunk
+				unsigned int lSize;
+				MPI_Recv(&lMessageSize, 1, MPI_INT, lSource, eMessageSize, MPI_COMM_WORLD, &lStatus);
+				const char* lMessage = receiveMessage(lSource, eFitnessBlock, lMessageSize, lSize);
+				double lEvaluationTime;
+				lNbAssigned = assignFitnessBlock(ioDeme, lMessage, lSize, lDecoder, ioContext, lEvaluationTime);
+				mScheduler->recordChunk(lIndices.size(), lRoundTrip, lEvaluationTime);
 				Beagle_LogTraceM(
-								   ioContext.getSystem().getLogger(),
-								   "evaluation", "Beagle::MPIEvaluationOp",
-								   std::string("Receiving the fitness of the ") + uint2ordinal(lRecvIndividualIdx+1) + 
-								   std::string(" individual from ")+uint2ordinal(lSource) + std::string(" evaluator")
-								   );
-				
-				//Read the received fitness
-				std::istringstream lStreamIn(lMessage);
-				PACC::XML::Document lXMLParser;
-
-				lXMLParser.parse(lStreamIn);
-				
-				Fitness::Handle lFitness = castHandleT<Fitness>(ioDeme[lRecvIndividualIdx]->getFitnessAlloc()->allocate());
-				PACC::XML::ConstIterator lFitnessRootNode = lXMLParser.getFirstRoot(); 
-
-				lFitness->read(lFitnessRootNode);
-				
-				//Free message space
-				delete [] lMessage;
-				
-				//Assign the fitness
-				ioDeme[lRecvIndividualIdx]->setFitness(lFitness);
-				ioDeme[lRecvIndividualIdx]->getFitness()->setValid();
-				
-				//Update stats
-				ioContext.setProcessedDeme(ioContext.getProcessedDeme()+1);
-				ioContext.setTotalProcessedDeme(ioContext.getTotalProcessedDeme()+1);
-				ioContext.setProcessedVivarium(ioContext.getProcessedVivarium()+1);
-				ioContext.setTotalProcessedVivarium(ioContext.getTotalProcessedVivarium()+1);  
-				
-				Beagle_LogDebugM(
 								 ioContext.getSystem().getLogger(),
 								 "evaluation", "Beagle::MPIEvaluationOp",
-								 std::string("Received fitness of individual: ")+
-								 ioDeme[lRecvIndividualIdx]->serialize()
+								 std::string("Received ") + uint2str(lIndices.size()) + std::string(" fitnesses from ")+
+								 uint2ordinal(lSource) + std::string(" evaluator")
 								 );
-				
-				Beagle_LogDebugM(
+			} else {
+				//Receive the evaluated fitness
+				unsigned int lFitnessSize;
+				const char* lMessage = receiveFitness(lSource, lStatus.MPI_TAG, lFitnessSize);
+				const unsigned int lIndex = lIndices.front();
+				Beagle_LogTraceM(
 								   ioContext.getSystem().getLogger(),
 								   "evaluation", "Beagle::MPIEvaluationOp",
-								   std::string("The individual\'s fitness is: ")+
-								   ioDeme[lRecvIndividualIdx]->getFitness()->serialize()
+								   std::string("Receiving the fitness of the ") + uint2ordinal(lIndex+1) + 
+								   std::string(" individual from ")+uint2ordinal(lSource) + std::string(" evaluator")
 								   );
+				if((ioDeme[lIndex]->getFitness() == NULL) || (ioDeme[lIndex]->getFitness()->isValid() == false)) {
+					assignFitness(ioDeme, lIndex, lMessage, lFitnessSize, lDecoder, ioContext);
+					lNbAssigned = 1;
+				}
 			}
-		}
+			if(lNbAssigned < lIndices.size()) {
+				Beagle_LogDetailedM(
+									ioContext.getSystem().getLogger(),
+									"evaluation", "Beagle::MPIEvaluationOp",
+									std::string("Discarding ")+uint2str(lIndices.size()-lNbAssigned)+
+									std::string(" fitnesses already received from another evaluator")
+									);
+			}
+			double lCost = 0.;
+			for(unsigned int i = 0; i < lIndices.size(); ++i) {
+				lCost += lCosts[lIndices[i]];
+				--lCopies[lIndices[i]];
+			}
+			mScheduler->recordWorker(lSource, lCost, lRoundTrip);
+			if(mEarlyTermination->getWrappedValue() && (lNbAssigned > 0)) {
+				for(unsigned int i = 0; (i < lIndices.size()) && !mTerminationMet; ++i) {
+					mTerminationMet = isTerminationMet(ioDeme[lIndices[i]], ioContext);
+				}
+			}
+			lIndices.clear();
+			lProcess[lSource] = -1;
+			lNbReceived += lNbAssigned;
+			if(mTerminationMet) break;
+		}
+		
+		if(mTerminationMet) {
+			//Stop the evaluations in progress, their replies are drained during the next deme if any
+			unsigned int lNbCancelled = 0;
+			for(int i = 1; i < mProcessSize; ++i) {
+				if((lProcess[i] < 0) && (lProcess[i] != -4)) continue;
+				MPI_Send(NULL, 0, MPI_CHAR, i, eCancel, MPI_COMM_WORLD);
+				++lNbCancelled;
+			}
+			Beagle_LogDetailedM(
+								ioContext.getSystem().getLogger(),
+								"evaluation", "Beagle::MPIEvaluationOp",
+								std::string("Termination criterion met, cancelling the work of ")+uint2str(lNbCancelled)+
+								" evaluators"
+								);
+		}
+		
+		if(lNbReceived < lNbPending) {
+			Beagle_LogDetailedM(
+								ioContext.getSystem().getLogger(),
+								"evaluation", "Beagle::MPIEvaluationOp",
+								std::string("Closing the deme after ")+uint2str(lNbReceived)+std::string(" fitnesses, ")+
+								uint2str(lNbPending-lNbReceived)+" individuals are left unevaluated"
+								);
+		}
+		//The evaluators still working on copies or on dropped individuals reply during the next deme
+		for(int i = 1; i < mProcessSize; ++i) {
+			mPendingReply[i] = (lProcess[i] >= 0) || (lProcess[i] == -3) || (lProcess[i] == -4);
+		}
 	} catch(Exception& inException) {
 		std::cerr << "Exception catched in evolver:" << std::endl << std::flush;
 		std::cerr << inException.what() << std::endl << std::flush;
-		exit(1);
+		MPI_Abort(MPI_COMM_WORLD, 1);
 	}
 	catch(std::exception& inException) {
 		std::cerr << "Standard exception catched in evolver:" << std::endl << std::flush;
 		std::cerr << inException.what() << std::endl << std::flush;
-		exit(1);
+		MPI_Abort(MPI_COMM_WORLD, 1);
 	}
 }
 
+/*!
+ *  \brief Send individuals to an evaluator, alone or as a chunk.
+ *  \param ioDeme Deme being evaluated.
+ *  \param ioContext Evolutionary context.
+ *  \param inIndices Deme indices of the individuals.
+ *  \param inDestination Rank of the evaluator.
+ *  \param inChunked True to send a chunk, even of one individual, false to send a single individual.
+ *  \return False if the evaluator could not be reached.
+ */
+bool Beagle::MPI::EvaluationOp::sendAssignment(Deme& ioDeme, Context& ioContext, const std::vector<unsigned int>& inIndices,
+											   int inDestination, bool inChunked)
+{
+	if(!inChunked) {
+		const unsigned int lIndex = inIndices.front();
+		ioContext.setIndividualIndex(lIndex);
+		ioContext.setIndividualHandle(ioDeme[lIndex]);
+		Beagle_LogTraceM(
+						 ioContext.getSystem().getLogger(),
+						 "evaluation", "Beagle::MPIEvaluationOp",
+						 std::string("Sending the ") + uint2ordinal(lIndex+1) + std::string(" individual to ")+
+						 uint2ordinal(inDestination) + std::string(" evaluator")
+						 );
+		encodeIndividual(*ioDeme[lIndex], inDestination, ioContext, mIndividualOut);
+		return sendIndividual(mIndividualOut, inDestination, ioContext.getGeneration());
+	}
+	mBlockOut.clear();
+	appendUInt(mBlockOut, ioContext.getGeneration());
+	appendUInt(mBlockOut, inIndices.size());
+	for(unsigned int i = 0; i < inIndices.size(); ++i) {
+		ioContext.setIndividualIndex(inIndices[i]);
+		ioContext.setIndividualHandle(ioDeme[inIndices[i]]);
+		encodeIndividual(*ioDeme[inIndices[i]], inDestination, ioContext, mIndividualOut);
+		appendUInt(mBlockOut, inIndices[i]);
+		appendUInt(mBlockOut, mIndividualOut.size());
+		mBlockOut.append(mIndividualOut);
+	}
+	Beagle_LogTraceM(
+					 ioContext.getSystem().getLogger(),
+					 "evaluation", "Beagle::MPIEvaluationOp",
+					 std::string("Sending a chunk of ") + uint2str(inIndices.size()) + std::string(" individuals to ")+
+					 uint2ordinal(inDestination) + std::string(" evaluator")
+					 );
+	return sendMessage(mBlockOut.data(), mBlockOut.size(), inDestination, eBlock);
+}
+
+/*!
+ *  \brief Drop an evaluator that could not be reached for the rest of the evolution.
+ *  \param inRank Rank of the evaluator.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::EvaluationOp::markWorkerLost(int inRank, Context& ioContext)
+{
+	Beagle_LogBasicM(
+					 ioContext.getSystem().getLogger(),
+					 "evaluation", "Beagle::MPIEvaluationOp",
+					 std::string("The ")+uint2ordinal(inRank)+" evaluator cannot be reached, continuing without it"
+					 );
+	mLostWorkers[inRank] = true;
+	mPendingReply[inRank] = false;
+	//The work queue cannot take back the individuals claimed by a lost evaluator
+	mQueueDisabled = true;
+	if(std::count(mLostWorkers.begin()+1, mLostWorkers.end(), true) == mProcessSize-1) {
+		throw Beagle_RunTimeExceptionM(std::string("No evaluator left to evaluate the individuals, the ")+
+									   int2str(mProcessSize-1)+" evaluators were all lost");
+	}
+}
+
+/*!
+ *  \brief Receive and drop the reply of an evaluator, once probed.
+ *  \param inSource Rank of the evaluator.
+ *  \param inTag Tag of the probed message.
+ */
+void Beagle::MPI::EvaluationOp::discardReply(int inSource, int inTag)
+{
+	MPI_Status lStatus;
+	int lSize;
+	if(inTag == eSharedFitness) {
+		MPI_Recv(&lSize, 1, MPI_INT, inSource, eSharedFitness, MPI_COMM_WORLD, &lStatus);
+		return;
+	}
+	MPI_Recv(&lSize, 1, MPI_INT, inSource, eMessageSize, MPI_COMM_WORLD, &lStatus);
+	MPI_Probe(inSource, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
+	mReceiveBuffer.resize(std::max(lSize, 1));
+	MPI_Recv(&mReceiveBuffer[0], lSize, MPI_CHAR, inSource, lStatus.MPI_TAG, MPI_COMM_WORLD, &lStatus);
+}
+
+/*!
+ *  \brief Distribute the evaluation of a deme through the work queue.
+ *  \param ioDeme Deme to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \return False if the individuals were not all evaluated through the queue,
+ *    the others being then sent to the evaluators.
+ *
+ *  The individuals are published in the work queue and each evaluator is
+ *  notified once. The evaluators then take the individuals themselves while
+ *  rank 0 polls the queue, with a growing sleep while nothing changes, and
+ *  assigns the fitnesses as they are written. With ec.mpi.worker.timeout, an
+ *  individual claimed for longer than the timeout without a heartbeat of its
+ *  evaluator drops that evaluator. The queue is then closed and the queue is
+ *  no longer used, the individuals left being sent to the evaluators as the
+ *  queue cannot take back the claims of a lost evaluator. The queue is also
+ *  closed when ec.mpi.term.early is set and a termination criterion is met,
+ *  the evaluations in progress being cancelled.
+ */
+bool Beagle::MPI::EvaluationOp::distributeQueue(Deme& ioDeme, Context& ioContext) {
+	mTerminationMet = false;
+	if(mQueueDisabled) return false;
+	bool lFallback = false;
+	try {
+		std::vector<unsigned int> lPending;
+		for(unsigned int i = 0; i < ioDeme.size(); ++i) {
+			if((ioDeme[i]->getFitness() == NULL) || (ioDeme[i]->getFitness()->isValid() == false)) lPending.push_back(i);
+		}
+		std::vector<double> lCosts;
+		scheduleIndividuals(ioDeme, ioContext, lPending, lCosts);
+		std::vector<std::string> lMessages(lPending.size());
+		for(unsigned int i = 0; i < lPending.size(); ++i) {
+			encodeIndividual(*ioDeme[lPending[i]], -1, ioContext, lMessages[i]);
+		}
+		if(lPending.empty()) return true;
+		if(!mWorkQueue->publish(lMessages, ioContext.getGeneration())) {
+			Beagle_LogDetailedM(
+							   ioContext.getSystem().getLogger(),
+							   "evaluation", "Beagle::MPIEvaluationOp",
+							   "Individuals too large for the work queue, sending them to the evaluators"
+							   );
+			return false;
+		}
+		
+		int lCount = lPending.size();
+		std::vector<bool> lNotified(mProcessSize, false);
+		mPendingReply.resize(mProcessSize, false);
+		mLostWorkers.resize(mProcessSize, false);
+		for(int i = 1; i < mProcessSize; ++i) {
+			if(mLostWorkers[i]) continue;
+			if(MPI_Send(&lCount, 1, MPI_INT, i, ePullRound, MPI_COMM_WORLD) == MPI_SUCCESS) lNotified[i] = true;
+			else markWorkerLost(i, ioContext);
+		}
+		Beagle_LogTraceM(
+						 ioContext.getSystem().getLogger(),
+						 "evaluation", "Beagle::MPIEvaluationOp",
+						 uint2str(lPending.size())+std::string(" individuals published in the work queue")
+						 );
+		
+		XMLStreamDecoder lDecoder;
+		const double lWorkerTimeout = mWorkerTimeout->getWrappedValue();
+		std::vector<double> lLastHeard(mProcessSize, MPI_Wtime());
+		std::vector<double> lClaimedAt(lPending.size(), -1.);
+		std::vector<bool> lCollected(lPending.size(), false);
+		std::vector<bool> lExpired(lPending.size(), false);
+		unsigned int lNbClaimed = lPending.size();
+		bool lClosed = false;
+		double lSleep = 1e-4;
+		while(true) {
+			mWorkQueue->refresh();
+			const double lNow = MPI_Wtime();
+			bool lProgress = false;
+			
+			//Assign the fitnesses written since the last poll
+			for(unsigned int i = 0; i < lPending.size(); ++i) {
+				if(lCollected[i] || !mWorkQueue->isDone(i)) continue;
+				lCollected[i] = true;
+				lProgress = true;
+				//Replies written after the termination are dropped with their individuals
+				if(mTerminationMet) continue;
+				unsigned int lFitnessSize;
+				const char* lMessage = mWorkQueue->getFitness(i, lFitnessSize);
+				assignFitness(ioDeme, lPending[i], lMessage, lFitnessSize, lDecoder, ioContext);
+				if(mEarlyTermination->getWrappedValue()) mTerminationMet = isTerminationMet(ioDeme[lPending[i]], ioContext);
+			}
+			
+			//Heartbeats of the evaluators under a watchdog
+			int lFlag;
+			MPI_Status lStatus;
+			MPI_Iprobe(MPI_ANY_SOURCE, eHeartbeat, MPI_COMM_WORLD, &lFlag, &lStatus);
+			while(lFlag) {
+				MPI_Recv(NULL, 0, MPI_CHAR, lStatus.MPI_SOURCE, eHeartbeat, MPI_COMM_WORLD, &lStatus);
+				lLastHeard[lStatus.MPI_SOURCE] = lNow;
+				MPI_Iprobe(MPI_ANY_SOURCE, eHeartbeat, MPI_COMM_WORLD, &lFlag, &lStatus);
+			}
+			
+			//Deadline of the claims left unanswered
+			const unsigned int lNbSeen = std::min(mWorkQueue->getNbClaimed(), lNbClaimed);
+			for(unsigned int i = 0; i < lNbSeen; ++i) {
+				if(lCollected[i] || lExpired[i]) continue;
+				if(lClaimedAt[i] < 0.) lClaimedAt[i] = lNow;
+				if(lWorkerTimeout <= 0.) continue;
+				const int lOwner = mWorkQueue->getOwner(i);
+				if((lOwner > 0) && mLostWorkers[lOwner]) continue;
+				const double lLast = (lOwner > 0) ? std::max(lClaimedAt[i], lLastHeard[lOwner]) : lClaimedAt[i];
+				if(lNow-lLast <= lWorkerTimeout) continue;
+				lExpired[i] = true;
+				Beagle_LogBasicM(
+								 ioContext.getSystem().getLogger(),
+								 "evaluation", "Beagle::MPIEvaluationOp",
+								 std::string("The ")+uint2ordinal(i+1)+" individual of the work queue is still unanswered after the timeout"
+								 );
+				if(lOwner > 0) markWorkerLost(lOwner, ioContext);
+				lFallback = true;
+			}
+			
+			//Stop handing out individuals
+			if((mTerminationMet || lFallback) && !lClosed) {
+				lClosed = true;
+				lNbClaimed = mWorkQueue->close();
+				if(mTerminationMet) {
+					std::vector<bool> lCancelled(mProcessSize, false);
+					for(unsigned int i = 0; i < lNbClaimed; ++i) {
+						const int lOwner = mWorkQueue->getOwner(i);
+						if(lCollected[i] || (lOwner <= 0) || mLostWorkers[lOwner] || lCancelled[lOwner]) continue;
+						MPI_Send(NULL, 0, MPI_CHAR, lOwner, eCancel, MPI_COMM_WORLD);
+						lCancelled[lOwner] = true;
+					}
+					Beagle_LogDetailedM(
+									   ioContext.getSystem().getLogger(),
+									   "evaluation", "Beagle::MPIEvaluationOp",
+									   "Termination criterion met, closing the work queue"
+									   );
+				}
+				lProgress = true;
+			}
+			
+			//Every claim must be answered, or abandoned with its evaluator
+			bool lAnswered = true;
+			for(unsigned int i = 0; (i < lNbClaimed) && lAnswered; ++i) {
+				const int lOwner = mWorkQueue->getOwner(i);
+				lAnswered = lCollected[i] || lExpired[i] || ((lOwner > 0) && mLostWorkers[lOwner]);
+			}
+			if(lAnswered) {
+				//The evaluators still reachable must have left the queue before it is published again
+				unsigned int lNbLive = 0;
+				for(int i = 1; i < mProcessSize; ++i) if(lNotified[i] && !mLostWorkers[i]) ++lNbLive;
+				if(lFallback || (mWorkQueue->getNbExited() >= lNbLive)) break;
+			}
+			
+			if(lProgress) lSleep = 1e-4;
+			else {
+				usleep(static_cast<useconds_t>(lSleep*1e6));
+				lSleep = std::min(2.*lSleep, 0.01);
+			}
+		}
+	} catch(Exception& inException) {
+		std::cerr << "Exception catched in evolver:" << std::endl << std::flush;
+		std::cerr << inException.what() << std::endl << std::flush;
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	catch(std::exception& inException) {
+		std::cerr << "Standard exception catched in evolver:" << std::endl << std::flush;
+		std::cerr << inException.what() << std::endl << std::flush;
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	if(lFallback) mQueueDisabled = true;
+	if(lFallback && !mTerminationMet) {
+		Beagle_LogDetailedM(
+						   ioContext.getSystem().getLogger(),
+						   "evaluation", "Beagle::MPIEvaluationOp",
+						   "Evaluator lost, sending the individuals left to the evaluators"
+						   );
+		return false;
+	}
+	return true;
+}
+
+/*!
+ *  \brief Distribute the evaluation of a deme through the sub-masters of the hierarchy.
+ *  \param ioDeme Deme to evaluate.
+ *  \param ioContext Evolutionary context.
+ *
+ *  The sub-masters receive blocks of individuals, two blocks being kept in
+ *  flight for each so that its workers do not wait for the next one. The block
+ *  size shrinks with the number of individuals left to balance the end of the
+ *  generation. Workers served directly receive one individual at a time.
+ */
+void Beagle::MPI::EvaluationOp::distributeBlocks(Deme& ioDeme, Context& ioContext) {
+	try {
+		std::string lMessageOut;
+		std::string lBlock;
+		XMLStreamDecoder lDecoder;
+		prepareCompressor(ioContext);
+		
+		int lMessageSize;
+		MPI_Status lStatus;
+		int lFlag;
+		
+		std::vector<unsigned int> lPending;
+		for(unsigned int i = 0; i < ioDeme.size(); ++i) {
+			if((ioDeme[i]->getFitness() == NULL) || (ioDeme[i]->getFitness()->isValid() == false)) lPending.push_back(i);
+		}
+		std::vector<double> lCosts;
+		scheduleIndividuals(ioDeme, ioContext, lPending, lCosts);
+		const std::vector<int>& lChildren = mHierarchy->getChildren();
+		unsigned int lNbWorkers = 0;
+		for(unsigned int i = 0; i < lChildren.size(); ++i) {
+			lNbWorkers += std::max(1u, mHierarchy->getNbWorkers(lChildren[i]));
+		}
+		std::vector<unsigned int> lOutstanding(mProcessSize, 0);
+		std::vector<unsigned int> lAssigned(mProcessSize, 0);
+		//Child holding each individual, to send again the individuals of the lost children
+		std::vector<int> lHolder(ioDeme.size(), -1);
+		std::vector<unsigned int> lRetry;
+		mPendingReply.resize(mProcessSize, false);
+		mLostWorkers.resize(mProcessSize, false);
+		unsigned int lGeneration = ioContext.getGeneration();
+		unsigned int lNext = 0;
+		unsigned int lNbReceived = 0;
+		
+		while(lNbReceived < lPending.size()) {
+			for(unsigned int c = 0; (c < lChildren.size()) && ((lNext < lPending.size()) || !lRetry.empty()); ++c) {
+				const int lChild = lChildren[c];
+				if(mLostWorkers[lChild]) continue;
+				const unsigned int lChildWorkers = mHierarchy->getNbWorkers(lChild);
+				bool lReached = true;
+				if(lChildWorkers == 0) {
+					if(lOutstanding[lChild] > 0) continue;
+					unsigned int lIndex;
+					if(lRetry.empty()) lIndex = lPending[lNext++];
+					else {
+						lIndex = lRetry.back();
+						lRetry.pop_back();
+					}
+					ioContext.setIndividualIndex(lIndex);
+					ioContext.setIndividualHandle(ioDeme[lIndex]);
+					encodeIndividual(*ioDeme[lIndex], lChild, ioContext, lMessageOut);
+					lHolder[lIndex] = lChild;
+					lAssigned[lChild] = lIndex;
+					lOutstanding[lChild] = 1;
+					lReached = sendIndividual(lMessageOut, lChild, lGeneration);
+				}
+				while(lReached && (lChildWorkers > 0) && (lOutstanding[lChild] < 2) &&
+					  ((lNext < lPending.size()) || !lRetry.empty())) {
+					const unsigned int lRemaining = lPending.size()-lNext+lRetry.size();
+					unsigned int lBlockSize = std::min(mHierarchy->getBlockFactor()*lChildWorkers,
+													   lRemaining*lChildWorkers/lNbWorkers);
+					lBlockSize = std::min(std::max(lBlockSize, 1u), lRemaining);
+					lBlock.clear();
+					appendUInt(lBlock, lGeneration);
+					appendUInt(lBlock, lBlockSize);
+					for(unsigned int i = 0; i < lBlockSize; ++i) {
+						unsigned int lIndex;
+						if(lRetry.empty()) lIndex = lPending[lNext++];
+						else {
+							lIndex = lRetry.back();
+							lRetry.pop_back();
+						}
+						lHolder[lIndex] = lChild;
+						ioContext.setIndividualIndex(lIndex);
+						ioContext.setIndividualHandle(ioDeme[lIndex]);
+						encodeIndividual(*ioDeme[lIndex], lChild, ioContext, lMessageOut);
+						appendUInt(lBlock, lIndex);
+						appendUInt(lBlock, lMessageOut.size());
+						lBlock.append(lMessageOut);
+					}
+					Beagle_LogTraceM(
+									 ioContext.getSystem().getLogger(),
+									 "evaluation", "Beagle::MPIEvaluationOp",
+									 std::string("Sending a block of ") + uint2str(lBlockSize) + std::string(" individuals to the ")+
+									 uint2ordinal(lChild) + std::string(" process")
+									 );
+					++lOutstanding[lChild];
+					lReached = sendMessage(lBlock.data(), lBlock.size(), lChild, eBlock);
+				}
+				if(lReached) continue;
+				//Send the unevaluated individuals of the lost child to the other ones
+				markWorkerLost(lChild, ioContext);
+				lOutstanding[lChild] = 0;
+				for(unsigned int i = 0; i < lPending.size(); ++i) {
+					const unsigned int lIndex = lPending[i];
+					if(lHolder[lIndex] != lChild) continue;
+					if((ioDeme[lIndex]->getFitness() != NULL) && ioDeme[lIndex]->getFitness()->isValid()) continue;
+					lHolder[lIndex] = -1;
+					lRetry.push_back(lIndex);
+				}
+				bool lAllLost = true;
+				for(unsigned int i = 0; i < lChildren.size(); ++i) lAllLost = lAllLost && mLostWorkers[lChildren[i]];
+				if(lAllLost) throw Beagle_RunTimeExceptionM("No evaluator left to evaluate the individuals");
+			}
+			
+			//Look if any child sent fitnesses back
+			MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &lFlag, &lStatus);
+			if(!lFlag) continue;
+			const int lSource = lStatus.MPI_SOURCE;
+			if(lStatus.MPI_TAG == eHeartbeat) {
+				MPI_Recv(NULL, 0, MPI_CHAR, lSource, eHeartbeat, MPI_COMM_WORLD, &lStatus);
+				continue;
+			}
+			if(mLostWorkers[lSource]) {
+				//Late reply of a lost child, whose individuals were sent again
+				discardReply(lSource, lStatus.MPI_TAG);
+				continue;
+			}
+			unsigned int lSize;
+			if(mHierarchy->getNbWorkers(lSource) == 0) {
+				const char* lMessage = receiveFitness(lSource, lStatus.MPI_TAG, lSize);
+				assignFitness(ioDeme, lAssigned[lSource], lMessage, lSize, lDecoder, ioContext);
+				lOutstanding[lSource] = 0;
+				++lNbReceived;
+			} else {
+				MPI_Recv(&lMessageSize, 1, MPI_INT, lSource, eMessageSize, MPI_COMM_WORLD, &lStatus);
+				const char* lMessage = receiveMessage(lSource, eFitnessBlock, lMessageSize, lSize);
+				double lEvaluationTime;
+				const unsigned int lNbFitnesses = assignFitnessBlock(ioDeme, lMessage, lSize, lDecoder, ioContext, lEvaluationTime);
+				Beagle_LogTraceM(
+								 ioContext.getSystem().getLogger(),
+								 "evaluation", "Beagle::MPIEvaluationOp",
+								 std::string("Received ") + uint2str(lNbFitnesses) + std::string(" fitnesses from the ")+
+								 uint2ordinal(lSource) + std::string(" process")
+								 );
+				--lOutstanding[lSource];
+				lNbReceived += lNbFitnesses;
+			}
+		}
+	} catch(Exception& inException) {
+		std::cerr << "Exception catched in evolver:" << std::endl << std::flush;
+		std::cerr << inException.what() << std::endl << std::flush;
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	catch(std::exception& inException) {
+		std::cerr << "Standard exception catched in evolver:" << std::endl << std::flush;
+		std::cerr << inException.what() << std::endl << std::flush;
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+}
+
+/*!
+ *  \brief Dispatch the blocks received from rank 0 to the workers of this sub-master.
+ *  \param ioContext Evolutionary context.
+ *
+ *  The fitnesses of a block are sent back to rank 0 together, once all of them
+ *  are received.
+ */
+void Beagle::MPI::EvaluationOp::subMasterOperate(Context& ioContext) {
+	try {
+		prepareCompressor(ioContext);
+		const std::vector<int>& lWorkers = mHierarchy->getChildren();
+		std::deque<BlockItem> lQueue;
+		std::map<unsigned int,OpenBlock> lBlocks;
+		std::map<int,std::pair<unsigned int,unsigned int> > lInFlight;
+		std::vector<bool> lLost(mProcessSize, false);
+		unsigned int lNbLost = 0;
+		unsigned int lNextBlock = 0;
+		int lMessageSize;
+		MPI_Status lStatus;
+		
+		bool lDone = false;
+		while(!lDone) {
+			//Feed the idle workers
+			for(unsigned int i = 0; (i < lWorkers.size()) && !lQueue.empty(); ++i) {
+				if(lLost[lWorkers[i]] || (lInFlight.find(lWorkers[i]) != lInFlight.end())) continue;
+				const BlockItem& lItem = lQueue.front();
+				if(!sendIndividual(lItem.mMessage, lWorkers[i], lBlocks[lItem.mBlock].mGeneration)) {
+					//The individual stays first in the queue for the next worker
+					Beagle_LogBasicM(
+									 ioContext.getSystem().getLogger(),
+									 "evaluation", "Beagle::MPIEvaluationOp",
+									 std::string("The ")+uint2ordinal(lWorkers[i])+" worker cannot be reached, continuing without it"
+									 );
+					lLost[lWorkers[i]] = true;
+					++lNbLost;
+					continue;
+				}
+				lInFlight[lWorkers[i]] = std::make_pair(lItem.mBlock, lItem.mIndex);
+				lQueue.pop_front();
+			}
+			//Without any worker left, the sub-master evaluates the individuals itself
+			while((lNbLost == lWorkers.size()) && !lQueue.empty()) {
+				const BlockItem& lItem = lQueue.front();
+				std::string lFitness;
+				ioContext.setGeneration(lBlocks[lItem.mBlock].mGeneration);
+				evaluateMessage(lItem.mMessage.data(), lItem.mMessage.size(), 0, ioContext, lFitness);
+				if(closeItem(lBlocks[lItem.mBlock], lItem.mIndex, lFitness.c_str(), lFitness.size()+1)) {
+					sendMessage(lBlocks[lItem.mBlock].mReply.data(), lBlocks[lItem.mBlock].mReply.size(), 0, eFitnessBlock);
+					lBlocks.erase(lItem.mBlock);
+				}
+				lQueue.pop_front();
+			}
+			
+			MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
+			const int lSource = lStatus.MPI_SOURCE;
+			if(lStatus.MPI_TAG == eEvolutionEnd) {
+				MPI_Recv(NULL, 0, MPI_CHAR, lSource, eEvolutionEnd, MPI_COMM_WORLD, &lStatus);
+				Beagle_LogDetailedM(
+									ioContext.getSystem().getLogger(),
+									"evaluation", "Beagle::MPIEvaluationOp",
+									std::string("End of evolution received from process ") + int2str(lSource)
+									);
+				lDone = true;
+				continue;
+			}
+			if(lStatus.MPI_TAG == eHeartbeat) {
+				MPI_Recv(NULL, 0, MPI_CHAR, lSource, eHeartbeat, MPI_COMM_WORLD, &lStatus);
+				continue;
+			}
+			if(lStatus.MPI_TAG == eRejectionBound) {
+				//Rank 0 sends the bound to the workers too
+				double lBound;
+				MPI_Recv(&lBound, 1, MPI_DOUBLE, lSource, eRejectionBound, MPI_COMM_WORLD, &lStatus);
+				continue;
+			}
+			unsigned int lSize;
+			if(lSource == 0) {
+				//New block from rank 0
+				MPI_Recv(&lMessageSize, 1, MPI_INT, lSource, eMessageSize, MPI_COMM_WORLD, &lStatus);
+				const char* lMessage = receiveMessage(0, eBlock, lMessageSize, lSize);
+				const char* lEnd = lMessage+lSize;
+				OpenBlock& lBlock = lBlocks[lNextBlock];
+				lBlock.mGeneration = readUInt(lMessage, lEnd);
+				lBlock.mRemaining = readUInt(lMessage, lEnd);
+				lBlock.mReply.clear();
+				appendUInt(lBlock.mReply, lBlock.mRemaining);
+				for(unsigned int i = 0; i < lBlock.mRemaining; ++i) {
+					lQueue.push_back(BlockItem());
+					lQueue.back().mBlock = lNextBlock;
+					lQueue.back().mIndex = readUInt(lMessage, lEnd);
+					const unsigned int lIndividualSize = readUInt(lMessage, lEnd);
+					if(lIndividualSize > static_cast<unsigned int>(lEnd-lMessage)) throw Beagle_IOExceptionMessageM("truncated block");
+					lQueue.back().mMessage.assign(lMessage, lIndividualSize);
+					lMessage += lIndividualSize;
+				}
+				Beagle_LogTraceM(
+								 ioContext.getSystem().getLogger(),
+								 "evaluation", "Beagle::MPIEvaluationOp",
+								 std::string("Received a block of ") + uint2str(lBlock.mRemaining) + std::string(" individuals")
+								 );
+				if(lBlock.mRemaining == 0) lBlocks.erase(lNextBlock);
+				++lNextBlock;
+			} else {
+				//Fitness from a worker
+				const char* lMessage = receiveFitness(lSource, lStatus.MPI_TAG, lSize);
+				std::map<int,std::pair<unsigned int,unsigned int> >::iterator lWorker = lInFlight.find(lSource);
+				if(lWorker == lInFlight.end()) {
+					throw Beagle_RunTimeExceptionM(std::string("Unexpected fitness received from process ")+int2str(lSource));
+				}
+				OpenBlock& lBlock = lBlocks[lWorker->second.first];
+				if(closeItem(lBlock, lWorker->second.second, lMessage, lSize)) {
+					sendMessage(lBlock.mReply.data(), lBlock.mReply.size(), 0, eFitnessBlock);
+					lBlocks.erase(lWorker->second.first);
+				}
+				lInFlight.erase(lWorker);
+			}
+		}
+	} catch(Exception& inException) {
+		std::cerr << "Exception catched in sub-master:" << std::endl << std::flush;
+		std::cerr << inException.what() << std::endl << std::flush;
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	catch(std::exception& inException) {
+		std::cerr << "Standard exception catched in sub-master:" << std::endl << std::flush;
+		std::cerr << inException.what() << std::endl << std::flush;
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+}
+
+/*!
+ *  \brief Evaluate the shards of the individuals broadcast by the leader of the group.
+ *  \param ioContext Evolutionary context.
+ *
+ *  Each individual comes with its size and generation, a negative size ending
+ *  the evolution. Rank 0 then sends the end of evolution to this process too.
+ */
+void Beagle::MPI::EvaluationOp::shardMemberOperate(Context& ioContext) {
+	try {
+		std::vector<char> lMessage;
+		std::vector<double> lPartial;
+		std::vector<double> lTotal;
+		MPI_Status lStatus;
+		while(true) {
+			int lHeader[2];
+			MPI_Bcast(lHeader, 2, MPI_INT, 0, mShardGroup->getComm());
+			if(lHeader[0] < 0) break;
+			lMessage.resize(std::max(lHeader[0], 1));
+			MPI_Bcast(&lMessage[0], lHeader[0], MPI_CHAR, 0, mShardGroup->getComm());
+			ioContext.setGeneration(lHeader[1]);
+			
+			lPartial.clear();
+			std::string lError;
+			try {
+				Individual::Handle lIndividual = decodeMessage(&lMessage[0], lHeader[0], mRank-mShardGroup->getGroupRank(), ioContext);
+				evaluateShard(*lIndividual, ioContext, lPartial);
+			} catch(Exception& inException) {
+				lError = inException.what();
+			} catch(std::exception& inException) {
+				lError = inException.what();
+			}
+			try {
+				reduceShards(lPartial, lError, lTotal);
+			} catch(Exception& inException) {
+				Beagle_LogDetailedM(
+									ioContext.getSystem().getLogger(),
+									"evaluation", "Beagle::MPIEvaluationOp",
+									std::string("Shard evaluation failed: ")+inException.what()
+									);
+			}
+		}
+		MPI_Recv(NULL, 0, MPI_CHAR, 0, eEvolutionEnd, MPI_COMM_WORLD, &lStatus);
+		Beagle_LogDetailedM(
+							ioContext.getSystem().getLogger(),
+							"evaluation", "Beagle::MPIEvaluationOp",
+							"End of evolution received from process 0"
+							);
+	} catch(Exception& inException) {
+		std::cerr << "Exception catched in shard evaluator:" << std::endl << std::flush;
+		std::cerr << inException.what() << std::endl << std::flush;
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+	catch(std::exception& inException) {
+		std::cerr << "Standard exception catched in shard evaluator:" << std::endl << std::flush;
+		std::cerr << inException.what() << std::endl << std::flush;
+		MPI_Abort(MPI_COMM_WORLD, 1);
+	}
+}
+
+/*!
+ *  \brief Tell the members of the shard group of this leader that the evolution ended.
+ */
+void Beagle::MPI::EvaluationOp::stopShardMembers()
+{
+	int lHeader[2] = { -1, 0 };
+	MPI_Bcast(lHeader, 2, MPI_INT, 0, mShardGroup->getComm());
+}
+
 void Beagle::MPI::EvaluationOp::evolverOperate(Deme& ioDeme, Context& ioContext) {
 	Beagle_LogTraceM(
 					 ioContext.getSystem().getLogger(),
@@ -401,10 +1871,44 @@ void Beagle::MPI::EvaluationOp::evolverOperate(Deme& ioDeme, Context& ioContext)
 	}
 	
 	
+	mNbRejected = 0;
+	mNbSkippedCases = 0;
+	std::vector<unsigned int> lEquivalentIndices;
+	std::vector<Individual::Handle> lEquivalents;
+	std::vector<Individual::Handle> lRepresentatives;
+	removeEquivalents(ioDeme, ioContext, lEquivalentIndices, lEquivalents, lRepresentatives);
+	sendRejectionBound(ioContext);
 	distributeDemeEvaluation(ioDeme, ioContext);
+	restoreEquivalents(ioDeme, lEquivalentIndices, lEquivalents, lRepresentatives);
+	if(mNbRejected > 0) {
+		Beagle_LogInfoM(
+						ioContext.getSystem().getLogger(),
+						"evaluation", "Beagle::MPIEvaluationOp",
+						uint2str(mNbRejected)+std::string(" individuals rejected before the end of their evaluation, ")+
+						uint2str(mNbSkippedCases)+" fitness cases skipped"
+						);
+	}
+	
+	if((mOverProvision->getWrappedValue() > 0) || mTerminationMet) {
+		//Remove the over-provisioned individuals left unevaluated, or those not evaluated before termination
+		unsigned int lNbKept = 0;
+		for(unsigned int i = 0; i < ioDeme.size(); ++i) {
+			if((ioDeme[i]->getFitness() == NULL) || (ioDeme[i]->getFitness()->isValid() == false)) continue;
+			ioDeme[lNbKept++] = ioDeme[i];
+		}
+		if(lNbKept < ioDeme.size()) {
+			Beagle_LogVerboseM(
+							   ioContext.getSystem().getLogger(),
+							   "evaluation", "Beagle::MPIEvaluationOp",
+							   std::string("Removing ")+uint2str(ioDeme.size()-lNbKept)+" unevaluated individuals from the deme"
+							   );
+			ioDeme.resize(lNbKept);
+		}
+	}
 	
 	ioContext.setIndividualIndex(lOldIndividualIndex);
 	ioContext.setIndividualHandle(lOldIndividualHandle);
+	updateRejectionBound(ioDeme, ioContext);
 	
 	if(mDemeHOFSize->getWrappedValue() > 0) {
 		Beagle_LogDetailedM(
@@ -428,18 +1932,840 @@ void Beagle::MPI::EvaluationOp::evolverOperate(Deme& ioDeme, Context& ioContext)
 	}
 }
 
+/*!
+ *  \brief Evaluate an individual received by an evaluator.
+ *  \param inMessage Encoded individual.
+ *  \param inSize Size of the message.
+ *  \param inSource Rank of the sending process.
+ *  \param ioContext Evolutionary context.
+ *  \param outFitness XML fitness of the individual.
+ *
+ *  The individual is decoded even when its evaluation is cancelled, the
+ *  codecs keeping state from one message of a sender to the next.
+ */
+void Beagle::MPI::EvaluationOp::evaluateMessage(const char* inMessage, unsigned int inSize, int inSource,
+												Context& ioContext, std::string& outFitness)
+{
+	Individual::Handle lIndividual = decodeMessage(inMessage, inSize, inSource, ioContext);
+	
+	//Skip the individuals of a cancelled chunk
+	if(isCancelled()) {
+		writeError("Evaluation cancelled", outFitness);
+		return;
+	}
+	
+	//Evaluated the fitness of the received individual
+	evaluateGuarded(*lIndividual, ioContext, outFitness);
+}
+
+/*!
+ *  \brief Decode an individual received by an evaluator.
+ *  \param inMessage Encoded individual.
+ *  \param inSize Size of the message.
+ *  \param inSource Rank of the sending process.
+ *  \param ioContext Evolutionary context, set to the decoded individual.
+ *  \return Decoded individual.
+ */
+Individual::Handle Beagle::MPI::EvaluationOp::decodeMessage(const char* inMessage, unsigned int inSize, int inSource,
+															 Context& ioContext)
+{
+	Beagle_LogTraceM(
+					 ioContext.getSystem().getLogger(),
+					 "evaluation", "Beagle::MPIEvaluationOp",
+					 std::string("Evaluating individual send from process ") + int2str(inSource)
+					 );
+	
+	//Read the received individual
+	ioContext.getDeme().resize(0);
+	Individual::Handle lIndividual = castHandleT<Individual>(ioContext.getDeme().getTypeAlloc()->allocate());
+	decodeIndividual(inMessage, inSize, inSource, *lIndividual, ioContext);
+	ioContext.setIndividualHandle(lIndividual);
+	ioContext.setIndividualIndex(0);
+	return lIndividual;
+}
+
+/*!
+ *  \brief Evaluate a batch of individuals.
+ *  \param ioIndividuals Individuals to evaluate, their fitness being set and valid on return.
+ *  \param ioContext Evolutionary context.
+ *
+ *  Called for the chunks received by the evaluators and for the demes of a
+ *  run on a single process. Overload it to share setup work or vectorize
+ *  across individuals. The default evaluates each individual with evaluate,
+ *  the context giving its position in the batch.
+ */
+void Beagle::MPI::EvaluationOp::evaluateBatch(Individual::Bag& ioIndividuals, Context& ioContext)
+{
+	mBatchSkipped.assign(ioIndividuals.size(), -1);
+	for(unsigned int i = 0; i < ioIndividuals.size(); ++i) {
+		ioContext.setIndividualIndex(i);
+		ioContext.setIndividualHandle(ioIndividuals[i]);
+		mRejected = false;
+		Fitness::Handle lFitness = evaluateSharded(*ioIndividuals[i], ioContext);
+		if(mRejected) mBatchSkipped[i] = mNbSkipped;
+		ioIndividuals[i]->setFitness(lFitness);
+		ioIndividuals[i]->getFitness()->setValid();
+	}
+}
+
+/*!
+ *  \brief Evaluate a batch of individuals, turning the exceptions into error replies.
+ *  \param ioBatch Individuals to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \param outFitnesses XML fitness or error reply of each individual.
+ *
+ *  When evaluateBatch throws, the individuals are evaluated again one at a
+ *  time, so that only the faulty ones get an error reply.
+ */
+void Beagle::MPI::EvaluationOp::evaluateBatchCaught(Individual::Bag& ioBatch, Context& ioContext,
+													std::vector<std::string>& outFitnesses)
+{
+	outFitnesses.resize(ioBatch.size());
+	try {
+		mBatchSkipped.assign(ioBatch.size(), -1);
+		evaluateBatch(ioBatch, ioContext);
+		for(unsigned int i = 0; i < ioBatch.size(); ++i) {
+			if(mBatchSkipped[i] >= 0) writeRejected(*ioBatch[i]->getFitness(), mBatchSkipped[i], outFitnesses[i]);
+			else writeFitness(*ioBatch[i]->getFitness(), outFitnesses[i]);
+		}
+		return;
+	} catch(Exception& inException) {
+		Beagle_LogInfoM(
+						ioContext.getSystem().getLogger(),
+						"evaluation", "Beagle::MPIEvaluationOp",
+						std::string("Evaluation of a batch failed, evaluating its individuals one at a time: ")+inException.what()
+						);
+	} catch(std::exception& inException) {
+		Beagle_LogInfoM(
+						ioContext.getSystem().getLogger(),
+						"evaluation", "Beagle::MPIEvaluationOp",
+						std::string("Evaluation of a batch failed, evaluating its individuals one at a time: ")+inException.what()
+						);
+	}
+	for(unsigned int i = 0; i < ioBatch.size(); ++i) {
+		ioContext.setIndividualIndex(i);
+		ioContext.setIndividualHandle(ioBatch[i]);
+		evaluateCaught(*ioBatch[i], ioContext, outFitnesses[i]);
+	}
+}
+
+/*!
+ *  \brief Evaluate the invalid individuals of a deme on rank 0, when running alone.
+ *  \param ioDeme Deme to evaluate.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::EvaluationOp::evaluateLocally(Deme& ioDeme, Context& ioContext)
+{
+	Individual::Bag lBatch;
+	for(unsigned int i = 0; i < ioDeme.size(); ++i) {
+		if((ioDeme[i]->getFitness() == NULL) || (ioDeme[i]->getFitness()->isValid() == false)) lBatch.push_back(ioDeme[i]);
+	}
+	if(lBatch.empty()) return;
+	Beagle_LogVerboseM(
+					   ioContext.getSystem().getLogger(),
+					   "evaluation", "Beagle::MPIEvaluationOp",
+					   std::string("Evaluating the fitness of ")+uint2str(lBatch.size())+" individuals"
+					   );
+	mBatchSkipped.assign(lBatch.size(), -1);
+	evaluateBatch(lBatch, ioContext);
+	for(unsigned int i = 0; i < lBatch.size(); ++i) {
+		if(mBatchSkipped[i] >= 0) {
+			++mNbRejected;
+			mNbSkippedCases += mBatchSkipped[i];
+		}
+	}
+	
+	//Update stats
+	ioContext.setProcessedDeme(ioContext.getProcessedDeme()+lBatch.size());
+	ioContext.setTotalProcessedDeme(ioContext.getTotalProcessedDeme()+lBatch.size());
+	ioContext.setProcessedVivarium(ioContext.getProcessedVivarium()+lBatch.size());
+	ioContext.setTotalProcessedVivarium(ioContext.getTotalProcessedVivarium()+lBatch.size());
+}
+
+/*!
+ *  \brief Evaluate an individual, under a watchdog if ec.mpi.eval.timeout is set.
+ *  \param ioIndividual Individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \param outFitness XML fitness of the individual, or error reply.
+ *
+ *  By default the timeout is cooperative: evaluate runs in this process and
+ *  isCancelled returns true once the timeout is over, the individual then
+ *  getting the penalty fitness. The heartbeats are sent by isCancelled.
+ *
+ *  With ec.mpi.eval.fork, the watchdog evaluates the individual in a forked
+ *  process, which sends the fitness back through a pipe and never calls MPI.
+ *  A process still running after the timeout is killed and the individual
+ *  gets the penalty fitness. Changes made by evaluate to the evaluation
+ *  operator or the context are lost with the forked process. While waiting,
+ *  the evaluator sends a heartbeat every ec.mpi.heartbeat seconds to
+ *  mHeartbeatTarget.
+ */
+void Beagle::MPI::EvaluationOp::evaluateGuarded(Individual& ioIndividual, Context& ioContext, std::string& outFitness)
+{
+	const double lTimeout = mEvaluationTimeout->getWrappedValue();
+	//The forked process cannot take part in the collectives of the shard group
+	if((lTimeout <= 0.) || (mShardGroup->getRole() == ShardGroup::eLeader)) {
+		evaluateCaught(ioIndividual, ioContext, outFitness);
+		return;
+	}
+	
+	if(!mForkEvaluation->getWrappedValue()) {
+		mTimedOut = false;
+		mDeadline = MPI_Wtime() + lTimeout;
+		mNextHeartbeat = MPI_Wtime() + mHeartbeatPeriod->getWrappedValue();
+		evaluateCaught(ioIndividual, ioContext, outFitness);
+		mDeadline = 0.;
+		if(mCancelled) {
+			writeError("Evaluation cancelled", outFitness);
+		} else if(mTimedOut) {
+			Beagle_LogInfoM(
+							ioContext.getSystem().getLogger(),
+							"evaluation", "Beagle::MPIEvaluationOp",
+							std::string("Evaluation stopped after ")+dbl2str(lTimeout)+" seconds, assigning the penalty fitness"
+							);
+			writeFitness(*getPenaltyFitness(ioIndividual, ioContext), outFitness);
+		}
+		mTimedOut = false;
+		return;
+	}
+	
+	if(!mForkLogged) {
+		Beagle_LogBasicM(
+						 ioContext.getSystem().getLogger(),
+						 "evaluation", "Beagle::MPIEvaluationOp",
+						 "Evaluating in forked processes, the state updated by the evaluations is not kept"
+						 );
+		mForkLogged = true;
+	}
+	
+	int lPipe[2];
+	if(pipe(lPipe) != 0) throw Beagle_RunTimeExceptionM("Unable to create the pipe of the evaluation watchdog");
+	const pid_t lChild = fork();
+	if(lChild < 0) {
+		close(lPipe[0]);
+		close(lPipe[1]);
+		throw Beagle_RunTimeExceptionM("Unable to fork the evaluation process");
+	}
+	if(lChild == 0) {
+		//Evaluation process
+		mInWatchdog = true;
+		close(lPipe[0]);
+		int lExitStatus = 1;
+		try {
+			std::string lFitness;
+			evaluateCaught(ioIndividual, ioContext, lFitness);
+			const char* lCursor = lFitness.data();
+			const char* lEnd = lCursor+lFitness.size();
+			while(lCursor < lEnd) {
+				const ssize_t lWritten = ::write(lPipe[1], lCursor, lEnd-lCursor);
+				if((lWritten < 0) && (errno == EINTR)) continue;
+				if(lWritten <= 0) break;
+				lCursor += lWritten;
+			}
+			if(lCursor == lEnd) lExitStatus = 0;
+		} catch(...) { }
+		_exit(lExitStatus);
+	}
+	
+	close(lPipe[1]);
+	outFitness.clear();
+	const double lDeadline = MPI_Wtime() + lTimeout;
+	const double lHeartbeat = (mHeartbeatTarget >= 0) ? mHeartbeatPeriod->getWrappedValue() : 0.;
+	double lNextHeartbeat = MPI_Wtime() + lHeartbeat;
+	bool lTimedOut = false;
+	bool lCancelled = false;
+	char lBuffer[4096];
+	while(true) {
+		const double lNow = MPI_Wtime();
+		if(lNow >= lDeadline) {
+			lTimedOut = true;
+			break;
+		}
+		if(isCancelled()) {
+			lCancelled = true;
+			break;
+		}
+		//Wake up regularly to look for a cancellation
+		double lWait = std::min(lDeadline-lNow, 0.1);
+		if(lHeartbeat > 0.) {
+			if(lNow >= lNextHeartbeat) {
+				MPI_Send(NULL, 0, MPI_CHAR, mHeartbeatTarget, eHeartbeat, MPI_COMM_WORLD);
+				lNextHeartbeat = lNow + lHeartbeat;
+			}
+			lWait = std::min(lWait, lNextHeartbeat-lNow);
+		}
+		struct pollfd lPoll;
+		lPoll.fd = lPipe[0];
+		lPoll.events = POLLIN;
+		lPoll.revents = 0;
+		if(poll(&lPoll, 1, static_cast<int>(std::ceil(lWait*1000.))) <= 0) continue;
+		const ssize_t lRead = ::read(lPipe[0], lBuffer, sizeof(lBuffer));
+		if((lRead < 0) && (errno == EINTR)) continue;
+		if(lRead <= 0) break;
+		outFitness.append(lBuffer, lRead);
+	}
+	close(lPipe[0]);
+	if(lTimedOut || lCancelled) kill(lChild, SIGKILL);
+	int lStatus = 0;
+	while((waitpid(lChild, &lStatus, 0) < 0) && (errno == EINTR)) { }
+	
+	if(lCancelled) {
+		writeError("Evaluation cancelled", outFitness);
+		return;
+	}
+	if(lTimedOut) {
+		Beagle_LogInfoM(
+						ioContext.getSystem().getLogger(),
+						"evaluation", "Beagle::MPIEvaluationOp",
+						std::string("Evaluation stopped after ")+dbl2str(lTimeout)+" seconds, assigning the penalty fitness"
+						);
+		writeFitness(*getPenaltyFitness(ioIndividual, ioContext), outFitness);
+		return;
+	}
+	if(!WIFEXITED(lStatus) || (WEXITSTATUS(lStatus) != 0) || outFitness.empty()) {
+		writeError("The evaluation process failed", outFitness);
+	}
+}
+
+/*!
+ *  \brief Evaluate an individual, turning the exceptions of evaluate into an error reply.
+ *  \param ioIndividual Individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \param outFitness XML fitness of the individual, or error reply.
+ */
+void Beagle::MPI::EvaluationOp::evaluateCaught(Individual& ioIndividual, Context& ioContext, std::string& outFitness)
+{
+	try {
+		mRejected = false;
+		Fitness::Handle lFitness = evaluateSharded(ioIndividual, ioContext);
+		if(mRejected) writeRejected(*lFitness, mNbSkipped, outFitness);
+		else writeFitness(*lFitness, outFitness);
+		return;
+	} catch(Exception& inException) {
+		writeError(inException.what(), outFitness);
+	} catch(std::exception& inException) {
+		writeError(inException.what(), outFitness);
+	}
+	Beagle_LogInfoM(
+					ioContext.getSystem().getLogger(),
+					"evaluation", "Beagle::MPIEvaluationOp",
+					std::string("Evaluation failed, sending an error reply: ")+outFitness
+					);
+}
+
+/*!
+ *  \brief Evaluate an individual, over the whole shard group on its leader.
+ *  \param ioIndividual Individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \return Handle to the fitness value of the individual.
+ *
+ *  Outside of a shard group, the individual is evaluated by evaluate. The
+ *  leader broadcasts the individual to its group, evaluates its own shard and
+ *  combines the results reduced over the group.
+ */
+Fitness::Handle Beagle::MPI::EvaluationOp::evaluateSharded(Individual& ioIndividual, Context& ioContext)
+{
+	if(mShardGroup->getRole() != ShardGroup::eLeader) return evaluate(ioIndividual, ioContext);
+	encodeIndividual(ioIndividual, -1, ioContext, mShardOut);
+	int lHeader[2] = { static_cast<int>(mShardOut.size()), static_cast<int>(ioContext.getGeneration()) };
+	MPI_Bcast(lHeader, 2, MPI_INT, 0, mShardGroup->getComm());
+	MPI_Bcast(&mShardOut[0], lHeader[0], MPI_CHAR, 0, mShardGroup->getComm());
+	
+	std::vector<double> lPartial;
+	std::vector<double> lTotal;
+	std::string lError;
+	try {
+		evaluateShard(ioIndividual, ioContext, lPartial);
+	} catch(Exception& inException) {
+		lError = inException.what();
+	} catch(std::exception& inException) {
+		lError = inException.what();
+	}
+	reduceShards(lPartial, lError, lTotal);
+	return combineShards(ioIndividual, ioContext, lTotal);
+}
+
+/*!
+ *  \brief Reduce the partial results of the shards to the leader of the group.
+ *  \param inPartial Partial results of this process.
+ *  \param inError Error of the evaluation of this process, empty if none.
+ *  \param outTotal Reduced results, on the leader.
+ *
+ *  Called by every process of the group. The processes first agree on the
+ *  success of every shard, so that the group stays in step when one fails;
+ *  each process then throws, without reducing the results.
+ */
+void Beagle::MPI::EvaluationOp::reduceShards(const std::vector<double>& inPartial, const std::string& inError,
+											 std::vector<double>& outTotal)
+{
+	const int lSize = inPartial.size();
+	//Failure and size range of the partial results over the group
+	int lState[3] = { inError.empty() ? 0 : 1, lSize, -lSize };
+	MPI_Allreduce(MPI_IN_PLACE, lState, 3, MPI_INT, MPI_MAX, mShardGroup->getComm());
+	if(!inError.empty()) throw Beagle_RunTimeExceptionM(inError);
+	if(lState[0] != 0) throw Beagle_RunTimeExceptionM("The evaluation of a shard failed on another process of the group");
+	if(lState[1] != -lState[2]) throw Beagle_RunTimeExceptionM("The shards of a group returned partial results of different sizes");
+	
+	outTotal.resize(lSize);
+	if(lSize == 0) return;
+	MPI_Reduce(const_cast<double*>(&inPartial[0]), &outTotal[0], lSize, MPI_DOUBLE, getShardReduction(), 0,
+			   mShardGroup->getComm());
+}
+
+/*!
+ *  \brief Return the fitness given to an individual whose evaluation failed.
+ *  \param inIndividual Individual evaluated.
+ *  \param ioContext Evolutionary context.
+ *
+ *  The default penalty is read from ec.mpi.eval.penalty, or is the fitness
+ *  built by the fitness allocator when that parameter is empty.
+ */
+Fitness::Handle Beagle::MPI::EvaluationOp::getPenaltyFitness(Individual& inIndividual, Context& ioContext)
+{
+	Fitness::Handle lFitness = castHandleT<Fitness>(inIndividual.getFitnessAlloc()->allocate());
+	const std::string& lPenalty = mPenaltyFitness->getWrappedValue();
+	if(!lPenalty.empty()) {
+		XMLStreamDecoder lDecoder;
+		lDecoder.readFitness(lPenalty.c_str(), lPenalty.size()+1, *lFitness);
+	}
+	return lFitness;
+}
+
+/*!
+ *  \brief Return true if a newly evaluated individual meets a termination criterion of the evolver.
+ *  \param inIndividual Evaluated individual.
+ *  \param ioContext Evolutionary context.
+ *
+ *  The default gives a deme made of the individual alone to the maximum and
+ *  minimum fitness termination operators of the main-loop set. Criteria on
+ *  the generation or the number of evaluations are left to the main loop.
+ */
+bool Beagle::MPI::EvaluationOp::isTerminationMet(Individual::Handle inIndividual, Context& ioContext)
+{
+	if(mTerminationProbe == NULL) {
+		mTerminationProbe = castHandleT<Deme>(ioContext.getVivarium().getTypeAlloc()->allocate());
+		mTerminationProbe->resize(0);
+		mTerminationProbe->push_back(inIndividual);
+	}
+	(*mTerminationProbe)[0] = inIndividual;
+	Operator::Bag& lOperators = ioContext.getEvolver().getMainLoopSet();
+	for(unsigned int i = 0; i < lOperators.size(); ++i) {
+		TerminationOp* lTermination = dynamic_cast<TermMaxFitnessOp*>(lOperators[i].getPointer());
+		if(lTermination == NULL) lTermination = dynamic_cast<TermMinFitnessOp*>(lOperators[i].getPointer());
+		if((lTermination != NULL) && lTermination->terminate(*mTerminationProbe, ioContext)) return true;
+	}
+	return false;
+}
+
+/*!
+ *  \brief Return a key equal for the individuals known to get the same fitness.
+ *  \param inIndividual Individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \return Key of the individual, empty if it must be evaluated by itself.
+ *
+ *  Rank 0 evaluates only one of the individuals of a deme sharing a key, the
+ *  others getting a copy of its fitness. The default returns an empty key.
+ */
+std::string Beagle::MPI::EvaluationOp::getEquivalenceKey(Individual& inIndividual, Context& ioContext)
+{
+	return std::string();
+}
+
+/*!
+ *  \brief Evaluate an individual on the shard of the fitness cases of this process.
+ *  \param inIndividual Individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \param outPartial Partial results, reduced over the group with getShardReduction.
+ *
+ *  Called on every process of a shard group, with ec.mpi.shard.size. The
+ *  fitness cases of this process are given by getShardRange. Every process of
+ *  a group must return as many partial results. The default throws, an
+ *  operator must overload it to shard its fitness cases.
+ */
+void Beagle::MPI::EvaluationOp::evaluateShard(Individual& inIndividual, Context& ioContext, std::vector<double>& outPartial)
+{
+	throw Beagle_RunTimeExceptionM("evaluateShard must be overloaded to use ec.mpi.shard.size");
+}
+
+/*!
+ *  \brief Compute the fitness of an individual from the reduced results of every shard.
+ *  \param inIndividual Individual evaluated.
+ *  \param ioContext Evolutionary context.
+ *  \param inTotal Partial results of evaluateShard, reduced over the group.
+ *  \return Handle to the fitness value of the individual.
+ *
+ *  Called on the leader of a shard group only. The default throws, an
+ *  operator must overload it to shard its fitness cases.
+ */
+Fitness::Handle Beagle::MPI::EvaluationOp::combineShards(Individual& inIndividual, Context& ioContext,
+														  const std::vector<double>& inTotal)
+{
+	throw Beagle_RunTimeExceptionM("combineShards must be overloaded to use ec.mpi.shard.size");
+}
+
+/*!
+ *  \brief Return the reduction of the partial results of the shards, MPI_SUM by default.
+ */
+MPI_Op Beagle::MPI::EvaluationOp::getShardReduction() const
+{
+	return MPI_SUM;
+}
+
+/*!
+ *  \brief Return the fitness cases to evaluate on this process.
+ *  \param inNbCases Total number of fitness cases.
+ *  \param outBegin Index of the first fitness case of the shard.
+ *  \param outEnd Index past the last fitness case of the shard.
+ *
+ *  Without shard group, the shard holds all the fitness cases.
+ */
+void Beagle::MPI::EvaluationOp::getShardRange(unsigned int inNbCases, unsigned int& outBegin, unsigned int& outEnd) const
+{
+	mShardGroup->getShardRange(inNbCases, outBegin, outEnd);
+}
+
+/*!
+ *  \brief Take out of a deme the individuals to evaluate equivalent to a previous one.
+ *  \param ioDeme Deme to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \param outIndices Index in the deme of each individual taken out.
+ *  \param outEquivalents Individuals taken out.
+ *  \param outRepresentatives Individual left in the deme equivalent to each one taken out.
+ *
+ *  The equivalence is given by getEquivalenceKey. The ratio of individuals
+ *  taken out is logged.
+ */
+void Beagle::MPI::EvaluationOp::removeEquivalents(Deme& ioDeme, Context& ioContext, std::vector<unsigned int>& outIndices,
+												  std::vector<Individual::Handle>& outEquivalents,
+												  std::vector<Individual::Handle>& outRepresentatives)
+{
+	std::map<std::string,Individual::Handle> lKeys;
+	unsigned int lNbKeyed = 0;
+	unsigned int lNbKept = 0;
+	for(unsigned int i = 0; i < ioDeme.size(); ++i) {
+		Individual::Handle lIndividual = ioDeme[i];
+		if((lIndividual->getFitness() == NULL) || (lIndividual->getFitness()->isValid() == false)) {
+			const std::string lKey = getEquivalenceKey(*lIndividual, ioContext);
+			if(!lKey.empty()) {
+				++lNbKeyed;
+				std::map<std::string,Individual::Handle>::const_iterator lIter = lKeys.find(lKey);
+				if(lIter != lKeys.end()) {
+					outIndices.push_back(i);
+					outEquivalents.push_back(lIndividual);
+					outRepresentatives.push_back(lIter->second);
+					continue;
+				}
+				lKeys[lKey] = lIndividual;
+			}
+		}
+		ioDeme[lNbKept++] = lIndividual;
+	}
+	if(lNbKeyed == 0) return;
+	ioDeme.resize(lNbKept);
+	Beagle_LogInfoM(
+					ioContext.getSystem().getLogger(),
+					"evaluation", "Beagle::MPIEvaluationOp",
+					uint2str(outIndices.size())+" of "+uint2str(lNbKeyed)+
+					std::string(" individuals to evaluate equivalent to another one (")+
+					dbl2str(100.*outIndices.size()/lNbKeyed, 3)+"%), sharing its evaluation"
+					);
+}
+
+/*!
+ *  \brief Put back in a deme the individuals taken out by removeEquivalents, with the fitness of their representative.
+ *  \param ioDeme Evaluated deme.
+ *  \param inIndices Index in the deme of each individual taken out.
+ *  \param inEquivalents Individuals taken out.
+ *  \param inRepresentatives Individual equivalent to each one taken out.
+ *
+ *  An individual whose representative was not evaluated stays unevaluated.
+ */
+void Beagle::MPI::EvaluationOp::restoreEquivalents(Deme& ioDeme, const std::vector<unsigned int>& inIndices,
+												   const std::vector<Individual::Handle>& inEquivalents,
+												   const std::vector<Individual::Handle>& inRepresentatives)
+{
+	if(inIndices.empty()) return;
+	std::vector<Individual::Handle> lKept(ioDeme.size());
+	for(unsigned int i = 0; i < ioDeme.size(); ++i) lKept[i] = ioDeme[i];
+	const unsigned int lSize = lKept.size()+inIndices.size();
+	ioDeme.resize(0);
+	unsigned int lNbRestored = 0;
+	for(unsigned int i = 0; i < lSize; ++i) {
+		if((lNbRestored < inIndices.size()) && (inIndices[lNbRestored] == i)) {
+			const Individual::Handle& lEquivalent = inEquivalents[lNbRestored];
+			const Fitness::Handle& lFitness = inRepresentatives[lNbRestored]->getFitness();
+			if((lFitness != NULL) && lFitness->isValid()) {
+				lEquivalent->setFitness(castHandleT<Fitness>(lEquivalent->getFitnessAlloc()->clone(*lFitness)));
+			}
+			ioDeme.push_back(lEquivalent);
+			++lNbRestored;
+		} else {
+			ioDeme.push_back(lKept[i-lNbRestored]);
+		}
+	}
+}
+
+/*!
+ *  \brief Flag the fitness returned by the current evaluation as partial.
+ *  \param inNbSkipped Number of fitness cases not evaluated.
+ *
+ *  Called from evaluate when the individual cannot reach getRejectionBound
+ *  anymore. Rank 0 counts the partial fitnesses and the skipped cases, and
+ *  uses the fitness returned by evaluate as any other. That fitness must thus
+ *  be worse than the bound and keep the order of the rejected individuals,
+ *  for instance by extrapolating the partial error over the skipped cases
+ *  rather than dividing it by the total number of cases.
+ */
+void Beagle::MPI::EvaluationOp::rejectEvaluation(unsigned int inNbSkipped)
+{
+	mRejected = true;
+	mNbSkipped = inNbSkipped;
+}
+
+/*!
+ *  \brief Send the rejection bound of the current deme to the evaluators, if changed.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::EvaluationOp::sendRejectionBound(Context& ioContext)
+{
+	const unsigned int lDeme = ioContext.getDemeIndex();
+	const double lBound = (lDeme < mRejectionBounds.size()) ? mRejectionBounds[lDeme] : -DBL_MAX;
+	//Also used by the evaluations of rank 0 when running alone
+	mRejectionBound = lBound;
+	if(lBound == mSentBound) return;
+	mLostWorkers.resize(mProcessSize, false);
+	for(int i = 1; i < mProcessSize; ++i) {
+		if(mLostWorkers[i]) continue;
+		MPI_Send(const_cast<double*>(&lBound), 1, MPI_DOUBLE, i, eRejectionBound, MPI_COMM_WORLD);
+	}
+	mSentBound = lBound;
+	Beagle_LogDetailedM(
+						ioContext.getSystem().getLogger(),
+						"evaluation", "Beagle::MPIEvaluationOp",
+						std::string("Rejection bound sent to the evaluators: ")+dbl2str(lBound)
+						);
+}
+
+/*!
+ *  \brief Compute the rejection bound of a deme from its evaluated individuals.
+ *  \param ioDeme Evaluated deme.
+ *  \param ioContext Evolutionary context.
+ *
+ *  The bound is the ec.mpi.race.quantile quantile of the FitnessSimple values
+ *  of the deme, used for its next evaluation.
+ */
+void Beagle::MPI::EvaluationOp::updateRejectionBound(Deme& ioDeme, Context& ioContext)
+{
+	const double lQuantile = mRaceQuantile->getWrappedValue();
+	if((lQuantile <= 0.) || (ioDeme.size() == 0)) return;
+	std::vector<double> lValues;
+	lValues.reserve(ioDeme.size());
+	for(unsigned int i = 0; i < ioDeme.size(); ++i) {
+		const FitnessSimple* lFitness = dynamic_cast<const FitnessSimple*>(ioDeme[i]->getFitness().getPointer());
+		if((lFitness == NULL) || (lFitness->isValid() == false)) continue;
+		lValues.push_back(lFitness->getValue());
+	}
+	if(lValues.empty()) return;
+	const unsigned int lRank = std::min<unsigned int>(static_cast<unsigned int>(lQuantile*(lValues.size()-1)), lValues.size()-1);
+	std::nth_element(lValues.begin(), lValues.begin()+lRank, lValues.end());
+	if(mRejectionBounds.size() <= ioContext.getDemeIndex()) mRejectionBounds.resize(ioContext.getDemeIndex()+1, -DBL_MAX);
+	mRejectionBounds[ioContext.getDemeIndex()] = lValues[lRank];
+}
+
+/*!
+ *  \brief Return true if rank 0 cancelled the work of this evaluator, or if the evaluation timed out.
+ *
+ *  Long evaluations may poll this method and return early, their fitness
+ *  being discarded by rank 0, or replaced by the penalty fitness after
+ *  ec.mpi.eval.timeout. Polling it also sends the heartbeats of an evaluation
+ *  under the timeout. Always false on rank 0 and in the process forked by the
+ *  evaluation watchdog, which is killed on cancellation instead.
+ */
+bool Beagle::MPI::EvaluationOp::isCancelled()
+{
+	if(mCancelled || mTimedOut) return true;
+	if((mRank == 0) || mInWatchdog) return false;
+	if(mDeadline > 0.) {
+		const double lNow = MPI_Wtime();
+		if(lNow >= mDeadline) {
+			mTimedOut = true;
+			return true;
+		}
+		const double lHeartbeat = mHeartbeatPeriod->getWrappedValue();
+		if((lHeartbeat > 0.) && (mHeartbeatTarget >= 0) && (lNow >= mNextHeartbeat)) {
+			MPI_Send(NULL, 0, MPI_CHAR, mHeartbeatTarget, eHeartbeat, MPI_COMM_WORLD);
+			mNextHeartbeat = lNow + lHeartbeat;
+		}
+	}
+	int lFlag;
+	MPI_Status lStatus;
+	MPI_Iprobe(MPI_ANY_SOURCE, eCancel, MPI_COMM_WORLD, &lFlag, &lStatus);
+	if(lFlag) {
+		MPI_Recv(NULL, 0, MPI_CHAR, lStatus.MPI_SOURCE, eCancel, MPI_COMM_WORLD, &lStatus);
+		mCancelled = true;
+	}
+	return mCancelled;
+}
+
+/*!
+ *  \brief Write a fitness in XML.
+ *  \param inFitness Fitness to write.
+ *  \param outFitness XML fitness.
+ */
+void Beagle::MPI::EvaluationOp::writeFitness(const Fitness& inFitness, std::string& outFitness)
+{
+	std::ostringstream lStreamOut;
+	PACC::XML::Streamer lXMLStream(lStreamOut);
+	inFitness.write(lXMLStream);
+	outFitness = lStreamOut.str();
+}
+
+/*!
+ *  \brief Write the partial fitness of a rejected evaluation in XML.
+ *  \param inFitness Partial fitness.
+ *  \param inNbSkipped Number of fitness cases not evaluated.
+ *  \param outFitness XML partial fitness.
+ */
+void Beagle::MPI::EvaluationOp::writeRejected(const Fitness& inFitness, unsigned int inNbSkipped, std::string& outFitness)
+{
+	std::ostringstream lStreamOut;
+	PACC::XML::Streamer lXMLStream(lStreamOut);
+	lXMLStream.openTag("Rejected", false);
+	lXMLStream.insertAttribute("skipped", uint2str(inNbSkipped));
+	inFitness.write(lXMLStream);
+	lXMLStream.closeTag();
+	outFitness = lStreamOut.str();
+}
+
+/*!
+ *  \brief Write the error reply of a failed evaluation, read as a penalty fitness by rank 0.
+ *  \param inWhat Description of the error.
+ *  \param outFitness XML error reply.
+ */
+void Beagle::MPI::EvaluationOp::writeError(const std::string& inWhat, std::string& outFitness)
+{
+	std::ostringstream lStreamOut;
+	PACC::XML::Streamer lXMLStream(lStreamOut);
+	lXMLStream.openTag("Error", false);
+	lXMLStream.insertStringContent(inWhat);
+	lXMLStream.closeTag();
+	outFitness = lStreamOut.str();
+}
+
+/*!
+ *  \brief Return true if the next message of a process is a block of individuals.
+ *  \param inSource Rank of the sending process.
+ */
+bool Beagle::MPI::EvaluationOp::isBlockNext(int inSource)
+{
+	MPI_Status lStatus;
+	MPI_Probe(inSource, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
+	return lStatus.MPI_TAG == eBlock;
+}
+
+/*!
+ *  \brief Evaluate a block of individuals received by an evaluator.
+ *  \param inMessage Block of individuals.
+ *  \param inSize Size of the block.
+ *  \param inSource Rank of the sending process.
+ *  \param ioContext Evolutionary context.
+ *  \param outReply Block of fitnesses, ending with the time spent evaluating.
+ *
+ *  The individuals are decoded first and evaluated together by evaluateBatch,
+ *  unless the evaluation watchdog is enabled. Every individual is decoded,
+ *  the cancelled ones included, to keep the codecs in step with the sender.
+ */
+void Beagle::MPI::EvaluationOp::evaluateBlock(const char* inMessage, unsigned int inSize, int inSource,
+											  Context& ioContext, std::string& outReply)
+{
+	const char* lEnd = inMessage+inSize;
+	ioContext.setGeneration(readUInt(inMessage, lEnd));
+	const unsigned int lNbIndividuals = readUInt(inMessage, lEnd);
+	std::vector<unsigned int> lIndices(lNbIndividuals);
+	std::vector<std::string> lFitnesses(lNbIndividuals);
+	double lEvaluationTime = 0.;
+	if((mEvaluationTimeout->getWrappedValue() > 0.) || isCancelled()) {
+		//The watchdog stops the evaluations one at a time
+		for(unsigned int i = 0; i < lNbIndividuals; ++i) {
+			lIndices[i] = readUInt(inMessage, lEnd);
+			const unsigned int lIndividualSize = readUInt(inMessage, lEnd);
+			if(lIndividualSize > static_cast<unsigned int>(lEnd-inMessage)) throw Beagle_IOExceptionMessageM("truncated block");
+			const double lStart = MPI_Wtime();
+			evaluateMessage(inMessage, lIndividualSize, inSource, ioContext, lFitnesses[i]);
+			lEvaluationTime += MPI_Wtime()-lStart;
+			inMessage += lIndividualSize;
+		}
+	} else {
+		Individual::Bag lBatch;
+		for(unsigned int i = 0; i < lNbIndividuals; ++i) {
+			lIndices[i] = readUInt(inMessage, lEnd);
+			const unsigned int lIndividualSize = readUInt(inMessage, lEnd);
+			if(lIndividualSize > static_cast<unsigned int>(lEnd-inMessage)) throw Beagle_IOExceptionMessageM("truncated block");
+			lBatch.push_back(decodeMessage(inMessage, lIndividualSize, inSource, ioContext));
+			inMessage += lIndividualSize;
+		}
+		const double lStart = MPI_Wtime();
+		evaluateBatchCaught(lBatch, ioContext, lFitnesses);
+		lEvaluationTime = MPI_Wtime()-lStart;
+	}
+	outReply.clear();
+	appendUInt(outReply, lNbIndividuals);
+	for(unsigned int i = 0; i < lNbIndividuals; ++i) {
+		appendUInt(outReply, lIndices[i]);
+		appendUInt(outReply, lFitnesses[i].size()+1);
+		outReply.append(lFitnesses[i].c_str(), lFitnesses[i].size()+1);
+	}
+	outReply.append(reinterpret_cast<const char*>(&lEvaluationTime), sizeof(double));
+}
+
+/*!
+ *  \brief Take individuals from the work queue until it is empty.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::EvaluationOp::pullEvaluations(Context& ioContext)
+{
+	unsigned int lIndex;
+	unsigned int lGeneration;
+	std::string lFitnessMessage;
+	while(mWorkQueue->claim(lIndex, lGeneration)) {
+		ioContext.setGeneration(lGeneration);
+		mWorkQueue->fetch(lIndex, mPullBuffer);
+		evaluateMessage(&mPullBuffer[0], mPullBuffer.size(), 0, ioContext, lFitnessMessage);
+		if(lFitnessMessage.size()+1 > mWorkQueue->getFitnessCapacity()) {
+			//Rank 0 only logs the text of an error reply, other replies must be whole
+			if(lFitnessMessage.compare(0, 6, "<Error") == 0) lFitnessMessage.resize(mWorkQueue->getFitnessCapacity()-1);
+			else writeError("Fitness too large for ec.mpi.pull.fitsize", lFitnessMessage);
+		}
+		mWorkQueue->putFitness(lIndex, lFitnessMessage.c_str(), lFitnessMessage.size()+1);
+	}
+}
+
 void Beagle::MPI::EvaluationOp::evaluatorOperate(Deme& ioDeme, Context& ioContext) {
 	try {
 		//char lMessage[4096];
 		int lMessageSize;
 		MPI_Status lStatus;
 		int lSource;
+		std::string lReply;
+		prepareCompressor(ioContext);
 
 		bool lDone = false;
 		while(!lDone) {
 			//Receive an individual to evaluate
+			MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
+			if(lStatus.MPI_TAG == eRejectionBound) {
+				MPI_Recv(&mRejectionBound, 1, MPI_DOUBLE, lStatus.MPI_SOURCE, eRejectionBound, MPI_COMM_WORLD, &lStatus);
+				continue;
+			}
 			MPI_Recv(&lMessageSize, 1, MPI_INT, MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
 			lSource = lStatus.MPI_SOURCE;
+			//Heartbeats go to the sender of the individuals, rank 0 for the work queue
+			mHeartbeatTarget = lSource;
+			mCancelled = false;
+			if(lStatus.MPI_TAG == eCancel) {
+				//Cancellation of work already replied
+				continue;
+			}
 			if(lStatus.MPI_TAG == eEvolutionEnd) {
 				Beagle_LogDetailedM(
 								   ioContext.getSystem().getLogger(),
@@ -447,73 +2773,51 @@ void Beagle::MPI::EvaluationOp::evaluatorOperate(Deme& ioDeme, Context& ioContex
 								   std::string("End of evolution received from process ") + int2str(lSource)
 								   );
 				lDone = true;
+			} else if(lStatus.MPI_TAG == ePullRound) {
+				pullEvaluations(ioContext);
+			} else if((lStatus.MPI_TAG == eMessageSize) && isBlockNext(lSource)) {
+				unsigned int lBlockSize;
+				const char* lMessage = receiveMessage(lSource, eBlock, lMessageSize, lBlockSize);
+				evaluateBlock(lMessage, lBlockSize, lSource, ioContext, lReply);
+				sendMessage(lReply.data(), lReply.size(), lSource, eFitnessBlock);
 			} else {
-				char *lMessage = new char[lMessageSize];
+				unsigned int lIndividualSize;
 				unsigned int lGeneration;
-				MPI_Recv(lMessage, lMessageSize, MPI_CHAR, lSource, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
-				MPI_Recv(&lGeneration, 1, MPI_INT, lSource, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
+				const char* lMessage;
+				const bool lShared = (lStatus.MPI_TAG == eSharedIndividual);
+				if(lShared) {
+					//Decoded in place from the shared memory slot
+					lMessage = mSharedChannel->read(mRank, lIndividualSize, lGeneration);
+				} else {
+					lMessage = receiveMessage(lSource, MPI_ANY_TAG, lMessageSize, lIndividualSize);
+					MPI_Recv(&lGeneration, 1, MPI_INT, lSource, MPI_ANY_TAG, MPI_COMM_WORLD, &lStatus);
+				}
 				ioContext.setGeneration(lGeneration);
-				Beagle_LogTraceM(
-								   ioContext.getSystem().getLogger(),
-								   "evaluation", "Beagle::MPIEvaluationOp",
-								   std::string("Evaluating individual send from process ") + int2str(lSource)
-								   );
-				
-				//Parse the received individual
-				std::istringstream lStreamIn(lMessage);
-
-				PACC::XML::Document lXMLParser;
-				lXMLParser.parse(lStreamIn);
-
-				PACC::XML::ConstIterator lIndividualRootNode = lXMLParser.getFirstRoot(); 
-
-				
-				//Read the received individual
-				ioContext.getDeme().resize(0);
-				Individual::Handle lIndividual = castHandleT<Individual>(ioContext.getDeme().getTypeAlloc()->allocate());
-				lIndividual->readWithContext(lIndividualRootNode,ioContext);
-				ioContext.setIndividualHandle(lIndividual);
-				ioContext.setIndividualIndex(0);
-				
-//				Beagle_LogDebugM(
-//								 ioContext.getSystem().getLogger(),
-//								 "evaluation", "Beagle::MPIEvaluationOp",
-//								 std::string("Individual received: ") + lIndividual->serialize()
-//								 );
-				
-				//Free message string
-				delete [] lMessage;
-				
-				//Evaluated the fitness of the received individual
-				Fitness::Handle lFitness = evaluate(*lIndividual, ioContext);
-			
-				//Send back the fitness
-				std::ostringstream lStreamOut;
-				PACC::XML::Streamer lXMLStream(lStreamOut);
-
-				lFitness->write(lXMLStream);
-				//std::cout << "Sending fitness of size " << lStreamOut.str().size()+1 << ":" << std::endl << lStreamOut.str() << std::endl;
-				lMessageSize = lStreamOut.str().size()+1;
-				
+				std::string lFitnessMessage;
+				evaluateMessage(lMessage, lIndividualSize, lSource, ioContext, lFitnessMessage);
 				Beagle_LogTraceM(
 									ioContext.getSystem().getLogger(),
 									"evaluation", "Beagle::MPIEvaluationOp",
 									std::string("Sending back fitness")
 									);
-				
-				MPI_Send(&lMessageSize, 1, MPI_INT, lSource, eMessageSize, MPI_COMM_WORLD);
-				MPI_Send(const_cast<char*>(lStreamOut.str().data()), lMessageSize, MPI_CHAR, lSource, eFitness, MPI_COMM_WORLD);
+				if(lShared && mSharedChannel->fits(lFitnessMessage.size()+1)) {
+					mSharedChannel->write(mRank, lFitnessMessage.c_str(), lFitnessMessage.size()+1, lGeneration);
+					lMessageSize = lFitnessMessage.size()+1;
+					MPI_Send(&lMessageSize, 1, MPI_INT, lSource, eSharedFitness, MPI_COMM_WORLD);
+				} else {
+					sendMessage(lFitnessMessage.c_str(), lFitnessMessage.size()+1, lSource, eFitness);
+				}
 			}
 		}
 	} catch(Exception& inException) {
 		std::cerr << "Exception catched in evaluator:" << std::endl << std::flush;
 		std::cerr << inException.what() << std::endl << std::flush;
-		exit(1);
+		MPI_Abort(MPI_COMM_WORLD, 1);
 	}
 	catch(std::exception& inException) {
 		std::cerr << "Standard exception catched in evaluator:" << std::endl << std::flush;
 		std::cerr << inException.what() << std::endl << std::flush;
-		exit(1);
+		MPI_Abort(MPI_COMM_WORLD, 1);
 	}
 }
 
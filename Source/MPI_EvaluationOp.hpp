@@ -37,6 +37,7 @@
 #define Beagle_MPI_EvaluationOp_hpp
 
 #include <string>
+#include <vector>
 #include <iostream>
 
 #include "beagle/EvaluationOp.hpp"
@@ -52,6 +53,19 @@
 #include "beagle/Context.hpp"
 #include "beagle/Logger.hpp"
 #include "beagle/BreederOp.hpp"
+#include "beagle/String.hpp"
+#include "beagle/Float.hpp"
+#include "beagle/Bool.hpp"
+#include "beagle/Deme.hpp"
+
+#include "MPI_Codec.hpp"
+#include "MPI_Compressor.hpp"
+#include "MPI_Hierarchy.hpp"
+#include "MPI_Scheduler.hpp"
+#include "MPI_ShardGroup.hpp"
+#include "MPI_SharedChannel.hpp"
+#include "MPI_WorkQueue.hpp"
+#include "MPI_XMLStreamDecoder.hpp"
 
 namespace Beagle {
 namespace MPI {
@@ -86,6 +100,22 @@ public:
 	 *  \return Handle to the fitness value of the individual.
 	 */
 	virtual Fitness::Handle evaluate(Individual& inIndividual, Context& ioContext) = 0;
+	virtual void evaluateBatch(Individual::Bag& ioIndividuals, Context& ioContext);
+	
+	virtual double getEvaluationCost(const Individual& inIndividual, Context& ioContext);
+	virtual Fitness::Handle getPenaltyFitness(Individual& inIndividual, Context& ioContext);
+	virtual bool isTerminationMet(Individual::Handle inIndividual, Context& ioContext);
+	virtual std::string getEquivalenceKey(Individual& inIndividual, Context& ioContext);
+	virtual void evaluateShard(Individual& inIndividual, Context& ioContext, std::vector<double>& outPartial);
+	virtual Fitness::Handle combineShards(Individual& inIndividual, Context& ioContext, const std::vector<double>& inTotal);
+	virtual MPI_Op getShardReduction() const;
+	void getShardRange(unsigned int inNbCases, unsigned int& outBegin, unsigned int& outEnd) const;
+	
+	bool isCancelled();
+	
+	//! Return the lowest FitnessSimple value still eligible for selection, -DBL_MAX if none.
+	double getRejectionBound() const { return mRejectionBound; }
+	void rejectEvaluation(unsigned int inNbSkipped);
 	
 	virtual Individual::Handle breed(Individual::Bag& inBreedingPool,
 									 BreederNode::Handle inChild,
@@ -95,14 +125,112 @@ public:
 	virtual void               operate(Deme& ioDeme, Context& ioContext);
 	virtual Fitness::Handle    test(Individual::Handle inIndividual, System::Handle ioSystem);
 	
+	void addCodec(Codec::Handle inCodec);
+	Codec::Handle getCodec(const std::string& inName) const;
+	void releaseWindows();
+	
 protected:
 	void evolverOperate(Deme& ioDeme, Context& ioContext);
 	void evaluatorOperate(Deme& ioDeme, Context& ioContext);
 	void distributeDemeEvaluation(Deme& ioDeme, Context& ioContext);
+	void distributeBlocks(Deme& ioDeme, Context& ioContext);
+	bool distributeQueue(Deme& ioDeme, Context& ioContext);
+	bool sendAssignment(Deme& ioDeme, Context& ioContext, const std::vector<unsigned int>& inIndices,
+						int inDestination, bool inChunked);
+	void markWorkerLost(int inRank, Context& ioContext);
+	void discardReply(int inSource, int inTag);
+	void pullEvaluations(Context& ioContext);
+	void evaluateMessage(const char* inMessage, unsigned int inSize, int inSource, Context& ioContext, std::string& outFitness);
+	Individual::Handle decodeMessage(const char* inMessage, unsigned int inSize, int inSource, Context& ioContext);
+	void evaluateBatchCaught(Individual::Bag& ioBatch, Context& ioContext, std::vector<std::string>& outFitnesses);
+	void evaluateLocally(Deme& ioDeme, Context& ioContext);
+	void evaluateGuarded(Individual& ioIndividual, Context& ioContext, std::string& outFitness);
+	void evaluateCaught(Individual& ioIndividual, Context& ioContext, std::string& outFitness);
+	void writeFitness(const Fitness& inFitness, std::string& outFitness);
+	void writeError(const std::string& inWhat, std::string& outFitness);
+	void writeRejected(const Fitness& inFitness, unsigned int inNbSkipped, std::string& outFitness);
+	void sendRejectionBound(Context& ioContext);
+	void updateRejectionBound(Deme& ioDeme, Context& ioContext);
+	void removeEquivalents(Deme& ioDeme, Context& ioContext, std::vector<unsigned int>& outIndices,
+						   std::vector<Individual::Handle>& outEquivalents,
+						   std::vector<Individual::Handle>& outRepresentatives);
+	void restoreEquivalents(Deme& ioDeme, const std::vector<unsigned int>& inIndices,
+							const std::vector<Individual::Handle>& inEquivalents,
+							const std::vector<Individual::Handle>& inRepresentatives);
+	void evaluateBlock(const char* inMessage, unsigned int inSize, int inSource, Context& ioContext, std::string& outReply);
+	bool isBlockNext(int inSource);
+	void subMasterOperate(Context& ioContext);
+	void shardMemberOperate(Context& ioContext);
+	void stopShardMembers();
+	Fitness::Handle evaluateSharded(Individual& ioIndividual, Context& ioContext);
+	void reduceShards(const std::vector<double>& inPartial, const std::string& inError, std::vector<double>& outTotal);
+	void assignFitness(Deme& ioDeme, unsigned int inIndex, const char* inMessage, unsigned int inSize,
+					   XMLStreamDecoder& ioDecoder, Context& ioContext);
+	unsigned int assignFitnessBlock(Deme& ioDeme, const char* inMessage, unsigned int inSize,
+									XMLStreamDecoder& ioDecoder, Context& ioContext, double& outEvaluationTime);
 	void individualEvaluation(Individual& ioIndividal, Context& ioContext);
+	void encodeIndividual(const Individual& inIndividual, int inDestination, Context& ioContext, std::string& outMessage);
+	void decodeIndividual(const char* inMessage, unsigned int inSize, int inSource, Individual& ioIndividual, Context& ioContext);
+	void scheduleIndividuals(Deme& ioDeme, Context& ioContext, std::vector<unsigned int>& ioOrder, std::vector<double>& outCosts);
+	void selectIndividual(Deme& ioDeme, std::vector<unsigned int>& ioOrder, unsigned int inCurrent,
+						  const std::vector<double>& inCosts, int inDestination, unsigned int inRemaining);
+	void routeIndividual(Deme& ioDeme, std::vector<unsigned int>& ioOrder, unsigned int inCurrent, int inDestination);
+	void prepareCompressor(Context& ioContext);
+	bool sendMessage(const char* inMessage, unsigned int inSize, int inDestination, int inTag);
+	const char* receiveMessage(int inSource, int inTag, int inFrameSize, unsigned int& outSize);
+	bool sendIndividual(const std::string& inMessage, int inDestination, unsigned int inGeneration);
+	const char* receiveFitness(int inSource, int inTag, unsigned int& outSize);
 	
 	UInt::Handle mVivaHOFSize;
 	UInt::Handle mDemeHOFSize;
+	String::Handle mCodecName;  //!< Name of the codec used to send the individuals, or "auto".
+	UInt::Handle mRoutingWindow; //!< Number of pending individuals considered when routing to an evaluator.
+	UInt::Handle mBackupCopies;  //!< Maximum number of backup copies of an outstanding evaluation.
+	UInt::Handle mOverProvision; //!< Number of individuals of a deme that may be left unevaluated.
+	Float::Handle mEvaluationTimeout; //!< Maximum time of an evaluation in seconds, 0 to disable.
+	Bool::Handle mForkEvaluation;     //!< Run the evaluations under the timeout in forked processes.
+	String::Handle mPenaltyFitness;   //!< XML fitness of the individuals whose evaluation failed.
+	Float::Handle mWorkerTimeout;     //!< Time per individual after which an evaluator is unresponsive.
+	Float::Handle mHeartbeatPeriod;   //!< Period of the heartbeats of the evaluators in seconds, 0 to disable.
+	Bool::Handle mEarlyTermination;   //!< Check the termination criteria on each fitness received.
+	Float::Handle mRaceQuantile;      //!< Quantile of the last fitnesses of a deme giving its rejection bound, 0 to disable.
+	
+	Codec::Bag mCodecs;         //!< Available codecs, the index of a codec is its identifier on the wire.
+	int mCodecIndex;            //!< Index of the codec selected by ec.mpi.codec, -1 for automatic selection.
+	
+	Compressor::Handle mCompressor;   //!< Compression of the messages.
+	bool mDictionaryReady;            //!< True when the compression dictionary is built.
+	std::string mFrameOut;            //!< Frame of the last message sent.
+	std::vector<char> mReceiveBuffer; //!< Frame of the last message received.
+	Hierarchy::Handle mHierarchy;     //!< Dispatch tree of the evaluation processes.
+	SharedChannel::Handle mSharedChannel; //!< Shared memory slots on the node of rank 0.
+	ShardGroup::Handle mShardGroup;   //!< Group of evaluators sharing the fitness cases of an individual.
+	Scheduler::Handle mScheduler;     //!< Order of dispatch of the individuals.
+	WorkQueue::Handle mWorkQueue;     //!< One-sided work queue of the pull mode.
+	std::vector<char> mPullBuffer;    //!< Individual read from the work queue.
+	std::vector<bool> mPendingReply;  //!< Evaluators owing the reply of a discarded copy, by rank.
+	std::vector<bool> mLostWorkers;   //!< Evaluators that could not be reached, by rank.
+	int mHeartbeatTarget;             //!< Rank receiving the heartbeats of this evaluator, -1 for none.
+	bool mQueueDisabled;              //!< True when an evaluator was lost, the work queue being no longer used.
+	bool mTerminationMet;             //!< True when a termination criterion was met during the last deme.
+	Deme::Handle mTerminationProbe;   //!< Deme of one individual given to the termination operators.
+	bool mCancelled;                  //!< True when rank 0 cancelled the current work of this evaluator.
+	bool mInWatchdog;                 //!< True in the forked evaluation process, which must not call MPI.
+	bool mForkLogged;                 //!< True once the first forked evaluation is logged.
+	bool mTimedOut;                   //!< True when the current evaluation exceeded ec.mpi.eval.timeout.
+	double mDeadline;                 //!< End of the current evaluation under the cooperative timeout, 0 if none.
+	double mNextHeartbeat;            //!< Time of the next heartbeat of the current evaluation.
+	std::vector<double> mRejectionBounds; //!< Rejection bound of each deme, computed by rank 0.
+	double mSentBound;                //!< Last rejection bound sent to the evaluators.
+	double mRejectionBound;           //!< Rejection bound received by this evaluator.
+	bool mRejected;                   //!< True when evaluate flagged its fitness as partial.
+	unsigned int mNbSkipped;          //!< Fitness cases skipped by the last rejected evaluation.
+	unsigned int mNbRejected;         //!< Partial fitnesses received during the last deme.
+	unsigned int mNbSkippedCases;     //!< Fitness cases skipped during the last deme.
+	std::vector<int> mBatchSkipped;   //!< Fitness cases skipped for each individual of a batch, -1 if evaluated fully.
+	std::string mIndividualOut;       //!< Individual being sent.
+	std::string mBlockOut;            //!< Chunk being sent.
+	std::string mShardOut;            //!< Individual being broadcast to the shard group.
 	
 	int mRank;         //!< MPI rank for this process
 	int mProcessSize;  //!< Number of process running 
@@ -37,6 +37,7 @@
 #include <Util/Tokenizer.hpp>
 
 #include "MPI_Evolver.hpp"
+#include "MPI_EvaluationOp.hpp"
 #include "mpi.h"
 #include "CommunicationMPI.h"
 
@@ -285,6 +286,8 @@ void Beagle::MPI::Evolver::stopEvaluater() {
 	for(unsigned int i = 1; i < mProcessSize->getWrappedValue(); ++i) {
 		MPI_Send(NULL, 0, MPI_CHAR, i, eEvolutionEnd, MPI_COMM_WORLD);
 	}
+	Beagle::MPI::EvaluationOp* lEvalOp = dynamic_cast<Beagle::MPI::EvaluationOp*>(mEvaluator.getPointer());
+	if(lEvalOp != NULL) lEvalOp->releaseWindows();
 }
 
 /*!
@@ -297,6 +300,8 @@ void Beagle::MPI::Evolver::initialize(System::Handle ioSystem, int& ioArgc, char
 {
 	// Initialize MPI
 	MPI_Init(&ioArgc, &ioArgv);
+	// Report communication errors, so that a lost evaluator does not abort the evolution
+	MPI_Comm_set_errhandler(MPI_COMM_WORLD, MPI_ERRORS_RETURN);
 
 	// Get rank
 	MPI_Comm_rank(MPI_COMM_WORLD, &mRank);
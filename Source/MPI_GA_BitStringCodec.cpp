@@ -0,0 +1,201 @@
+/*
+ *  MPI_GA_BitStringCodec.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/GA.hpp"
+#include "MPI_GA_BitStringCodec.hpp"
+
+#include <string>
+#include <cstring>
+#include <algorithm>
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Return a field of the packed bit string as an integer.
+ *  \param inPosition Position of the first bit of the field.
+ *  \param inNbBits Number of bits of the field, at most 64.
+ *  \return Value of the field, its first bit being the most significant.
+ */
+uint64_t Beagle::MPI::GA::PackedBitString::getBits(unsigned int inPosition, unsigned int inNbBits) const
+{
+	uint64_t lValue = 0;
+	while(inNbBits > 0) {
+		const unsigned int lOffset = inPosition % 64;
+		const unsigned int lTaken = std::min(inNbBits, 64-lOffset);
+		const uint64_t lChunk = (mWords[inPosition/64] << lOffset) >> (64-lTaken);
+		lValue = (lTaken == 64) ? lChunk : ((lValue << lTaken) | lChunk);
+		inPosition += lTaken;
+		inNbBits -= lTaken;
+	}
+	return lValue;
+}
+
+/*!
+ *  \brief Pack a bit string.
+ *  \param inBits Bits to pack.
+ */
+void Beagle::MPI::GA::PackedBitString::pack(const std::vector<bool>& inBits)
+{
+	mNbBits = inBits.size();
+	mWords.assign((mNbBits+63) / 64, 0);
+	for(unsigned int i = 0; i < mNbBits; ++i) {
+		if(inBits[i]) mWords[i/64] |= uint64_t(1) << (63 - i%64);
+	}
+}
+
+/*!
+ *  \brief Unpack the bit string.
+ *  \param outBits Unpacked bits.
+ */
+void Beagle::MPI::GA::PackedBitString::unpack(std::vector<bool>& outBits) const
+{
+	outBits.resize(mNbBits);
+	for(unsigned int i = 0; i < mNbBits; ++i) {
+		outBits[i] = ((mWords[i/64] >> (63 - i%64)) & 1) != 0;
+	}
+}
+
+
+/*!
+ *  \brief Register the parameters of the codec.
+ *  \param ioSystem System of the evolution.
+ */
+void Beagle::MPI::GA::BitStringCodec::initialize(System& ioSystem)
+{
+	if(ioSystem.getRegister().isRegistered("ec.mpi.bitstring.unpack")) {
+		mUnpack = castHandleT<Bool>(ioSystem.getRegister().getEntry("ec.mpi.bitstring.unpack"));
+	} else {
+		mUnpack = new Bool(true);
+		std::string lLongDescript = "Unpack the bit strings received by the evaluators. When false, ";
+		lLongDescript += "the received bit strings are left empty and the evaluation operator ";
+		lLongDescript += "must read the packed words from the bit string codec.";
+		Register::Description lDescription(
+										   "Unpack received bit strings",
+										   "Bool",
+										   "1",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.bitstring.unpack", mUnpack, lDescription);
+	}
+}
+
+/*!
+ *  \brief Append the packed bit strings of an individual to a message.
+ *  \param inIndividual Individual to encode.
+ *  \param inPeer Rank of the receiving process.
+ *  \param ioContext Evolutionary context.
+ *  \param ioMessage Message to append to.
+ *  \return False if a genotype of the individual is not a bit string.
+ */
+bool Beagle::MPI::GA::BitStringCodec::encodeIndividual(const Individual& inIndividual, int inPeer, Context& ioContext, std::string& ioMessage)
+{
+	for(unsigned int i = 0; i < inIndividual.size(); ++i) {
+		if(dynamic_cast<const Beagle::GA::BitString*>(inIndividual[i].getPointer()) == NULL) return false;
+	}
+	appendValue<unsigned int>(ioMessage, inIndividual.size());
+	for(unsigned int i = 0; i < inIndividual.size(); ++i) {
+		const Beagle::GA::BitString& lBitString = castObjectT<const Beagle::GA::BitString&>(*inIndividual[i]);
+		const unsigned int lNbBits = lBitString.size();
+		appendValue<unsigned int>(ioMessage, lNbBits);
+		for(unsigned int j = 0; j < lNbBits; j += 64) {
+			const unsigned int lEnd = std::min(j+64, lNbBits);
+			uint64_t lWord = 0;
+			for(unsigned int k = j; k < lEnd; ++k) lWord = (lWord << 1) | (lBitString[k] ? 1 : 0);
+			lWord <<= (64 - (lEnd-j)) % 64;
+			appendValue<uint64_t>(ioMessage, lWord);
+		}
+	}
+	return true;
+}
+
+/*!
+ *  \brief Decode the packed bit strings of an individual.
+ *  \param inBuffer Encoded individual.
+ *  \param inSize Size of the encoded individual.
+ *  \param inPeer Rank of the sending process.
+ *  \param ioIndividual Individual to fill.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::GA::BitStringCodec::decodeIndividual(const char* inBuffer, unsigned int inSize, int inPeer, Individual& ioIndividual, Context& ioContext)
+{
+	const bool lUnpack = (mUnpack == NULL) || mUnpack->getWrappedValue();
+	const char* lCursor = inBuffer;
+	const char* lEnd = inBuffer+inSize;
+	const unsigned int lNbGenotypes = readValue<unsigned int>(lCursor, lEnd);
+	ioIndividual.resize(lNbGenotypes);
+	releasePacked();
+	mPacked.erase(&ioIndividual);
+	std::vector<PackedBitString>* lPacked = NULL;
+	if(!lUnpack) {
+		PackedIndividual& lEntry = mPacked[&ioIndividual];
+		lEntry.mIndividual = &ioIndividual;
+		lEntry.mPacked.resize(lNbGenotypes);
+		lPacked = &lEntry.mPacked;
+	}
+	for(unsigned int i = 0; i < lNbGenotypes; ++i) {
+		Beagle::GA::BitString& lBitString = castObjectT<Beagle::GA::BitString&>(*ioIndividual[i]);
+		const unsigned int lNbBits = readValue<unsigned int>(lCursor, lEnd);
+		const unsigned int lNbWords = (lNbBits+63) / 64;
+		if(static_cast<unsigned int>(lEnd-lCursor) < lNbWords*sizeof(uint64_t)) {
+			throw Beagle_IOExceptionMessageM("truncated message");
+		}
+		if(lUnpack) {
+			lBitString.resize(lNbBits);
+			for(unsigned int j = 0; j < lNbBits; j += 64) {
+				const uint64_t lWord = readValue<uint64_t>(lCursor, lEnd);
+				const unsigned int lWordBits = std::min(64u, lNbBits-j);
+				for(unsigned int k = 0; k < lWordBits; ++k) lBitString[j+k] = ((lWord >> (63-k)) & 1) != 0;
+			}
+		} else {
+			lBitString.resize(0);
+			(*lPacked)[i].mNbBits = lNbBits;
+			(*lPacked)[i].mWords.resize(lNbWords);
+			if(lNbWords > 0) std::memcpy(&(*lPacked)[i].mWords[0], lCursor, lNbWords*sizeof(uint64_t));
+			lCursor += lNbWords*sizeof(uint64_t);
+		}
+	}
+}
+
+/*!
+ *  \brief Drop the packed bit strings of the individuals no longer used but by the codec.
+ */
+void Beagle::MPI::GA::BitStringCodec::releasePacked()
+{
+	std::map<const Individual*,PackedIndividual>::iterator lIter = mPacked.begin();
+	while(lIter != mPacked.end()) {
+		if(lIter->second.mIndividual->getRefCounter() == 1) mPacked.erase(lIter++);
+		else ++lIter;
+	}
+}
+
+/*!
+ *  \brief Return the packed words of a received bit string.
+ *  \param inIndividual Individual being evaluated.
+ *  \param inIndex Index of the bit string in the individual.
+ *  \return Packed bit string, NULL if the individual was not received packed.
+ */
+const Beagle::MPI::GA::PackedBitString* Beagle::MPI::GA::BitStringCodec::getPackedBitString(const Individual& inIndividual,
+																						 unsigned int inIndex) const
+{
+	std::map<const Individual*,PackedIndividual>::const_iterator lIter = mPacked.find(&inIndividual);
+	if((lIter == mPacked.end()) || (inIndex >= lIter->second.mPacked.size())) return NULL;
+	return &lIter->second.mPacked[inIndex];
+}
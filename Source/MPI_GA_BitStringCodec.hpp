@@ -0,0 +1,94 @@
+/*
+ *  MPI_GA_BitStringCodec.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_GA_BitStringCodec_H
+#define MPI_GA_BitStringCodec_H
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+#include "beagle/GA.hpp"
+#include "beagle/Bool.hpp"
+#include "MPI_Codec.hpp"
+
+namespace Beagle {
+namespace MPI {
+namespace GA {
+
+/*!
+ *  \brief Bit string packed in 64 bits words.
+ *
+ *  Bit i of the bit string is stored in word i/64, the first bit of a word
+ *  being its most significant bit.
+ */
+struct PackedBitString {
+	unsigned int          mNbBits;  //!< Number of bits in the bit string.
+	std::vector<uint64_t> mWords;   //!< Packed bits.
+
+	uint64_t getBits(unsigned int inPosition, unsigned int inNbBits) const;
+	void     pack(const std::vector<bool>& inBits);
+	void     unpack(std::vector<bool>& outBits) const;
+};
+
+/*!
+ *  \class BitStringCodec MPI_GA_BitStringCodec.hpp "MPI_GA_BitStringCodec.hpp"
+ *  \brief Binary codec of individuals made of GA bit strings.
+ *
+ *  Each bit string is sent as its number of bits followed by the packed words.
+ *  When parameter ec.mpi.bitstring.unpack is false, the received bit strings
+ *  are left empty and the evaluation operator reads the packed words with
+ *  getPackedBitString instead. The packed words are kept for every individual
+ *  decoded, so that a chunk or a block decoded at once can be evaluated, and
+ *  dropped once the codec holds the last reference to the individual.
+ */
+class BitStringCodec : public Beagle::MPI::Codec {
+public:
+	//! BitStringCodec handle type.
+	typedef PointerT<BitStringCodec,Beagle::MPI::Codec::Handle>
+	Handle;
+
+	BitStringCodec() : Beagle::MPI::Codec("bitstring") { }
+	virtual ~BitStringCodec() { }
+
+	virtual bool encodeIndividual(const Individual& inIndividual, int inPeer, Context& ioContext, std::string& ioMessage);
+	virtual void decodeIndividual(const char* inBuffer, unsigned int inSize, int inPeer, Individual& ioIndividual, Context& ioContext);
+	virtual void initialize(System& ioSystem);
+
+	const PackedBitString* getPackedBitString(const Individual& inIndividual, unsigned int inIndex) const;
+
+protected:
+	//! Individual decoded without unpacking, with its packed bit strings.
+	struct PackedIndividual {
+		Individual::Handle           mIndividual;  //!< Decoded individual.
+		std::vector<PackedBitString> mPacked;      //!< Packed bit strings of the individual.
+	};
+
+	void releasePacked();
+
+	Bool::Handle mUnpack;  //!< True if the received bit strings are unpacked.
+	std::map<const Individual*,PackedIndividual> mPacked;  //!< Individuals decoded without unpacking.
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,273 @@
+/*
+ *  MPI_GA_DeltaCodec.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/GA.hpp"
+#include "MPI_GA_DeltaCodec.hpp"
+
+#include <string>
+#include <cstring>
+
+using namespace Beagle;
+
+namespace {
+	//! Number of bits set in a word.
+	inline unsigned int countBits(uint64_t inWord)
+	{
+		inWord = inWord - ((inWord >> 1) & 0x5555555555555555ULL);
+		inWord = (inWord & 0x3333333333333333ULL) + ((inWord >> 2) & 0x3333333333333333ULL);
+		inWord = (inWord + (inWord >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		return (inWord * 0x0101010101010101ULL) >> 56;
+	}
+}
+
+
+/*!
+ *  \brief Register the parameters of the codec.
+ *  \param ioSystem System of the evolution.
+ */
+void Beagle::MPI::GA::DeltaCodec::initialize(System& ioSystem)
+{
+	if(ioSystem.getRegister().isRegistered("ec.mpi.delta.cache")) {
+		mCacheSize = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.delta.cache"));
+	} else {
+		mCacheSize = new UInt(0);
+		std::string lLongDescript = "Number of bit string individuals cached by each evaluator. Individuals ";
+		lLongDescript += "close to a cached one are sent as the positions of their flipped bits. ";
+		lLongDescript += "A value of 0 disables the delta codec.";
+		Register::Description lDescription(
+										   "Evaluators individual cache size",
+										   "UInt",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.delta.cache", mCacheSize, lDescription);
+	}
+}
+
+/*!
+ *  \brief Append an individual to a message, as a difference with a cached individual if possible.
+ *  \param inIndividual Individual to encode.
+ *  \param inPeer Rank of the receiving process.
+ *  \param ioContext Evolutionary context.
+ *  \param ioMessage Message to append to.
+ *  \return False if the codec is disabled or if a genotype of the individual is not a bit string.
+ *
+ *  Message layout: identifier of the individual and kind of message. A full
+ *  message then holds the number of bit strings, and for each its number of bits
+ *  and packed words. A delta message holds the identifier of the cached
+ *  individual, and for each bit string the number of flipped bits and their positions.
+ */
+bool Beagle::MPI::GA::DeltaCodec::encodeIndividual(const Individual& inIndividual, int inPeer, Context& ioContext, std::string& ioMessage)
+{
+	if((mCacheSize == NULL) || (mCacheSize->getWrappedValue() == 0)) return false;
+	if(!packIndividual(inIndividual)) return false;
+
+	Cache& lCache = getCache(inPeer);
+	unsigned int lNbChanges;
+	Cache::iterator lParent = findClosest(lCache, lNbChanges);
+	const unsigned int lID = ++mLastID;
+	appendValue<unsigned int>(ioMessage, lID);
+	if(lParent == lCache.end()) {
+		appendValue<unsigned char>(ioMessage, eFull);
+		appendValue<unsigned int>(ioMessage, mGenome.size());
+		for(unsigned int i = 0; i < mGenome.size(); ++i) {
+			appendValue<unsigned int>(ioMessage, mGenome[i].mNbBits);
+			if(!mGenome[i].mWords.empty()) {
+				ioMessage.append(reinterpret_cast<const char*>(&mGenome[i].mWords[0]), mGenome[i].mWords.size()*sizeof(uint64_t));
+			}
+		}
+	} else {
+		appendValue<unsigned char>(ioMessage, eDelta);
+		appendValue<unsigned int>(ioMessage, lParent->mID);
+		for(unsigned int i = 0; i < mGenome.size(); ++i) {
+			const std::vector<uint64_t>& lWords = mGenome[i].mWords;
+			const std::vector<uint64_t>& lParentWords = lParent->mGenome[i].mWords;
+			const unsigned int lCountPos = ioMessage.size();
+			unsigned int lCount = 0;
+			appendValue<unsigned int>(ioMessage, lCount);
+			for(unsigned int j = 0; j < lWords.size(); ++j) {
+				const uint64_t lDiff = lWords[j] ^ lParentWords[j];
+				if(lDiff == 0) continue;
+				for(unsigned int k = 0; k < 64; ++k) {
+					if((lDiff >> (63-k)) & 1) {
+						appendValue<unsigned int>(ioMessage, j*64+k);
+						++lCount;
+					}
+				}
+			}
+			std::memcpy(&ioMessage[lCountPos], &lCount, sizeof(unsigned int));
+		}
+	}
+	insertEntry(lCache, lParent, lID);
+	return true;
+}
+
+/*!
+ *  \brief Decode an individual encoded by this codec, updating the cache of the sending process.
+ *  \param inBuffer Encoded individual.
+ *  \param inSize Size of the encoded individual.
+ *  \param inPeer Rank of the sending process.
+ *  \param ioIndividual Individual to fill.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::GA::DeltaCodec::decodeIndividual(const char* inBuffer, unsigned int inSize, int inPeer, Individual& ioIndividual, Context& ioContext)
+{
+	const char* lCursor = inBuffer;
+	const char* lEnd = inBuffer+inSize;
+	const unsigned int lID = readValue<unsigned int>(lCursor, lEnd);
+	const unsigned char lKind = readValue<unsigned char>(lCursor, lEnd);
+	Cache& lCache = getCache(inPeer);
+	Cache::iterator lParent = lCache.end();
+
+	if(lKind == eFull) {
+		mGenome.resize(readValue<unsigned int>(lCursor, lEnd));
+		for(unsigned int i = 0; i < mGenome.size(); ++i) {
+			mGenome[i].mNbBits = readValue<unsigned int>(lCursor, lEnd);
+			mGenome[i].mWords.resize((mGenome[i].mNbBits+63) / 64);
+			const unsigned int lNbBytes = mGenome[i].mWords.size()*sizeof(uint64_t);
+			if(static_cast<unsigned int>(lEnd-lCursor) < lNbBytes) throw Beagle_IOExceptionMessageM("truncated message");
+			if(lNbBytes > 0) std::memcpy(&mGenome[i].mWords[0], lCursor, lNbBytes);
+			lCursor += lNbBytes;
+		}
+	} else if(lKind == eDelta) {
+		const unsigned int lParentID = readValue<unsigned int>(lCursor, lEnd);
+		for(lParent = lCache.begin(); lParent != lCache.end(); ++lParent) {
+			if(lParent->mID == lParentID) break;
+		}
+		if(lParent == lCache.end()) {
+			throw Beagle_IOExceptionMessageM(std::string("individual ")+uint2str(lParentID)+" is not in the delta cache");
+		}
+		mGenome = lParent->mGenome;
+		for(unsigned int i = 0; i < mGenome.size(); ++i) {
+			const unsigned int lNbChanges = readValue<unsigned int>(lCursor, lEnd);
+			for(unsigned int j = 0; j < lNbChanges; ++j) {
+				const unsigned int lPosition = readValue<unsigned int>(lCursor, lEnd);
+				if(lPosition >= mGenome[i].mNbBits) throw Beagle_IOExceptionMessageM("invalid bit position in delta message");
+				mGenome[i].mWords[lPosition/64] ^= uint64_t(1) << (63 - lPosition%64);
+			}
+		}
+	} else {
+		throw Beagle_IOExceptionMessageM("invalid delta message kind");
+	}
+
+	ioIndividual.resize(mGenome.size());
+	for(unsigned int i = 0; i < mGenome.size(); ++i) {
+		mGenome[i].unpack(castObjectT<Beagle::GA::BitString&>(*ioIndividual[i]));
+	}
+	insertEntry(lCache, lParent, lID);
+}
+
+/*!
+ *  \brief Return the bytes saved by sending an individual to a process, compared to a full message.
+ *  \param inIndividual Individual to send.
+ *  \param inPeer Rank of the receiving process.
+ */
+unsigned int Beagle::MPI::GA::DeltaCodec::getPeerAffinity(const Individual& inIndividual, int inPeer)
+{
+	if((mCacheSize == NULL) || (mCacheSize->getWrappedValue() == 0)) return 0;
+	if((inPeer < 0) || (static_cast<unsigned int>(inPeer) >= mCaches.size()) || mCaches[inPeer].empty()) return 0;
+	if(!packIndividual(inIndividual)) return 0;
+	unsigned int lNbChanges;
+	if(findClosest(mCaches[inPeer], lNbChanges) == mCaches[inPeer].end()) return 0;
+	unsigned int lNbWords = 0;
+	for(unsigned int i = 0; i < mGenome.size(); ++i) lNbWords += mGenome[i].mWords.size();
+	return lNbWords*sizeof(uint64_t) - lNbChanges*sizeof(unsigned int);
+}
+
+/*!
+ *  \brief Pack the bit strings of an individual in mGenome.
+ *  \return False if a genotype of the individual is not a bit string.
+ */
+bool Beagle::MPI::GA::DeltaCodec::packIndividual(const Individual& inIndividual)
+{
+	for(unsigned int i = 0; i < inIndividual.size(); ++i) {
+		if(dynamic_cast<const Beagle::GA::BitString*>(inIndividual[i].getPointer()) == NULL) return false;
+	}
+	mGenome.resize(inIndividual.size());
+	for(unsigned int i = 0; i < inIndividual.size(); ++i) {
+		mGenome[i].pack(castObjectT<const Beagle::GA::BitString&>(*inIndividual[i]));
+	}
+	return true;
+}
+
+/*!
+ *  \brief Return the cache of a process.
+ *  \param inPeer Rank of the process.
+ */
+Beagle::MPI::GA::DeltaCodec::Cache& Beagle::MPI::GA::DeltaCodec::getCache(int inPeer)
+{
+	if(static_cast<unsigned int>(inPeer) >= mCaches.size()) mCaches.resize(inPeer+1);
+	return mCaches[inPeer];
+}
+
+/*!
+ *  \brief Find the cached individual with the fewest bits differing from mGenome.
+ *  \param ioCache Cache to search.
+ *  \param outNbChanges Number of differing bits.
+ *  \return Closest individual, or the end of the cache if none is worth a delta message.
+ *
+ *  A delta message is worth it when it is at most half the size of the full
+ *  message, that is when there are fewer differing bits than packed words.
+ */
+Beagle::MPI::GA::DeltaCodec::Cache::iterator Beagle::MPI::GA::DeltaCodec::findClosest(Cache& ioCache, unsigned int& outNbChanges)
+{
+	unsigned int lNbWords = 0;
+	for(unsigned int i = 0; i < mGenome.size(); ++i) lNbWords += mGenome[i].mWords.size();
+
+	Cache::iterator lClosest = ioCache.end();
+	outNbChanges = lNbWords;
+	for(Cache::iterator lIter = ioCache.begin(); lIter != ioCache.end(); ++lIter) {
+		if(lIter->mGenome.size() != mGenome.size()) continue;
+		bool lSameShape = true;
+		for(unsigned int i = 0; lSameShape && (i < mGenome.size()); ++i) {
+			lSameShape = (lIter->mGenome[i].mNbBits == mGenome[i].mNbBits);
+		}
+		if(!lSameShape) continue;
+
+		unsigned int lNbChanges = 0;
+		for(unsigned int i = 0; (i < mGenome.size()) && (lNbChanges < outNbChanges); ++i) {
+			const std::vector<uint64_t>& lWords = mGenome[i].mWords;
+			const std::vector<uint64_t>& lCachedWords = lIter->mGenome[i].mWords;
+			for(unsigned int j = 0; (j < lWords.size()) && (lNbChanges < outNbChanges); ++j) {
+				lNbChanges += countBits(lWords[j] ^ lCachedWords[j]);
+			}
+		}
+		if(lNbChanges < outNbChanges) {
+			lClosest = lIter;
+			outNbChanges = lNbChanges;
+		}
+	}
+	return lClosest;
+}
+
+/*!
+ *  \brief Insert mGenome at the front of a cache, evicting the least recently used individuals.
+ *  \param ioCache Cache to update.
+ *  \param inParent Cached individual the message referred to, moved to the front first.
+ *  \param inID Identifier of the inserted individual.
+ */
+void Beagle::MPI::GA::DeltaCodec::insertEntry(Cache& ioCache, Cache::iterator inParent, unsigned int inID)
+{
+	if(inParent != ioCache.end()) ioCache.splice(ioCache.begin(), ioCache, inParent);
+	ioCache.push_front(CacheEntry());
+	ioCache.front().mID = inID;
+	ioCache.front().mGenome = mGenome;
+	while(ioCache.size() > mCacheSize->getWrappedValue()) ioCache.pop_back();
+}
@@ -0,0 +1,94 @@
+/*
+ *  MPI_GA_DeltaCodec.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_GA_DeltaCodec_H
+#define MPI_GA_DeltaCodec_H
+
+#include <list>
+#include <vector>
+#include <stdint.h>
+
+#include "beagle/GA.hpp"
+#include "beagle/UInt.hpp"
+#include "MPI_Codec.hpp"
+#include "MPI_GA_BitStringCodec.hpp"
+
+namespace Beagle {
+namespace MPI {
+namespace GA {
+
+/*!
+ *  \class DeltaCodec MPI_GA_DeltaCodec.hpp "MPI_GA_DeltaCodec.hpp"
+ *  \brief Codec sending bit string individuals as differences with an individual cached by the evaluator.
+ *
+ *  Each evaluator keeps the last ec.mpi.delta.cache individuals it received,
+ *  and the master keeps a mirror of the cache of every evaluator. When an
+ *  individual is close enough to a cached one, usually one of its parents,
+ *  only the identifier of the cached individual and the positions of the
+ *  flipped bits are sent. Otherwise the packed bit strings are sent. Both ends
+ *  update their cache the same way for each message, so they stay in sync as
+ *  long as the messages between two processes are received in order.
+ *
+ *  The codec is disabled when the cache size is 0, the default.
+ */
+class DeltaCodec : public Beagle::MPI::Codec {
+public:
+	//! DeltaCodec handle type.
+	typedef PointerT<DeltaCodec,Beagle::MPI::Codec::Handle>
+	Handle;
+
+	DeltaCodec() : Beagle::MPI::Codec("delta"), mLastID(0) { }
+	virtual ~DeltaCodec() { }
+
+	virtual bool encodeIndividual(const Individual& inIndividual, int inPeer, Context& ioContext, std::string& ioMessage);
+	virtual void decodeIndividual(const char* inBuffer, unsigned int inSize, int inPeer, Individual& ioIndividual, Context& ioContext);
+	virtual void initialize(System& ioSystem);
+	virtual unsigned int getPeerAffinity(const Individual& inIndividual, int inPeer);
+	//! Return true, the messages refer to the cache of the receiver.
+	virtual bool isPeerSpecific() const { return true; }
+
+protected:
+	//! Kind of message.
+	enum MessageKind { eFull=0, eDelta };
+
+	//! Individual cached by an evaluator.
+	struct CacheEntry {
+		unsigned int                 mID;      //!< Identifier of the individual.
+		std::vector<PackedBitString> mGenome;  //!< Packed bit strings of the individual.
+	};
+	//! Cache of an evaluator, most recently used first.
+	typedef std::list<CacheEntry> Cache;
+
+	bool            packIndividual(const Individual& inIndividual);
+	Cache&          getCache(int inPeer);
+	Cache::iterator findClosest(Cache& ioCache, unsigned int& outNbChanges);
+	void            insertEntry(Cache& ioCache, Cache::iterator inParent, unsigned int inID);
+
+	UInt::Handle                 mCacheSize;  //!< Number of individuals cached by each evaluator.
+	std::vector<Cache>           mCaches;     //!< Caches, indexed by the rank of the peer.
+	std::vector<PackedBitString> mGenome;     //!< Packed bit strings of the individual being encoded.
+	unsigned int                 mLastID;     //!< Last identifier given to an individual.
+};
+
+}
+}
+}
+
+#endif
@@ -35,6 +35,8 @@
 
 #include "beagle/GA.hpp"
 #include "MPI_GA_EvolverBitString.hpp"
+#include "MPI_GA_BitStringCodec.hpp"
+#include "MPI_GA_DeltaCodec.hpp"
 
 #include <string>
 
@@ -64,6 +66,8 @@ Beagle::MPI::GA::EvolverBitString::EvolverBitString(MPI::EvaluationOp::Handle in
 : Beagle::MPI::Evolver(inEvalOp)
 {
   addOperator(inEvalOp);
+  if(inEvalOp->getCodec("bitstring") == NULL) inEvalOp->addCodec(new BitStringCodec);
+  if(inEvalOp->getCodec("delta") == NULL) inEvalOp->addCodec(new DeltaCodec);
 	addOperator(new Beagle::GA::InitBitStrOp(inInitSize));
 	addOperator(new Beagle::GA::CrossoverOnePointBitStrOp);
 	addOperator(new Beagle::GA::CrossoverTwoPointsBitStrOp);
@@ -128,6 +132,8 @@ Beagle::MPI::GA::EvolverBitString::EvolverBitString(UIntArray inInitSize)
 Beagle::MPI::GA::EvolverBitString::EvolverBitString(EvaluationOp::Handle inEvalOp, UIntArray inInitSize) : Beagle::MPI::Evolver(inEvalOp)
 {
   addOperator(inEvalOp);
+  if(inEvalOp->getCodec("bitstring") == NULL) inEvalOp->addCodec(new BitStringCodec);
+  if(inEvalOp->getCodec("delta") == NULL) inEvalOp->addCodec(new DeltaCodec);
 	if(inInitSize.size()==0) addOperator(new Beagle::GA::InitBitStrOp(0));
 	else if(inInitSize.size()==1) addOperator(new Beagle::GA::InitBitStrOp(inInitSize[0]));
   else {
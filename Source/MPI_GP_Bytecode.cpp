@@ -0,0 +1,215 @@
+/*
+ *  MPI_GP_Bytecode.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/GP.hpp"
+#include "MPI_GP_Bytecode.hpp"
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Add bytes to a FNV-1a hash.
+ */
+static unsigned long mixHash(unsigned long inHash, const void* inData, unsigned int inSize)
+{
+	const unsigned char* lBytes = static_cast<const unsigned char*>(inData);
+	for(unsigned int i = 0; i < inSize; ++i) inHash = (inHash ^ lBytes[i]) * 16777619UL;
+	return inHash;
+}
+
+
+/*!
+ *  \brief Construct an empty program.
+ */
+Beagle::MPI::GP::Bytecode::Bytecode() :
+mStackSize(0)
+{ }
+
+/*!
+ *  \brief Compile a tree.
+ *  \param inTree Tree to compile.
+ *  \param inInputs Index of the inputs, by name of their token.
+ *  \return False if the tree holds a primitive without lowering, the program is then empty.
+ */
+bool Beagle::MPI::GP::Bytecode::compile(const Beagle::GP::Tree& inTree, const std::map<std::string,unsigned int>& inInputs)
+{
+	mCode.clear();
+	mConstants.clear();
+	mNames.clear();
+	mConstantNodes.clear();
+	mLargestSubTrees.clear();
+	mStackSize = 0;
+	if(inTree.size() == 0) return false;
+	for(unsigned int i = 0; i < inTree.size(); ++i) {
+		if(getOpCode(*inTree[i].mPrimitive, inInputs) == eUnsupported) return false;
+	}
+
+	mCode.reserve(inTree.size());
+	mNames.reserve(inTree.size());
+	for(unsigned int i = 0; i < inTree.size(); ++i) mNames.push_back(inTree[i].mPrimitive->getName());
+	lower(inTree, 0, 1, inInputs);
+	//Roots come after their arguments, the last one of a start being the largest.
+	//Where no sub-tree starts, the first instruction, a terminal, is given.
+	mLargestSubTrees.assign(mCode.size(), 0);
+	for(unsigned int i = 0; i < mCode.size(); ++i) mLargestSubTrees[i+1-mCode[i].mSize] = i;
+	return true;
+}
+
+/*!
+ *  \brief Return true if the program was compiled from a tree identical to the given one.
+ *  \param inTree Tree to compare.
+ *
+ *  The primitives are compared by name and the constants by value.
+ */
+bool Beagle::MPI::GP::Bytecode::isCompiledFrom(const Beagle::GP::Tree& inTree) const
+{
+	if(mCode.empty() || (inTree.size() != mNames.size())) return false;
+	for(unsigned int i = 0; i < inTree.size(); ++i) {
+		if(inTree[i].mPrimitive->getName() != mNames[i]) return false;
+	}
+	for(unsigned int i = 0; i < mConstantNodes.size(); ++i) {
+		Double lValue;
+		inTree[mConstantNodes[i]].mPrimitive->getValue(lValue);
+		if(lValue.getWrappedValue() != mConstants[i]) return false;
+	}
+	return true;
+}
+
+/*!
+ *  \brief Return a FNV-1a hash of a tree, from the name of its primitives and the value of its constants.
+ *  \param inTree Tree to hash.
+ *  \param inInputs Index of the inputs, by name of their token.
+ */
+unsigned long Beagle::MPI::GP::Bytecode::hash(const Beagle::GP::Tree& inTree, const std::map<std::string,unsigned int>& inInputs)
+{
+	unsigned long lHash = 2166136261UL;
+	for(unsigned int i = 0; i < inTree.size(); ++i) {
+		const std::string& lName = inTree[i].mPrimitive->getName();
+		lHash = mixHash(lHash, lName.data(), lName.size());
+		lHash = (lHash ^ 0xFFUL) * 16777619UL;
+		if(getOpCode(*inTree[i].mPrimitive, inInputs) != eConstant) continue;
+		Double lValue;
+		inTree[i].mPrimitive->getValue(lValue);
+		const double lConstant = lValue.getWrappedValue();
+		lHash = mixHash(lHash, &lConstant, sizeof(double));
+	}
+	return lHash;
+}
+
+/*!
+ *  \brief Return the operation of a primitive.
+ *  \param inPrimitive Primitive of a node.
+ *  \param inInputs Index of the inputs, by name of their token.
+ */
+Beagle::MPI::GP::Bytecode::OpCode
+Beagle::MPI::GP::Bytecode::getOpCode(const Beagle::GP::Primitive& inPrimitive, const std::map<std::string,unsigned int>& inInputs)
+{
+	if(dynamic_cast<const Beagle::GP::Add*>(&inPrimitive) != NULL) return eAdd;
+	if(dynamic_cast<const Beagle::GP::Subtract*>(&inPrimitive) != NULL) return eSubtract;
+	if(dynamic_cast<const Beagle::GP::Multiply*>(&inPrimitive) != NULL) return eMultiply;
+	if(dynamic_cast<const Beagle::GP::Divide*>(&inPrimitive) != NULL) return eDivide;
+	if(dynamic_cast<const Beagle::GP::Sin*>(&inPrimitive) != NULL) return eSin;
+	if(dynamic_cast<const Beagle::GP::Cos*>(&inPrimitive) != NULL) return eCos;
+	if(dynamic_cast<const Beagle::GP::Exp*>(&inPrimitive) != NULL) return eExp;
+	if(dynamic_cast<const Beagle::GP::TokenT<Double>*>(&inPrimitive) != NULL) {
+		return (inInputs.find(inPrimitive.getName()) != inInputs.end()) ? eInput : eConstant;
+	}
+	if(dynamic_cast<const Beagle::GP::EphemeralT<Double>*>(&inPrimitive) != NULL) return eConstant;
+	return eUnsupported;
+}
+
+/*!
+ *  \brief Append the instructions of a sub-tree, its arguments first.
+ *  \param inTree Tree compiled.
+ *  \param inNode Index of the root of the sub-tree.
+ *  \param inDepth Depth of the stack once the result of the sub-tree is pushed.
+ *  \param inInputs Index of the inputs, by name of their token.
+ */
+void Beagle::MPI::GP::Bytecode::lower(const Beagle::GP::Tree& inTree, unsigned int inNode, unsigned int inDepth,
+									  const std::map<std::string,unsigned int>& inInputs)
+{
+	if(inDepth > mStackSize) mStackSize = inDepth;
+	Instruction lInstruction;
+	lInstruction.mOpCode = getOpCode(*inTree[inNode].mPrimitive, inInputs);
+	lInstruction.mArgument = 0;
+	lInstruction.mSize = 1;
+	lInstruction.mHash = 2166136261UL;
+	const int lOpCode = lInstruction.mOpCode;
+	lInstruction.mHash = mixHash(lInstruction.mHash, &lOpCode, sizeof(int));
+	switch(lInstruction.mOpCode) {
+		case eInput:
+			lInstruction.mArgument = inInputs.find(inTree[inNode].mPrimitive->getName())->second;
+			lInstruction.mHash = mixHash(lInstruction.mHash, &lInstruction.mArgument, sizeof(unsigned int));
+			break;
+		case eConstant: {
+			Double lValue;
+			inTree[inNode].mPrimitive->getValue(lValue);
+			const double lConstant = lValue.getWrappedValue();
+			lInstruction.mArgument = mConstants.size();
+			lInstruction.mHash = mixHash(lInstruction.mHash, &lConstant, sizeof(double));
+			mConstants.push_back(lConstant);
+			mConstantNodes.push_back(inNode);
+			break;
+		}
+		case eSin:
+		case eCos:
+		case eExp:
+			lower(inTree, inNode+1, inDepth, inInputs);
+			lInstruction.mSize += mCode.back().mSize;
+			lInstruction.mHash = mixHash(lInstruction.mHash, &mCode.back().mHash, sizeof(unsigned long));
+			break;
+		default:
+			lower(inTree, inNode+1, inDepth, inInputs);
+			lInstruction.mSize += mCode.back().mSize;
+			lInstruction.mHash = mixHash(lInstruction.mHash, &mCode.back().mHash, sizeof(unsigned long));
+			lower(inTree, inNode+1+inTree[inNode+1].mSubTreeSize, inDepth+1, inInputs);
+			lInstruction.mSize += mCode.back().mSize;
+			lInstruction.mHash = mixHash(lInstruction.mHash, &mCode.back().mHash, sizeof(unsigned long));
+			break;
+	}
+	mCode.push_back(lInstruction);
+}
+
+/*!
+ *  \brief Return the root of the first argument of an instruction.
+ *  \param inRoot Index of an instruction taking arguments.
+ */
+unsigned int Beagle::MPI::GP::Bytecode::getFirstArgument(unsigned int inRoot) const
+{
+	switch(mCode[inRoot].mOpCode) {
+		case eSin:
+		case eCos:
+		case eExp:
+			return inRoot-1;
+		default:
+			return inRoot-1-mCode[inRoot-1].mSize;
+	}
+}
+
+/*!
+ *  \brief Return the operand of an instruction: the index of its input, the value of its constant or 0.
+ *  \param inIndex Index of the instruction.
+ */
+double Beagle::MPI::GP::Bytecode::getOperand(unsigned int inIndex) const
+{
+	if(mCode[inIndex].mOpCode == eInput) return mCode[inIndex].mArgument;
+	if(mCode[inIndex].mOpCode == eConstant) return mConstants[mCode[inIndex].mArgument];
+	return 0.;
+}
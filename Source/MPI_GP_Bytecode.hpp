@@ -0,0 +1,95 @@
+/*
+ *  MPI_GP_Bytecode.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_GP_Bytecode_H
+#define MPI_GP_Bytecode_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "beagle/GP.hpp"
+
+namespace Beagle {
+namespace MPI {
+namespace GP {
+
+/*!
+ *  \class Bytecode MPI_GP_Bytecode.hpp "MPI_GP_Bytecode.hpp"
+ *  \brief GP tree compiled to a flat postfix program.
+ *
+ *  Each node of the tree becomes one instruction, its arguments coming before
+ *  it, so that the program runs on a stack without following the nodes and
+ *  their handles. Each instruction also knows the size and the structural
+ *  hash of the sub-tree it ends, to look up the results of common sub-trees. Inputs are referred to by index and constants are copied in
+ *  the program. A tree holding a primitive without lowering, such as a user
+ *  defined primitive, is not compiled and must be run by
+ *  Beagle::GP::Individual::run.
+ */
+class Bytecode {
+public:
+	//! Operation of an instruction.
+	enum OpCode { eAdd=0, eSubtract, eMultiply, eDivide, eSin, eCos, eExp, eInput, eConstant, eUnsupported };
+
+	//! Instruction of a program.
+	struct Instruction {
+		OpCode mOpCode;           //!< Operation.
+		unsigned int mArgument;   //!< Index of the input or of the constant.
+		unsigned int mSize;       //!< Number of instructions of the sub-tree ending with this one.
+		unsigned long mHash;      //!< Structural hash of the sub-tree ending with this one.
+	};
+
+	Bytecode();
+	~Bytecode() { }
+
+	bool compile(const Beagle::GP::Tree& inTree, const std::map<std::string,unsigned int>& inInputs);
+	bool isCompiledFrom(const Beagle::GP::Tree& inTree) const;
+	static unsigned long hash(const Beagle::GP::Tree& inTree, const std::map<std::string,unsigned int>& inInputs);
+
+	//! Return the instructions, in postfix order.
+	const std::vector<Instruction>& getCode() const { return mCode; }
+	//! Return the constants of the program.
+	const std::vector<double>& getConstants() const { return mConstants; }
+	//! Return the depth of the stack needed to run the program.
+	unsigned int getStackSize() const { return mStackSize; }
+	//! Return the root of the largest sub-tree starting at an instruction, a terminal if none starts there.
+	unsigned int getLargestSubTree(unsigned int inStart) const { return mLargestSubTrees[inStart]; }
+	unsigned int getFirstArgument(unsigned int inRoot) const;
+	double getOperand(unsigned int inIndex) const;
+
+	static OpCode getOpCode(const Beagle::GP::Primitive& inPrimitive, const std::map<std::string,unsigned int>& inInputs);
+
+protected:
+	void lower(const Beagle::GP::Tree& inTree, unsigned int inNode, unsigned int inDepth,
+			   const std::map<std::string,unsigned int>& inInputs);
+
+	std::vector<Instruction> mCode;     //!< Instructions, in postfix order.
+	std::vector<double> mConstants;     //!< Constants of the program.
+	std::vector<std::string> mNames;    //!< Name of the primitives compiled, in prefix order.
+	std::vector<unsigned int> mConstantNodes;  //!< Index in the tree of each constant.
+	std::vector<unsigned int> mLargestSubTrees;  //!< Root of the largest sub-tree starting at each instruction.
+	unsigned int mStackSize;            //!< Depth of the stack needed.
+};
+
+}
+}
+}
+
+#endif
@@ -35,7 +35,9 @@
 
 #include "beagle/GP.hpp"
 #include "MPI_GP_EvaluationOp.hpp"
+#include "MPI_GP_TreeCodec.hpp"
 
+#include <cmath>
 #include <string>
 
 using namespace Beagle;
@@ -46,8 +48,15 @@ using namespace Beagle;
  *  \param inName Name of the operator.
  */
 Beagle::MPI::GP::EvaluationOp::EvaluationOp(std::string inName) :
-Beagle::MPI::EvaluationOp(inName)
-{ }
+Beagle::MPI::EvaluationOp(inName),
+mStatsGeneration(0),
+mNativeFailed(false),
+mInterpretedTime(0.),
+mInterpretedWork(0.),
+mCompileTimePerNode(1e-3)
+{
+	addCodec(new TreeCodec);
+}
 
 
 /*!
@@ -63,6 +72,369 @@ Fitness::Handle Beagle::MPI::GP::EvaluationOp::evaluate(Beagle::Individual& inIn
 }
 
 
+/*!
+ *  \brief Evaluate a GP individual on the shard of the fitness cases of this process.
+ *  \param inIndividual Current individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \param outPartial Partial results, reduced over the shard group.
+ */
+void Beagle::MPI::GP::EvaluationOp::evaluateShard(Beagle::Individual& inIndividual, Beagle::Context& ioContext,
+												  std::vector<double>& outPartial)
+{
+	evaluateShard(castObjectT<Beagle::GP::Individual&>(inIndividual), castObjectT<Beagle::GP::Context&>(ioContext), outPartial);
+}
+
+
+/*!
+ *  \brief Compute the fitness of a GP individual from the reduced results of every shard.
+ *  \param inIndividual Individual evaluated.
+ *  \param ioContext Evolutionary context.
+ *  \param inTotal Partial results, reduced over the shard group.
+ *  \return Handle to the fitness value of the GP individual.
+ */
+Fitness::Handle Beagle::MPI::GP::EvaluationOp::combineShards(Beagle::Individual& inIndividual, Beagle::Context& ioContext,
+															  const std::vector<double>& inTotal)
+{
+	return combineShards(castObjectT<Beagle::GP::Individual&>(inIndividual), castObjectT<Beagle::GP::Context&>(ioContext), inTotal);
+}
+
+
+/*!
+ *  \brief Evaluate a GP individual on the shard of the fitness cases of this process.
+ *  \param inIndividual Current GP individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \param outPartial Partial results, reduced over the shard group.
+ *
+ *  The default throws, an operator must overload it to shard its fitness cases.
+ */
+void Beagle::MPI::GP::EvaluationOp::evaluateShard(Beagle::GP::Individual& inIndividual, Beagle::GP::Context& ioContext,
+												  std::vector<double>& outPartial)
+{
+	Beagle::MPI::EvaluationOp::evaluateShard(static_cast<Beagle::Individual&>(inIndividual),
+											 static_cast<Beagle::Context&>(ioContext), outPartial);
+}
+
+
+/*!
+ *  \brief Compute the fitness of a GP individual from the reduced results of every shard.
+ *  \param inIndividual GP individual evaluated.
+ *  \param ioContext Evolutionary context.
+ *  \param inTotal Partial results, reduced over the shard group.
+ *  \return Handle to the fitness value of the GP individual.
+ *
+ *  The default throws, an operator must overload it to shard its fitness cases.
+ */
+Fitness::Handle Beagle::MPI::GP::EvaluationOp::combineShards(Beagle::GP::Individual& inIndividual, Beagle::GP::Context& ioContext,
+															  const std::vector<double>& inTotal)
+{
+	return Beagle::MPI::EvaluationOp::combineShards(static_cast<Beagle::Individual&>(inIndividual),
+													static_cast<Beagle::Context&>(ioContext), inTotal);
+}
+
+
+/*!
+ *  \brief Initialize the operator by registering its parameters.
+ *  \param ioSystem System of the evolution.
+ */
+void Beagle::MPI::GP::EvaluationOp::initialize(Beagle::System& ioSystem)
+{
+	Beagle::MPI::EvaluationOp::initialize(ioSystem);
+	
+	if(ioSystem.getRegister().isRegistered("ec.mpi.gp.cache")) {
+		mCacheSize = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.gp.cache"));
+	} else {
+		mCacheSize = new UInt(1024);
+		std::string lLongDescript = "Number of GP trees kept compiled to bytecode by each evaluator, ";
+		lLongDescript += "so that a tree evaluated again is not compiled again. A value of 0 disables ";
+		lLongDescript += "the cache.";
+		Register::Description lDescription(
+										   "MPI GP bytecode cache size",
+										   "UInt",
+										   "1024",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.gp.cache", mCacheSize, lDescription);
+	}
+	
+	if(ioSystem.getRegister().isRegistered("ec.mpi.gp.subtree.cache")) {
+		mSubtreeCacheSize = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.gp.subtree.cache"));
+	} else {
+		mSubtreeCacheSize = new UInt(64);
+		std::string lLongDescript = "Size in MB of the cache of each evaluator keeping the results of GP ";
+		lLongDescript += "sub-trees over all the fitness cases, so that the sub-trees shared by individuals ";
+		lLongDescript += "are run once. The least recently used results are evicted. A value of 0 disables ";
+		lLongDescript += "the cache.";
+		Register::Description lDescription(
+										   "MPI GP sub-tree cache size",
+										   "UInt",
+										   "64",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.gp.subtree.cache", mSubtreeCacheSize, lDescription);
+	}
+	
+	if(ioSystem.getRegister().isRegistered("ec.mpi.gp.subtree.min")) {
+		mSubtreeMinSize = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.gp.subtree.min"));
+	} else {
+		mSubtreeMinSize = new UInt(5);
+		Register::Description lDescription(
+										   "MPI GP sub-tree cache minimum size",
+										   "UInt",
+										   "5",
+										   "Minimum number of nodes of the GP sub-trees whose results are cached."
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.gp.subtree.min", mSubtreeMinSize, lDescription);
+	}
+	
+	if(ioSystem.getRegister().isRegistered("ec.mpi.gp.dedup")) {
+		mDedup = castHandleT<Bool>(ioSystem.getRegister().getEntry("ec.mpi.gp.dedup"));
+	} else {
+		mDedup = new Bool(false);
+		std::string lLongDescript = "Whether the GP individuals computing the same function, once their trees are ";
+		lLongDescript += "simplified (X*1, X+0, X/1, X-0, constant folding) and the operands of Add and Multiply ";
+		lLongDescript += "ordered, share one evaluation. Only valid when the fitness depends on the function ";
+		lLongDescript += "computed alone, not on the shape of the trees.";
+		Register::Description lDescription(
+										   "MPI GP deduplication",
+										   "Bool",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.gp.dedup", mDedup, lDescription);
+	}
+	
+	if(ioSystem.getRegister().isRegistered("ec.mpi.gp.native")) {
+		mNative = castHandleT<Bool>(ioSystem.getRegister().getEntry("ec.mpi.gp.native"));
+	} else {
+		mNative = new Bool(false);
+		std::string lLongDescript = "Whether the GP trees of a batch evaluated over all the fitness cases may be ";
+		lLongDescript += "compiled to native code by the system compiler. A batch is compiled only when its ";
+		lLongDescript += "measured interpretation time is expected to be at least twice the compilation time. ";
+		lLongDescript += "The compiler is started with std::system, which forks the evaluator: the MPI library ";
+		lLongDescript += "must support fork, which some high-speed interconnects do not. The files are written ";
+		lLongDescript += "under TMPDIR, /tmp if not set.";
+		Register::Description lDescription(
+										   "MPI GP native compilation",
+										   "Bool",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.gp.native", mNative, lDescription);
+	}
+	
+	if(ioSystem.getRegister().isRegistered("ec.mpi.gp.native.cmd")) {
+		mNativeCommand = castHandleT<String>(ioSystem.getRegister().getEntry("ec.mpi.gp.native.cmd"));
+	} else {
+		mNativeCommand = new String("c++ -O2 -ffp-contract=off -shared -fPIC");
+		std::string lLongDescript = "Command compiling the native code of the GP trees into a shared object, ";
+		lLongDescript += "the output and source files being appended. Keep -ffp-contract=off, fused ";
+		lLongDescript += "multiply-adds rounding differently from the interpreter and changing the fitnesses.";
+		Register::Description lDescription(
+										   "MPI GP native compiler",
+										   "String",
+										   "c++ -O2 -ffp-contract=off -shared -fPIC",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.gp.native.cmd", mNativeCommand, lDescription);
+	}
+}
+
+
+/*!
+ *  \brief Evaluate a batch of individuals, compiling their trees to native code when worth it.
+ *  \param ioIndividuals Individuals to evaluate.
+ *  \param ioContext Evolutionary context.
+ *
+ *  With ec.mpi.gp.native, runFitnessCases runs the native code of the trees
+ *  compiled by compileNative, during this batch only.
+ */
+void Beagle::MPI::GP::EvaluationOp::evaluateBatch(Beagle::Individual::Bag& ioIndividuals, Beagle::Context& ioContext)
+{
+	if(mNative->getWrappedValue()) compileNative(ioIndividuals, ioContext);
+	try {
+		Beagle::MPI::EvaluationOp::evaluateBatch(ioIndividuals, ioContext);
+	} catch(...) {
+		mNativeIndexes.clear();
+		throw;
+	}
+	mNativeIndexes.clear();
+}
+
+
+/*!
+ *  \brief Compile the trees of a batch to native code, if the cost model says it pays.
+ *  \param inIndividuals Individuals of the batch.
+ *  \param ioContext Evolutionary context.
+ *
+ *  The interpretation time of the batch is estimated from the time per node
+ *  and fitness case measured by runFitnessCases, and the compilation time from
+ *  the time per node of the last compilation. The batch is compiled when the
+ *  former is at least twice the latter, the native code being expected to
+ *  save at least half of the interpretation. A failed compilation disables
+ *  the native code for the rest of the run.
+ */
+void Beagle::MPI::GP::EvaluationOp::compileNative(Beagle::Individual::Bag& inIndividuals, Beagle::Context& ioContext)
+{
+	if(mNativeFailed || (mInterpreter.getNbCases() == 0) || (mInterpretedWork == 0.)) return;
+	
+	mNativePrograms.clear();
+	std::vector<const Beagle::GP::Tree*> lTrees;
+	unsigned int lNbNodes = 0;
+	for(unsigned int i = 0; i < inIndividuals.size(); ++i) {
+		Beagle::GP::Individual& lIndividual = castObjectT<Beagle::GP::Individual&>(*inIndividuals[i]);
+		if(lIndividual.size() != 1) continue;
+		const Bytecode* lProgram = mInterpreter.compile(*lIndividual[0]);
+		if(lProgram == NULL) continue;
+		mNativePrograms.push_back(*lProgram);
+		lTrees.push_back(&(*lIndividual[0]));
+		lNbNodes += lIndividual[0]->size();
+	}
+	if(lTrees.empty()) return;
+	
+	const double lInterpretTime = (mInterpretedTime/mInterpretedWork) * lNbNodes * mInterpreter.getNbCases();
+	const double lCompileTime = mCompileTimePerNode * lNbNodes;
+	if(lInterpretTime < 2.0*lCompileTime) return;
+	
+	std::string lError;
+	const double lStart = MPI_Wtime();
+	if(!mNativeCompiler.compile(mNativePrograms, mNativeCommand->getWrappedValue(), mNativeFunctions, lError)) {
+		mNativeFailed = true;
+		Beagle_LogBasicM(
+						 ioContext.getSystem().getLogger(),
+						 "evaluation", "Beagle::MPI::GP::EvaluationOp",
+						 std::string("Native compilation of the GP trees failed, disabling it: ")+lError
+						 );
+		return;
+	}
+	mCompileTimePerNode = (MPI_Wtime()-lStart) / lNbNodes;
+	for(unsigned int i = 0; i < lTrees.size(); ++i) mNativeIndexes[lTrees[i]] = i;
+	Beagle_LogDetailedM(
+						ioContext.getSystem().getLogger(),
+						"evaluation", "Beagle::MPI::GP::EvaluationOp",
+						std::string("Compiled ")+uint2str(lTrees.size())+" GP trees to native code in "+
+						dbl2str(mCompileTimePerNode*lNbNodes)+" s"
+						);
+}
+
+
+/*!
+ *  \brief Return the canonical form of the trees of a GP individual, with ec.mpi.gp.dedup.
+ *  \param inIndividual GP individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \return Canonical form of the trees, empty without ec.mpi.gp.dedup.
+ */
+std::string Beagle::MPI::GP::EvaluationOp::getEquivalenceKey(Beagle::Individual& inIndividual, Beagle::Context& ioContext)
+{
+	if((mDedup == NULL) || !mDedup->getWrappedValue()) return std::string();
+	Beagle::GP::Individual& lIndividual = castObjectT<Beagle::GP::Individual&>(inIndividual);
+	std::string lKey;
+	for(unsigned int i = 0; i < lIndividual.size(); ++i) {
+		if(lIndividual[i]->size() == 0) return std::string();
+		bool lConstant;
+		double lValue;
+		lKey += getCanonicalForm(*lIndividual[i], 0, lConstant, lValue);
+		lKey += ';';
+	}
+	return lKey;
+}
+
+
+/*!
+ *  \brief Return the canonical form of a sub-tree.
+ *  \param inTree Tree of the sub-tree.
+ *  \param inNode Index of the root of the sub-tree.
+ *  \param outConstant Whether the sub-tree is a constant.
+ *  \param outValue Value of the sub-tree, if a constant.
+ *
+ *  The sub-trees of constants are folded as the primitives compute them, the
+ *  neutral operands of Add, Subtract, Multiply and Divide are removed and the
+ *  operands of Add and Multiply are ordered. Only the ephemerals of Double are
+ *  constants, the tokens being variables. Other primitives are kept as they
+ *  are, with the canonical form of their arguments.
+ */
+std::string Beagle::MPI::GP::EvaluationOp::getCanonicalForm(const Beagle::GP::Tree& inTree, unsigned int inNode,
+															bool& outConstant, double& outValue) const
+{
+	static const std::map<std::string,unsigned int> lNoInputs;
+	const Beagle::GP::Primitive& lPrimitive = *inTree[inNode].mPrimitive;
+	const Bytecode::OpCode lOpCode = Bytecode::getOpCode(lPrimitive, lNoInputs);
+	outConstant = false;
+	if(lOpCode == Bytecode::eConstant) {
+		if(dynamic_cast<const Beagle::GP::EphemeralT<Double>*>(&lPrimitive) == NULL) return lPrimitive.getName();
+		Double lValue;
+		inTree[inNode].mPrimitive->getValue(lValue);
+		outConstant = true;
+		outValue = lValue.getWrappedValue();
+		return std::string("#")+dbl2str(outValue, 17);
+	}
+	
+	std::vector<std::string> lArguments;
+	std::vector<bool> lConstants;
+	std::vector<double> lValues;
+	unsigned int lChild = inNode+1;
+	while(lChild < inNode+inTree[inNode].mSubTreeSize) {
+		bool lConstant;
+		double lValue;
+		lArguments.push_back(getCanonicalForm(inTree, lChild, lConstant, lValue));
+		lConstants.push_back(lConstant);
+		lValues.push_back(lValue);
+		lChild += inTree[lChild].mSubTreeSize;
+	}
+	
+	if(lOpCode != Bytecode::eUnsupported) {
+		//Constant folding
+		bool lAllConstants = true;
+		for(unsigned int i = 0; i < lConstants.size(); ++i) lAllConstants = lAllConstants && lConstants[i];
+		if(lAllConstants) {
+			switch(lOpCode) {
+				case Bytecode::eAdd: outValue = lValues[0]+lValues[1]; break;
+				case Bytecode::eSubtract: outValue = lValues[0]-lValues[1]; break;
+				case Bytecode::eMultiply: outValue = lValues[0]*lValues[1]; break;
+				case Bytecode::eDivide: outValue = (std::fabs(lValues[1]) < 0.001) ? 1.0 : lValues[0]/lValues[1]; break;
+				case Bytecode::eSin: outValue = std::sin(lValues[0]); break;
+				case Bytecode::eCos: outValue = std::cos(lValues[0]); break;
+				case Bytecode::eExp: outValue = std::exp(lValues[0]); break;
+				default: break;
+			}
+			outConstant = true;
+			return std::string("#")+dbl2str(outValue, 17);
+		}
+		//Neutral operands
+		switch(lOpCode) {
+			case Bytecode::eAdd:
+				if(lConstants[0] && (lValues[0] == 0.)) return lArguments[1];
+				if(lConstants[1] && (lValues[1] == 0.)) return lArguments[0];
+				break;
+			case Bytecode::eSubtract:
+				if(lConstants[1] && (lValues[1] == 0.)) return lArguments[0];
+				break;
+			case Bytecode::eMultiply:
+				if(lConstants[0] && (lValues[0] == 1.)) return lArguments[1];
+				if(lConstants[1] && (lValues[1] == 1.)) return lArguments[0];
+				break;
+			case Bytecode::eDivide:
+				if(lConstants[1] && (lValues[1] == 1.)) return lArguments[0];
+				break;
+			default:
+				break;
+		}
+		//Commutative operands
+		if(((lOpCode == Bytecode::eAdd) || (lOpCode == Bytecode::eMultiply)) && (lArguments[1] < lArguments[0])) {
+			lArguments[0].swap(lArguments[1]);
+		}
+	}
+	
+	std::string lForm = (lOpCode == Bytecode::eUnsupported) ? lPrimitive.serialize() : lPrimitive.getName();
+	lForm += '(';
+	for(unsigned int i = 0; i < lArguments.size(); ++i) {
+		if(i > 0) lForm += ',';
+		lForm += lArguments[i];
+	}
+	lForm += ')';
+	return lForm;
+}
+
+
 /*!
  *  \brief Set the value of the named GP primitive of the primitive sets.
  *  \param inName Name of the variable to set.
@@ -98,3 +470,138 @@ void Beagle::MPI::GP::EvaluationOp::setValue(std::string inName,
 	}
 }
 
+
+/*!
+ *  \brief Bind the named GP primitive of the primitive sets to a slot.
+ *  \param inName Name of the variable to bind.
+ *  \param ioSystem System holding the primitive sets.
+ *  \return Slot to give to setValue.
+ *  \throw Beagle::RunTimeException If the named primitive is not found in any sets.
+ *
+ *  Call it once, in postInit, then set the variable for each fitness case
+ *  with setValue(slot, value), which holds the primitives instead of looking
+ *  them up by name.
+ */
+unsigned int Beagle::MPI::GP::EvaluationOp::bindValue(std::string inName, Beagle::System& ioSystem)
+{
+	Beagle::GP::PrimitiveSuperSet& lSuperSet = castObjectT<Beagle::GP::System&>(ioSystem).getPrimitiveSuperSet();
+	std::vector<Beagle::GP::Primitive::Handle> lPrimitives;
+	for(unsigned int i=0; i<lSuperSet.size(); i++) {
+		Beagle::GP::Primitive::Handle lPrimitive = lSuperSet[i]->getPrimitiveByName(inName);
+		if(lPrimitive) lPrimitives.push_back(lPrimitive);
+	}
+	if(lPrimitives.empty()) {
+		std::string lMessage = "The primitive named \"";
+		lMessage += inName;
+		lMessage += "\" was not found in any ";
+		lMessage += "of the primitive sets. Maybe the primitive was not properly inserted ";
+		lMessage += "or the name is mispelled.";
+		throw Beagle_RunTimeExceptionM(lMessage);
+	}
+	mBindings.push_back(lPrimitives);
+	return mBindings.size()-1;
+}
+
+
+/*!
+ *  \brief Bind named GP primitives, such as the inputs X1..Xn of a dataset, to consecutive slots.
+ *  \param inNames Names of the variables to bind.
+ *  \param ioSystem System holding the primitive sets.
+ *  \return Slot of the first variable, to give to setValues.
+ */
+unsigned int Beagle::MPI::GP::EvaluationOp::bindValues(const std::vector<std::string>& inNames, Beagle::System& ioSystem)
+{
+	const unsigned int lFirstSlot = mBindings.size();
+	for(unsigned int i=0; i<inNames.size(); i++) bindValue(inNames[i], ioSystem);
+	return lFirstSlot;
+}
+
+
+/*!
+ *  \brief Set the values of the named GP primitive for every fitness case.
+ *  \param inName Name of the variable, a token of Double.
+ *  \param inValues Value of the variable for each fitness case.
+ *
+ *  Used by runFitnessCases, which evaluates all the fitness cases at once.
+ */
+void Beagle::MPI::GP::EvaluationOp::setFitnessCases(std::string inName, const std::vector<double>& inValues)
+{
+	mInterpreter.setInput(inName, inValues);
+}
+
+
+/*!
+ *  \brief Run a GP individual over all the fitness cases at once.
+ *  \param inIndividual GP individual to run.
+ *  \param ioContext Context of the evaluation.
+ *  \param outResults Result of the individual for each fitness case set by setFitnessCases.
+ *  \return False if the individual cannot be run this way, it must then be run
+ *    case by case with setValue and Beagle::GP::Individual::run.
+ *
+ *  Only individuals made of a single tree of the primitives supported by
+ *  VectorInterpreter are run. The tree is compiled to bytecode on its first
+ *  run, and kept in a cache of ec.mpi.gp.cache programs, unless evaluateBatch
+ *  compiled it to native code. The results of its sub-trees are looked up in
+ *  and added to the sub-tree cache, whose statistics are logged at each new
+ *  generation.
+ */
+bool Beagle::MPI::GP::EvaluationOp::runFitnessCases(Beagle::GP::Individual& inIndividual,
+													Beagle::GP::Context& ioContext,
+													std::vector<double>& outResults)
+{
+	if(inIndividual.size() != 1) return false;
+	if(mInterpreter.getNbCases() == 0) return false;
+	if(!mNativeIndexes.empty()) {
+		std::map<const Beagle::GP::Tree*,unsigned int>::const_iterator lIter = mNativeIndexes.find(&(*inIndividual[0]));
+		if(lIter != mNativeIndexes.end()) {
+			std::vector<const double*> lInputs;
+			mInterpreter.getInputs(lInputs);
+			const std::vector<double>& lConstants = mNativePrograms[lIter->second].getConstants();
+			outResults.resize(mInterpreter.getNbCases());
+			mNativeFunctions[lIter->second](&lInputs[0], lConstants.empty() ? NULL : &lConstants[0],
+											mInterpreter.getNbCases(), &outResults[0]);
+			return true;
+		}
+	}
+	if(mCacheSize) {
+		mInterpreter.setCacheSize(mCacheSize->getWrappedValue());
+		mInterpreter.setSubtreeCache((unsigned long)(mSubtreeCacheSize->getWrappedValue())*1048576/sizeof(double),
+									 mSubtreeMinSize->getWrappedValue());
+	}
+	if(ioContext.getGeneration() != mStatsGeneration) {
+		logSubtreeStats(ioContext);
+		mStatsGeneration = ioContext.getGeneration();
+	}
+	const double lSavedWork = mInterpreter.getSavedWork();
+	const double lStart = MPI_Wtime();
+	if(!mInterpreter.run(*inIndividual[0], outResults)) return false;
+	mInterpretedTime += MPI_Wtime()-lStart;
+	mInterpretedWork += double(inIndividual[0]->size()) * mInterpreter.getNbCases();
+	mInterpretedWork -= mInterpreter.getSavedWork()-lSavedWork;
+	return true;
+}
+
+
+/*!
+ *  \brief Log the hit rate and the time saved by the sub-tree cache since the last call, and reset them.
+ *  \param ioContext Context of the evaluation.
+ *
+ *  The time saved is estimated from the time per node and fitness case of
+ *  the vector interpreter.
+ */
+void Beagle::MPI::GP::EvaluationOp::logSubtreeStats(Beagle::Context& ioContext)
+{
+	if(mInterpreter.getNbLookups() > 0) {
+		const double lHitRate = double(mInterpreter.getNbHits()) / mInterpreter.getNbLookups();
+		const double lTimePerWork = (mInterpretedWork > 0.) ? (mInterpretedTime/mInterpretedWork) : 0.;
+		Beagle_LogInfoM(
+						ioContext.getSystem().getLogger(),
+						"evaluation", "Beagle::MPI::GP::EvaluationOp",
+						std::string("Sub-tree cache of generation ")+uint2str(mStatsGeneration)+": "+
+						uint2str(mInterpreter.getNbHits())+" hits of "+uint2str(mInterpreter.getNbLookups())+
+						" lookups ("+dbl2str(100.*lHitRate, 3)+"%), about "+
+						dbl2str(mInterpreter.getSavedWork()*lTimePerWork, 3)+" s saved"
+						);
+	}
+	mInterpreter.resetStats();
+}
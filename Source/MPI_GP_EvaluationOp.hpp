@@ -36,7 +36,9 @@
 #ifndef Beagle_MPI_GP_EvaluationOp_hpp
 #define Beagle_MPI_GP_EvaluationOp_hpp
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include "beagle/config.hpp"
 #include "beagle/macros.hpp"
@@ -50,6 +52,8 @@
 #include "beagle/GP/Datum.hpp"
 
 #include "MPI_EvaluationOp.hpp"
+#include "MPI_GP_NativeCompiler.hpp"
+#include "MPI_GP_VectorInterpreter.hpp"
 
 namespace Beagle {
 namespace MPI {
@@ -79,7 +83,41 @@ public:
 	virtual ~EvaluationOp() { }
 	
 	virtual Fitness::Handle evaluate(Beagle::Individual& inIndividual, Beagle::Context& ioContext);
+	virtual void evaluateBatch(Beagle::Individual::Bag& ioIndividuals, Beagle::Context& ioContext);
+	virtual std::string getEquivalenceKey(Beagle::Individual& inIndividual, Beagle::Context& ioContext);
+	virtual void evaluateShard(Beagle::Individual& inIndividual, Beagle::Context& ioContext, std::vector<double>& outPartial);
+	virtual Fitness::Handle combineShards(Beagle::Individual& inIndividual, Beagle::Context& ioContext,
+										  const std::vector<double>& inTotal);
+	virtual void initialize(Beagle::System& ioSystem);
 	void setValue(std::string inName, const Object& inValue, Beagle::GP::Context& ioContext) const;
+	unsigned int bindValue(std::string inName, Beagle::System& ioSystem);
+	unsigned int bindValues(const std::vector<std::string>& inNames, Beagle::System& ioSystem);
+	
+	/*!
+	 *  \brief Set the value of the GP primitives bound to a slot.
+	 *  \param inSlot Slot returned by bindValue.
+	 *  \param inValue Value of the primitives.
+	 */
+	inline void setValue(unsigned int inSlot, const Object& inValue) const
+	{
+		const std::vector<Beagle::GP::Primitive::Handle>& lPrimitives = mBindings[inSlot];
+		for(unsigned int i=0; i<lPrimitives.size(); i++) lPrimitives[i]->setValue(inValue);
+	}
+	
+	/*!
+	 *  \brief Set the values of consecutive slots, as bound by bindValues.
+	 *  \param inFirstSlot Slot of the first value.
+	 *  \param inValues Values of the primitives, one per slot.
+	 */
+	template <class T>
+	void setValues(unsigned int inFirstSlot, const std::vector<T>& inValues) const
+	{
+		for(unsigned int i=0; i<inValues.size(); i++) setValue(inFirstSlot+i, inValues[i]);
+	}
+	
+	void setFitnessCases(std::string inName, const std::vector<double>& inValues);
+	bool runFitnessCases(Beagle::GP::Individual& inIndividual, Beagle::GP::Context& ioContext,
+						 std::vector<double>& outResults);
 	
 	/*!
 	 *  \brief Evaluate the fitness of the given GP individual.
@@ -88,6 +126,34 @@ public:
 	 *  \return Handle to the fitness value of the GP individual.
 	 */
 	virtual Fitness::Handle evaluate(Beagle::GP::Individual& inIndividual, Beagle::GP::Context& ioContext) =0;
+	virtual void evaluateShard(Beagle::GP::Individual& inIndividual, Beagle::GP::Context& ioContext,
+							   std::vector<double>& outPartial);
+	virtual Fitness::Handle combineShards(Beagle::GP::Individual& inIndividual, Beagle::GP::Context& ioContext,
+										  const std::vector<double>& inTotal);
+	
+protected:
+	void compileNative(Beagle::Individual::Bag& inIndividuals, Beagle::Context& ioContext);
+	void logSubtreeStats(Beagle::Context& ioContext);
+	std::string getCanonicalForm(const Beagle::GP::Tree& inTree, unsigned int inNode,
+								 bool& outConstant, double& outValue) const;
+	
+	VectorInterpreter mInterpreter;  //!< Interpreter of the trees over all the fitness cases.
+	UInt::Handle mCacheSize;         //!< Number of compiled trees kept by the interpreter.
+	UInt::Handle mSubtreeCacheSize;  //!< Size in MB of the cache of sub-tree results.
+	UInt::Handle mSubtreeMinSize;    //!< Minimum number of nodes of the sub-trees cached.
+	unsigned int mStatsGeneration;   //!< Generation of the sub-tree cache statistics.
+	Bool::Handle mDedup;             //!< Whether equivalent individuals share one evaluation.
+	Bool::Handle mNative;            //!< Whether batches may be compiled to native code.
+	String::Handle mNativeCommand;   //!< Command of the compiler of the native code.
+	NativeCompiler mNativeCompiler;  //!< Compiler of the native code.
+	std::vector<Bytecode> mNativePrograms;                  //!< Programs of the batch compiled to native code.
+	std::vector<NativeCompiler::Function> mNativeFunctions;  //!< Native code of each program.
+	std::map<const Beagle::GP::Tree*,unsigned int> mNativeIndexes;  //!< Program of each tree of the batch.
+	bool mNativeFailed;              //!< Whether the native compilation failed and is disabled.
+	double mInterpretedTime;         //!< Time spent running the vector interpreter.
+	double mInterpretedWork;         //!< Number of nodes times fitness cases run by the vector interpreter.
+	double mCompileTimePerNode;      //!< Time of the native compilation per node, last measured.
+	std::vector< std::vector<Beagle::GP::Primitive::Handle> > mBindings;  //!< Primitives bound to each slot.
 	
 };
 
@@ -0,0 +1,207 @@
+/*
+ *  MPI_GP_NativeCompiler.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/GP.hpp"
+#include "MPI_GP_NativeCompiler.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <dlfcn.h>
+#include <unistd.h>
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Construct a compiler without shared object.
+ */
+Beagle::MPI::GP::NativeCompiler::NativeCompiler() :
+mLibrary(NULL)
+{ }
+
+/*!
+ *  \brief Construct a compiler without shared object, the original keeping its own.
+ */
+Beagle::MPI::GP::NativeCompiler::NativeCompiler(const NativeCompiler&) :
+mLibrary(NULL)
+{ }
+
+/*!
+ *  \brief Unload the shared object.
+ */
+Beagle::MPI::GP::NativeCompiler::~NativeCompiler()
+{
+	unload();
+}
+
+/*!
+ *  \brief Keep the shared object of this compiler, the original keeping its own.
+ */
+Beagle::MPI::GP::NativeCompiler& Beagle::MPI::GP::NativeCompiler::operator=(const NativeCompiler&)
+{
+	return *this;
+}
+
+/*!
+ *  \brief Compile programs to native code and load them.
+ *  \param inPrograms Programs to compile.
+ *  \param inCommand Command of the compiler, the output and source files being appended.
+ *  \param outFunctions Function of each program.
+ *  \param outError Output of the compiler or loading error, on failure.
+ *  \return False if the compilation or the loading failed, no function is then returned.
+ *
+ *  The functions of the previous compilation are unloaded. The files are
+ *  written in a directory created under TMPDIR, /tmp if not set, and the
+ *  compiler is started with std::system, which forks the calling process.
+ */
+bool Beagle::MPI::GP::NativeCompiler::compile(const std::vector<Bytecode>& inPrograms, const std::string& inCommand,
+											  std::vector<Function>& outFunctions, std::string& outError)
+{
+	unload();
+	outFunctions.clear();
+	const char* lTemporary = std::getenv("TMPDIR");
+	std::string lTemplate = ((lTemporary != NULL) && (lTemporary[0] != '\0')) ? lTemporary : "/tmp";
+	lTemplate += "/mpibeagle-gp-XXXXXX";
+	std::vector<char> lBuffer(lTemplate.begin(), lTemplate.end());
+	lBuffer.push_back('\0');
+	if(mkdtemp(&lBuffer[0]) == NULL) {
+		outError = std::string("Unable to create a temporary directory from ")+lTemplate;
+		return false;
+	}
+	const std::string lDirectory(&lBuffer[0]);
+	const std::string lSource = lDirectory+"/programs.cpp";
+	const std::string lLibrary = lDirectory+"/programs.so";
+	const std::string lLog = lDirectory+"/compiler.log";
+
+	std::ofstream lStream(lSource.c_str());
+	lStream << "#include <cmath>" << std::endl;
+	for(unsigned int i = 0; i < inPrograms.size(); ++i) {
+		writeFunction(inPrograms[i], std::string("mpibeagle_gp_")+uint2str(i), lStream);
+	}
+	lStream.close();
+	if(lStream.fail()) {
+		outError = std::string("Unable to write the source file ")+lSource;
+		::unlink(lSource.c_str());
+		::rmdir(lDirectory.c_str());
+		return false;
+	}
+
+	const std::string lCommand = inCommand+" -o "+lLibrary+" "+lSource+" > "+lLog+" 2>&1";
+	const bool lCompiled = (std::system(lCommand.c_str()) == 0);
+	if(lCompiled) {
+		mLibrary = dlopen(lLibrary.c_str(), RTLD_NOW | RTLD_LOCAL);
+		if(mLibrary == NULL) outError = dlerror();
+	} else {
+		std::ifstream lLogStream(lLog.c_str());
+		std::ostringstream lOutput;
+		lOutput << lLogStream.rdbuf();
+		outError = std::string("Command \"")+lCommand+"\" failed: "+lOutput.str();
+	}
+	::unlink(lSource.c_str());
+	::unlink(lLibrary.c_str());
+	::unlink(lLog.c_str());
+	::rmdir(lDirectory.c_str());
+	if(mLibrary == NULL) return false;
+
+	for(unsigned int i = 0; i < inPrograms.size(); ++i) {
+		const std::string lName = std::string("mpibeagle_gp_")+uint2str(i);
+		void* lSymbol = dlsym(mLibrary, lName.c_str());
+		if(lSymbol == NULL) {
+			outError = std::string("Symbol ")+lName+" not found in the compiled programs";
+			unload();
+			outFunctions.clear();
+			return false;
+		}
+		outFunctions.push_back(reinterpret_cast<Function>(reinterpret_cast<size_t>(lSymbol)));
+	}
+	return true;
+}
+
+/*!
+ *  \brief Unload the shared object, the functions it holds are no longer valid.
+ */
+void Beagle::MPI::GP::NativeCompiler::unload()
+{
+	if(mLibrary != NULL) dlclose(mLibrary);
+	mLibrary = NULL;
+}
+
+/*!
+ *  \brief Write a program as a C++ function running over all the fitness cases.
+ *  \param inProgram Program to write.
+ *  \param inName Name of the function.
+ *  \param ioStream Stream receiving the source code.
+ *
+ *  Each instruction becomes a local variable, the stack of the program being
+ *  resolved at compilation.
+ */
+void Beagle::MPI::GP::NativeCompiler::writeFunction(const Bytecode& inProgram, const std::string& inName, std::ostream& ioStream)
+{
+	const std::vector<Bytecode::Instruction>& lCode = inProgram.getCode();
+	ioStream << "extern \"C\" void " << inName;
+	ioStream << "(const double* const* x, const double* c, unsigned int n, double* r) {" << std::endl;
+	ioStream << "for(unsigned int i = 0; i < n; ++i) {" << std::endl;
+	std::vector<unsigned int> lStack;
+	for(unsigned int i = 0; i < lCode.size(); ++i) {
+		ioStream << "const double t" << i << " = ";
+		unsigned int lFirst = 0, lSecond = 0;
+		switch(lCode[i].mOpCode) {
+			case Bytecode::eInput:
+				ioStream << "x[" << lCode[i].mArgument << "][i];" << std::endl;
+				lStack.push_back(i);
+				continue;
+			case Bytecode::eConstant:
+				ioStream << "c[" << lCode[i].mArgument << "];" << std::endl;
+				lStack.push_back(i);
+				continue;
+			case Bytecode::eSin:
+			case Bytecode::eCos:
+			case Bytecode::eExp:
+				lFirst = lStack.back();
+				lStack.pop_back();
+				break;
+			default:
+				lSecond = lStack.back();
+				lStack.pop_back();
+				lFirst = lStack.back();
+				lStack.pop_back();
+				break;
+		}
+		switch(lCode[i].mOpCode) {
+			case Bytecode::eAdd: ioStream << "t" << lFirst << "+t" << lSecond; break;
+			case Bytecode::eSubtract: ioStream << "t" << lFirst << "-t" << lSecond; break;
+			case Bytecode::eMultiply: ioStream << "t" << lFirst << "*t" << lSecond; break;
+			case Bytecode::eDivide:
+				ioStream << "(std::fabs(t" << lSecond << ") < 0.001) ? 1.0 : t" << lFirst << "/t" << lSecond;
+				break;
+			case Bytecode::eSin: ioStream << "std::sin(t" << lFirst << ")"; break;
+			case Bytecode::eCos: ioStream << "std::cos(t" << lFirst << ")"; break;
+			case Bytecode::eExp: ioStream << "std::exp(t" << lFirst << ")"; break;
+			default:
+				throw Beagle_RunTimeExceptionM("Unsupported instruction in the native compiler");
+		}
+		ioStream << ";" << std::endl;
+		lStack.push_back(i);
+	}
+	ioStream << "r[i] = t" << lStack.back() << ";" << std::endl;
+	ioStream << "}" << std::endl << "}" << std::endl;
+}
@@ -0,0 +1,70 @@
+/*
+ *  MPI_GP_NativeCompiler.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_GP_NativeCompiler_H
+#define MPI_GP_NativeCompiler_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "MPI_GP_Bytecode.hpp"
+
+namespace Beagle {
+namespace MPI {
+namespace GP {
+
+/*!
+ *  \class NativeCompiler MPI_GP_NativeCompiler.hpp "MPI_GP_NativeCompiler.hpp"
+ *  \brief Compiler of Bytecode programs to native code.
+ *
+ *  The programs of a batch are written as C++ functions in a single source
+ *  file, compiled by the system compiler into a shared object which is then
+ *  loaded with dlopen. Each function runs its program over all the fitness
+ *  cases, the constants being given at run time. The shared object stays
+ *  loaded until the next compilation or the destruction of the compiler; a
+ *  copy of the compiler starts without any.
+ */
+class NativeCompiler {
+public:
+	//! Compiled program: inputs by index, constants of the program, number of fitness cases, results.
+	typedef void (*Function)(const double* const* inInputs, const double* inConstants,
+							 unsigned int inNbCases, double* outResults);
+
+	NativeCompiler();
+	NativeCompiler(const NativeCompiler& inOriginal);
+	~NativeCompiler();
+	NativeCompiler& operator=(const NativeCompiler& inOriginal);
+
+	bool compile(const std::vector<Bytecode>& inPrograms, const std::string& inCommand,
+				 std::vector<Function>& outFunctions, std::string& outError);
+	void unload();
+
+	static void writeFunction(const Bytecode& inProgram, const std::string& inName, std::ostream& ioStream);
+
+protected:
+	void* mLibrary;   //!< Shared object loaded, NULL if none.
+};
+
+}
+}
+}
+
+#endif
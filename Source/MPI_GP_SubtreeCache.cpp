@@ -0,0 +1,129 @@
+/*
+ *  MPI_GP_SubtreeCache.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/GP.hpp"
+#include "MPI_GP_SubtreeCache.hpp"
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Construct an empty cache, disabled until given a capacity.
+ */
+Beagle::MPI::GP::SubtreeCache::SubtreeCache() :
+mCapacity(0),
+mSize(0)
+{ }
+
+/*!
+ *  \brief Set the maximum number of values kept, evicting results if needed.
+ *  \param inNbValues Number of values, 0 to disable the cache.
+ */
+void Beagle::MPI::GP::SubtreeCache::setCapacity(unsigned long inNbValues)
+{
+	mCapacity = inNbValues;
+	evict();
+}
+
+/*!
+ *  \brief Remove every result.
+ */
+void Beagle::MPI::GP::SubtreeCache::clear()
+{
+	mEntries.clear();
+	mIndex.clear();
+	mSize = 0;
+}
+
+/*!
+ *  \brief Return the results of a sub-tree, NULL if not kept.
+ *  \param inProgram Program holding the sub-tree.
+ *  \param inRoot Index of the root of the sub-tree in the program.
+ *
+ *  The results returned are only valid until the next insertion.
+ */
+const std::vector<double>* Beagle::MPI::GP::SubtreeCache::find(const Bytecode& inProgram, unsigned int inRoot)
+{
+	std::map<unsigned long,std::list<Entry>::iterator>::iterator lIter = mIndex.find(inProgram.getCode()[inRoot].mHash);
+	if(lIter == mIndex.end()) return NULL;
+	if(!matches(*lIter->second, inProgram, inRoot)) return NULL;
+	mEntries.splice(mEntries.begin(), mEntries, lIter->second);
+	return &mEntries.front().mValues;
+}
+
+/*!
+ *  \brief Keep the results of a sub-tree, replacing those of a sub-tree of the same hash.
+ *  \param inProgram Program holding the sub-tree.
+ *  \param inRoot Index of the root of the sub-tree in the program.
+ *  \param inValues Result of the sub-tree for each fitness case.
+ */
+void Beagle::MPI::GP::SubtreeCache::insert(const Bytecode& inProgram, unsigned int inRoot, const std::vector<double>& inValues)
+{
+	if(inValues.size() > mCapacity) return;
+	const Bytecode::Instruction& lRoot = inProgram.getCode()[inRoot];
+	std::map<unsigned long,std::list<Entry>::iterator>::iterator lIter = mIndex.find(lRoot.mHash);
+	if(lIter != mIndex.end()) {
+		mSize -= lIter->second->mValues.size();
+		mEntries.erase(lIter->second);
+		mIndex.erase(lIter);
+	}
+
+	mEntries.push_front(Entry());
+	Entry& lEntry = mEntries.front();
+	lEntry.mHash = lRoot.mHash;
+	const unsigned int lStart = inRoot+1-lRoot.mSize;
+	lEntry.mOpCodes.resize(lRoot.mSize);
+	lEntry.mOperands.resize(lRoot.mSize);
+	for(unsigned int i = 0; i < lRoot.mSize; ++i) {
+		lEntry.mOpCodes[i] = inProgram.getCode()[lStart+i].mOpCode;
+		lEntry.mOperands[i] = inProgram.getOperand(lStart+i);
+	}
+	lEntry.mValues = inValues;
+	mIndex[lRoot.mHash] = mEntries.begin();
+	mSize += inValues.size();
+	evict();
+}
+
+/*!
+ *  \brief Return true if an entry holds the results of the given sub-tree.
+ */
+bool Beagle::MPI::GP::SubtreeCache::matches(const Entry& inEntry, const Bytecode& inProgram, unsigned int inRoot) const
+{
+	const unsigned int lSize = inProgram.getCode()[inRoot].mSize;
+	if(inEntry.mOpCodes.size() != lSize) return false;
+	const unsigned int lStart = inRoot+1-lSize;
+	for(unsigned int i = 0; i < lSize; ++i) {
+		if(inEntry.mOpCodes[i] != inProgram.getCode()[lStart+i].mOpCode) return false;
+		if(inEntry.mOperands[i] != inProgram.getOperand(lStart+i)) return false;
+	}
+	return true;
+}
+
+/*!
+ *  \brief Remove the least recently used results until within the capacity.
+ */
+void Beagle::MPI::GP::SubtreeCache::evict()
+{
+	while((mSize > mCapacity) && !mEntries.empty()) {
+		mSize -= mEntries.back().mValues.size();
+		mIndex.erase(mEntries.back().mHash);
+		mEntries.pop_back();
+	}
+}
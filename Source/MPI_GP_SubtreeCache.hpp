@@ -0,0 +1,79 @@
+/*
+ *  MPI_GP_SubtreeCache.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_GP_SubtreeCache_H
+#define MPI_GP_SubtreeCache_H
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "MPI_GP_Bytecode.hpp"
+
+namespace Beagle {
+namespace MPI {
+namespace GP {
+
+/*!
+ *  \class SubtreeCache MPI_GP_SubtreeCache.hpp "MPI_GP_SubtreeCache.hpp"
+ *  \brief Results of sub-trees over all the fitness cases, by structural hash.
+ *
+ *  The individuals of a population share many sub-trees after crossover. The
+ *  VectorInterpreter keeps their results here so that a sub-tree found again,
+ *  in the same individual or in another one, is not run again. A hit is
+ *  checked against the instructions of the sub-tree. The least recently used
+ *  results are evicted to stay within the capacity.
+ */
+class SubtreeCache {
+public:
+	SubtreeCache();
+	~SubtreeCache() { }
+
+	void setCapacity(unsigned long inNbValues);
+	//! Return the maximum number of values kept.
+	unsigned long getCapacity() const { return mCapacity; }
+	void clear();
+
+	const std::vector<double>* find(const Bytecode& inProgram, unsigned int inRoot);
+	void insert(const Bytecode& inProgram, unsigned int inRoot, const std::vector<double>& inValues);
+
+protected:
+	//! Results of a sub-tree.
+	struct Entry {
+		unsigned long mHash;              //!< Structural hash of the sub-tree.
+		std::vector<int> mOpCodes;        //!< Operation of each instruction of the sub-tree.
+		std::vector<double> mOperands;    //!< Operand of each instruction of the sub-tree.
+		std::vector<double> mValues;      //!< Result of the sub-tree for each fitness case.
+	};
+
+	bool matches(const Entry& inEntry, const Bytecode& inProgram, unsigned int inRoot) const;
+	void evict();
+
+	std::list<Entry> mEntries;   //!< Entries, the most recently used first.
+	std::map<unsigned long,std::list<Entry>::iterator> mIndex;   //!< Entries by hash.
+	unsigned long mCapacity;     //!< Maximum number of values kept.
+	unsigned long mSize;         //!< Number of values kept.
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ *  MPI_GP_TreeCodec.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/GP.hpp"
+#include "MPI_GP_TreeCodec.hpp"
+
+#include <string>
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Construct the GP tree codec.
+ */
+Beagle::MPI::GP::TreeCodec::TreeCodec() :
+Beagle::MPI::Codec("gptree"),
+mXMLStream(mStreamOut)
+{ }
+
+/*!
+ *  \brief Append the encoding of a GP individual to a message.
+ *  \param inIndividual Individual to encode.
+ *  \param inPeer Rank of the receiving process.
+ *  \param ioContext Evolutionary context.
+ *  \param ioMessage Message to append to.
+ *  \return False if the individual is not made of GP trees built from the primitive sets of the system.
+ */
+bool Beagle::MPI::GP::TreeCodec::encodeIndividual(const Individual& inIndividual, int inPeer, Context& ioContext, std::string& ioMessage)
+{
+	Beagle::GP::Context* lGPContext = dynamic_cast<Beagle::GP::Context*>(&ioContext);
+	if(lGPContext == NULL) return false;
+	updateIndexes(lGPContext->getSystem().getPrimitiveSuperSet());
+
+	const unsigned int lStart = ioMessage.size();
+	appendValue<unsigned int>(ioMessage, inIndividual.size());
+	for(unsigned int i = 0; i < inIndividual.size(); ++i) {
+		const Beagle::GP::Tree* lTree = dynamic_cast<const Beagle::GP::Tree*>(inIndividual[i].getPointer());
+		if((lTree == NULL) || !encodeTree(*lTree, *lGPContext, ioMessage)) {
+			ioMessage.resize(lStart);
+			return false;
+		}
+	}
+	return true;
+}
+
+/*!
+ *  \brief Decode a GP individual encoded by this codec.
+ *  \param inBuffer Encoded individual.
+ *  \param inSize Size of the encoded individual.
+ *  \param inPeer Rank of the sending process.
+ *  \param ioIndividual Individual to fill.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::GP::TreeCodec::decodeIndividual(const char* inBuffer, unsigned int inSize, int inPeer, Individual& ioIndividual, Context& ioContext)
+{
+	Beagle::GP::Context& lGPContext = castObjectT<Beagle::GP::Context&>(ioContext);
+	const char* lCursor = inBuffer;
+	const char* lEnd = inBuffer+inSize;
+	const unsigned int lNbTrees = readValue<unsigned int>(lCursor, lEnd);
+	ioIndividual.resize(lNbTrees);
+	for(unsigned int i = 0; i < lNbTrees; ++i) {
+		decodeTree(lCursor, lEnd, castObjectT<Beagle::GP::Tree&>(*ioIndividual[i]), lGPContext);
+	}
+}
+
+/*!
+ *  \brief Append the encoding of a tree to a message.
+ *  \return False if the tree cannot be encoded.
+ */
+bool Beagle::MPI::GP::TreeCodec::encodeTree(const Beagle::GP::Tree& inTree, Beagle::GP::Context& ioContext, std::string& ioMessage)
+{
+	const unsigned int lSetIndex = inTree.getPrimitiveSetIndex();
+	if(lSetIndex >= mPrimitiveIndexes.size()) return false;
+	const std::map<const Beagle::GP::Primitive*,unsigned int>& lPrimitives = mPrimitiveIndexes[lSetIndex];
+	const std::map<std::string,unsigned int>& lNames = mNameIndexes[lSetIndex];
+
+	//Check that the sub-tree sizes can be rebuilt from the number of arguments
+	mSizeStack.clear();
+	for(unsigned int i = inTree.size(); i > 0; --i) {
+		const unsigned int lNbArgs = inTree[i-1].mPrimitive->getNumberArguments();
+		if(lNbArgs > mSizeStack.size()) return false;
+		unsigned int lSubTreeSize = 1;
+		for(unsigned int j = 0; j < lNbArgs; ++j) {
+			lSubTreeSize += mSizeStack.back();
+			mSizeStack.pop_back();
+		}
+		if(lSubTreeSize != inTree[i-1].mSubTreeSize) return false;
+		mSizeStack.push_back(lSubTreeSize);
+	}
+	if(mSizeStack.size() > 1) return false;
+
+	//Find the primitive indices, nodes with their own primitive instance go in the side table
+	std::string lValues;
+	unsigned int lNbValues = 0;
+	mIndexes.resize(inTree.size());
+	for(unsigned int i = 0; i < inTree.size(); ++i) {
+		const Beagle::GP::Primitive* lPrimitive = inTree[i].mPrimitive.getPointer();
+		std::map<const Beagle::GP::Primitive*,unsigned int>::const_iterator lIter = lPrimitives.find(lPrimitive);
+		if(lIter != lPrimitives.end()) {
+			mIndexes[i] = lIter->second;
+			continue;
+		}
+		std::map<std::string,unsigned int>::const_iterator lName = lNames.find(lPrimitive->getName());
+		if(lName == lNames.end()) return false;
+		mIndexes[i] = lName->second;
+		appendValue<unsigned int>(lValues, i);
+		//Subclasses such as GP::EphemeralDouble only hold their value too
+		if(dynamic_cast<const Beagle::GP::EphemeralT<Double>*>(lPrimitive) != NULL) {
+			Double lValue;
+			inTree[i].mPrimitive->getValue(lValue);
+			appendValue<char>(lValues, eDouble);
+			appendValue<double>(lValues, lValue.getWrappedValue());
+		} else {
+			mStreamOut.str("");
+			mXMLStream.openTag(lPrimitive->getName(), false);
+			lPrimitive->writeContent(mXMLStream, false);
+			mXMLStream.closeTag();
+			appendValue<char>(lValues, eXML);
+			appendValue<unsigned int>(lValues, mStreamOut.str().size());
+			lValues.append(mStreamOut.str());
+		}
+		++lNbValues;
+	}
+
+	const unsigned int lSetSize = mPrimitiveIndexes[lSetIndex].size();
+	const char lWidth = (lSetSize <= 0x100) ? 1 : ((lSetSize <= 0x10000) ? 2 : 4);
+	appendValue<unsigned int>(ioMessage, lSetIndex);
+	appendValue<unsigned int>(ioMessage, inTree.getNumberArguments());
+	appendValue<unsigned int>(ioMessage, inTree.size());
+	appendValue<char>(ioMessage, lWidth);
+	ioMessage.reserve(ioMessage.size() + lWidth*inTree.size() + sizeof(unsigned int) + lValues.size());
+	for(unsigned int i = 0; i < mIndexes.size(); ++i) {
+		switch(lWidth) {
+			case 1: appendValue<unsigned char>(ioMessage, mIndexes[i]); break;
+			case 2: appendValue<unsigned short>(ioMessage, mIndexes[i]); break;
+			default: appendValue<unsigned int>(ioMessage, mIndexes[i]); break;
+		}
+	}
+	appendValue<unsigned int>(ioMessage, lNbValues);
+	ioMessage.append(lValues);
+	return true;
+}
+
+/*!
+ *  \brief Decode a tree at the cursor position and move the cursor past it.
+ */
+void Beagle::MPI::GP::TreeCodec::decodeTree(const char*& ioCursor, const char* inEnd, Beagle::GP::Tree& ioTree, Beagle::GP::Context& ioContext)
+{
+	Beagle::GP::PrimitiveSuperSet& lSuperSet = ioContext.getSystem().getPrimitiveSuperSet();
+	const unsigned int lSetIndex = readValue<unsigned int>(ioCursor, inEnd);
+	const unsigned int lNbArgs = readValue<unsigned int>(ioCursor, inEnd);
+	const unsigned int lNbNodes = readValue<unsigned int>(ioCursor, inEnd);
+	const char lWidth = readValue<char>(ioCursor, inEnd);
+	if(lSetIndex >= lSuperSet.size()) {
+		throw Beagle_IOExceptionMessageM(std::string("primitive set index ")+uint2str(lSetIndex)+" is out of range");
+	}
+	if((lWidth != 1) && (lWidth != 2) && (lWidth != 4)) {
+		throw Beagle_IOExceptionMessageM("invalid primitive index width in GP tree message");
+	}
+	Beagle::GP::PrimitiveSet& lSet = *lSuperSet[lSetIndex];
+	ioTree.setPrimitiveSetIndex(lSetIndex);
+	ioTree.setNumberArguments(lNbArgs);
+	ioTree.resize(lNbNodes);
+
+	for(unsigned int i = 0; i < lNbNodes; ++i) {
+		unsigned int lIndex;
+		switch(lWidth) {
+			case 1: lIndex = readValue<unsigned char>(ioCursor, inEnd); break;
+			case 2: lIndex = readValue<unsigned short>(ioCursor, inEnd); break;
+			default: lIndex = readValue<unsigned int>(ioCursor, inEnd); break;
+		}
+		if(lIndex >= lSet.size()) {
+			throw Beagle_IOExceptionMessageM(std::string("primitive index ")+uint2str(lIndex)+" is out of range");
+		}
+		ioTree[i].mPrimitive = lSet[lIndex];
+	}
+
+	const unsigned int lNbValues = readValue<unsigned int>(ioCursor, inEnd);
+	for(unsigned int i = 0; i < lNbValues; ++i) {
+		const unsigned int lPosition = readValue<unsigned int>(ioCursor, inEnd);
+		if(lPosition >= lNbNodes) throw Beagle_IOExceptionMessageM("invalid node position in GP tree message");
+		Beagle::GP::Node& lNode = ioTree[lPosition];
+		switch(readValue<char>(ioCursor, inEnd)) {
+			case eDouble: {
+				//The primitive of the set gives an instance of its own class
+				const double lValue = readValue<double>(ioCursor, inEnd);
+				lNode.mPrimitive = lNode.mPrimitive->giveReference(lNode.mPrimitive->getNumberArguments(), ioContext);
+				lNode.mPrimitive->setValue(Double(lValue));
+				break;
+			}
+			case eXML: {
+				const unsigned int lLength = readValue<unsigned int>(ioCursor, inEnd);
+				if(ioCursor+lLength > inEnd) throw Beagle_IOExceptionMessageM("truncated message");
+				std::istringstream lStreamIn(std::string(ioCursor, lLength));
+				ioCursor += lLength;
+				PACC::XML::Document lXMLParser;
+				lXMLParser.parse(lStreamIn);
+				lNode.mPrimitive = lNode.mPrimitive->giveReference(lNode.mPrimitive->getNumberArguments(), ioContext);
+				lNode.mPrimitive->readWithContext(lXMLParser.getFirstRoot(), ioContext);
+				break;
+			}
+			default:
+				throw Beagle_IOExceptionMessageM("invalid value kind in GP tree message");
+		}
+	}
+
+	//Rebuild the sub-tree sizes
+	mSizeStack.clear();
+	for(unsigned int i = lNbNodes; i > 0; --i) {
+		const unsigned int lNbArgs = ioTree[i-1].mPrimitive->getNumberArguments();
+		if(lNbArgs > mSizeStack.size()) throw Beagle_IOExceptionMessageM("malformed GP tree message");
+		unsigned int lSubTreeSize = 1;
+		for(unsigned int j = 0; j < lNbArgs; ++j) {
+			lSubTreeSize += mSizeStack.back();
+			mSizeStack.pop_back();
+		}
+		ioTree[i-1].mSubTreeSize = lSubTreeSize;
+		mSizeStack.push_back(lSubTreeSize);
+	}
+}
+
+/*!
+ *  \brief Append the XML tags of the primitives to the dictionary.
+ *  \param ioContext Evolutionary context.
+ *  \param ioDictionary Dictionary to append to.
+ *
+ *  Trees that fall back to the XML codec are mostly made of these tags.
+ */
+void Beagle::MPI::GP::TreeCodec::appendDictionary(Context& ioContext, std::string& ioDictionary)
+{
+	Beagle::GP::Context* lGPContext = dynamic_cast<Beagle::GP::Context*>(&ioContext);
+	if(lGPContext == NULL) return;
+	Beagle::GP::PrimitiveSuperSet& lSuperSet = lGPContext->getSystem().getPrimitiveSuperSet();
+	ioDictionary += "<Genotype type=\"gptree\" size=\"\">";
+	for(unsigned int i = 0; i < lSuperSet.size(); ++i) {
+		const Beagle::GP::PrimitiveSet& lSet = *lSuperSet[i];
+		for(unsigned int j = 0; j < lSet.size(); ++j) {
+			ioDictionary += std::string("<") + lSet[j]->getName() + "></" + lSet[j]->getName() + ">";
+		}
+	}
+}
+
+/*!
+ *  \brief Index the primitives of the super set by address and by name.
+ */
+void Beagle::MPI::GP::TreeCodec::updateIndexes(Beagle::GP::PrimitiveSuperSet& inSuperSet)
+{
+	if(mPrimitiveIndexes.size() == inSuperSet.size()) return;
+	mPrimitiveIndexes.resize(inSuperSet.size());
+	mNameIndexes.resize(inSuperSet.size());
+	for(unsigned int i = 0; i < inSuperSet.size(); ++i) {
+		const Beagle::GP::PrimitiveSet& lSet = *inSuperSet[i];
+		mPrimitiveIndexes[i].clear();
+		mNameIndexes[i].clear();
+		for(unsigned int j = 0; j < lSet.size(); ++j) {
+			mPrimitiveIndexes[i][lSet[j].getPointer()] = j;
+			mNameIndexes[i][lSet[j]->getName()] = j;
+		}
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ *  MPI_GP_TreeCodec.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_GP_TreeCodec_H
+#define MPI_GP_TreeCodec_H
+
+#include <map>
+#include <vector>
+#include <sstream>
+#include <XML.hpp>
+
+#include "beagle/GP.hpp"
+#include "MPI_Codec.hpp"
+
+namespace Beagle {
+namespace MPI {
+namespace GP {
+
+/*!
+ *  \class TreeCodec MPI_GP_TreeCodec.hpp "MPI_GP_TreeCodec.hpp"
+ *  \brief Binary codec of GP individuals.
+ *
+ *  Each tree is sent as the prefix array of the indices of its primitives in
+ *  their primitive set. Sub-tree sizes are not sent, they are rebuilt from the
+ *  number of arguments of the primitives. Nodes that are not the primitive of
+ *  the set itself, such as ephemeral constants, go in a side table holding their
+ *  value: a raw double for Beagle::GP::EphemeralT<Double> and its subclasses, the
+ *  node being rebuilt by the primitive of the set, or the XML of the
+ *  node for any other primitive.
+ *
+ *  Message layout: number of trees, then for each tree its primitive set index,
+ *  number of arguments, number of nodes, index width in bytes, the indices, the
+ *  number of side table entries and the entries (node position, kind, value).
+ */
+class TreeCodec : public Beagle::MPI::Codec {
+public:
+	//! TreeCodec handle type.
+	typedef PointerT<TreeCodec,Beagle::MPI::Codec::Handle>
+	Handle;
+
+	TreeCodec();
+	virtual ~TreeCodec() { }
+
+	virtual bool encodeIndividual(const Individual& inIndividual, int inPeer, Context& ioContext, std::string& ioMessage);
+	virtual void decodeIndividual(const char* inBuffer, unsigned int inSize, int inPeer, Individual& ioIndividual, Context& ioContext);
+	virtual void appendDictionary(Context& ioContext, std::string& ioDictionary);
+
+protected:
+	//! Kind of value stored in the side table.
+	enum ValueKind { eDouble=0, eXML };
+
+	bool encodeTree(const Beagle::GP::Tree& inTree, Beagle::GP::Context& ioContext, std::string& ioMessage);
+	void decodeTree(const char*& ioCursor, const char* inEnd, Beagle::GP::Tree& ioTree, Beagle::GP::Context& ioContext);
+	void updateIndexes(Beagle::GP::PrimitiveSuperSet& inSuperSet);
+
+	std::vector< std::map<const Beagle::GP::Primitive*,unsigned int> > mPrimitiveIndexes; //!< Index of the primitives in each set.
+	std::vector< std::map<std::string,unsigned int> > mNameIndexes;   //!< Index of the primitive names in each set.
+	std::vector<unsigned int> mIndexes;      //!< Primitive indices of the tree being encoded.
+	std::vector<unsigned int> mSizeStack;    //!< Sub-tree sizes stack used to rebuild or check a tree.
+	std::ostringstream        mStreamOut;    //!< Output stream of the XML streamer.
+	PACC::XML::Streamer       mXMLStream;    //!< XML streamer used to write the side table nodes.
+};
+
+}
+}
+}
+
+#endif
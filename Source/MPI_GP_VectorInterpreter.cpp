@@ -0,0 +1,265 @@
+/*
+ *  MPI_GP_VectorInterpreter.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/GP.hpp"
+#include "MPI_GP_VectorInterpreter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Construct an interpreter without fitness cases.
+ */
+Beagle::MPI::GP::VectorInterpreter::VectorInterpreter() :
+mNbCases(0),
+mCacheSize(1024),
+mMinSubtreeSize(2),
+mNbLookups(0),
+mNbHits(0),
+mSavedWork(0.)
+{ }
+
+/*!
+ *  \brief Set the values of an input for every fitness case.
+ *  \param inName Name of the token of the input.
+ *  \param inValues Value of the input for each fitness case.
+ *
+ *  Every input must have the same number of fitness cases.
+ */
+void Beagle::MPI::GP::VectorInterpreter::setInput(const std::string& inName, const std::vector<double>& inValues)
+{
+	for(std::map<std::string,unsigned int>::const_iterator lIter = mInputIndexes.begin(); lIter != mInputIndexes.end(); ++lIter) {
+		if((lIter->first != inName) && (mInputs[lIter->second].size() != inValues.size())) {
+			throw Beagle_RunTimeExceptionM(std::string("The input \"")+inName+
+										   "\" does not have the number of fitness cases of the other inputs");
+		}
+	}
+	std::map<std::string,unsigned int>::const_iterator lIndex = mInputIndexes.find(inName);
+	if(lIndex == mInputIndexes.end()) {
+		//The token was compiled as a constant
+		mPrograms.clear();
+		mInputIndexes[inName] = mInputs.size();
+		mInputs.push_back(inValues);
+	} else {
+		mInputs[lIndex->second] = inValues;
+	}
+	mSubtreeCache.clear();
+	if(inValues.size() != mNbCases) {
+		mNbCases = inValues.size();
+		mBuffers.clear();
+	}
+}
+
+/*!
+ *  \brief Set the maximum number of compiled programs kept, 0 to disable the cache.
+ */
+void Beagle::MPI::GP::VectorInterpreter::setCacheSize(unsigned int inCacheSize)
+{
+	mCacheSize = inCacheSize;
+	if(mPrograms.size() > mCacheSize) mPrograms.clear();
+}
+
+/*!
+ *  \brief Set the capacity of the sub-tree cache and the size of the sub-trees kept.
+ *  \param inNbValues Maximum number of results of fitness cases kept, 0 to disable the cache.
+ *  \param inMinSize Minimum number of nodes of the sub-trees kept, at least 2.
+ */
+void Beagle::MPI::GP::VectorInterpreter::setSubtreeCache(unsigned long inNbValues, unsigned int inMinSize)
+{
+	mSubtreeCache.setCapacity(inNbValues);
+	mMinSubtreeSize = (inMinSize < 2) ? 2 : inMinSize;
+}
+
+/*!
+ *  \brief Reset the statistics of the sub-tree cache.
+ */
+void Beagle::MPI::GP::VectorInterpreter::resetStats()
+{
+	mNbLookups = 0;
+	mNbHits = 0;
+	mSavedWork = 0.;
+}
+
+/*!
+ *  \brief Return true if every primitive of a tree can be compiled.
+ *  \param inTree Tree to check.
+ */
+bool Beagle::MPI::GP::VectorInterpreter::isSupported(const Beagle::GP::Tree& inTree) const
+{
+	if(inTree.size() == 0) return false;
+	for(unsigned int i = 0; i < inTree.size(); ++i) {
+		if(Bytecode::getOpCode(*inTree[i].mPrimitive, mInputIndexes) == Bytecode::eUnsupported) return false;
+	}
+	return true;
+}
+
+/*!
+ *  \brief Interpret a tree over all the fitness cases.
+ *  \param inTree Tree to interpret.
+ *  \param outResults Result of the tree for each fitness case.
+ *  \return False if the tree holds a primitive that is not supported, nothing is then computed.
+ */
+bool Beagle::MPI::GP::VectorInterpreter::run(const Beagle::GP::Tree& inTree, std::vector<double>& outResults)
+{
+	const Bytecode* lProgram = compile(inTree);
+	if(lProgram == NULL) return false;
+	execute(*lProgram, outResults);
+	return true;
+}
+
+/*!
+ *  \brief Return the program of a tree, from the cache or compiled.
+ *  \param inTree Tree to compile.
+ *  \return Program of the tree, NULL if the tree cannot be compiled.
+ *
+ *  The cache is emptied once full, the program returned is only valid until
+ *  the next compilation.
+ */
+const Beagle::MPI::GP::Bytecode* Beagle::MPI::GP::VectorInterpreter::compile(const Beagle::GP::Tree& inTree)
+{
+	if(mCacheSize == 0) {
+		return mProgram.compile(inTree, mInputIndexes) ? &mProgram : NULL;
+	}
+
+	const unsigned long lHash = Bytecode::hash(inTree, mInputIndexes);
+	std::map<unsigned long,Bytecode>::iterator lIter = mPrograms.find(lHash);
+	if(lIter != mPrograms.end()) {
+		if(lIter->second.isCompiledFrom(inTree)) return &lIter->second;
+	} else {
+		if(mPrograms.size() >= mCacheSize) mPrograms.clear();
+		lIter = mPrograms.insert(std::make_pair(lHash, Bytecode())).first;
+	}
+	if(!lIter->second.compile(inTree, mInputIndexes)) {
+		mPrograms.erase(lIter);
+		return NULL;
+	}
+	return &lIter->second;
+}
+
+/*!
+ *  \brief Return the values of the inputs, by index.
+ *  \param outInputs Array of the values of each input, as indexed by the programs.
+ */
+void Beagle::MPI::GP::VectorInterpreter::getInputs(std::vector<const double*>& outInputs) const
+{
+	outInputs.resize(mInputs.size());
+	for(unsigned int i = 0; i < mInputs.size(); ++i) outInputs[i] = mInputs[i].empty() ? NULL : &mInputs[i][0];
+}
+
+/*!
+ *  \brief Run a program over all the fitness cases.
+ *  \param inProgram Program to run.
+ *  \param outResults Result of the program for each fitness case.
+ *
+ *  Each level of the stack is an array of all the fitness cases. The
+ *  arguments of an instruction are at the top of the stack, the result
+ *  replacing the first one.
+ *
+ *  At the start of the sub-trees large enough, from the largest one, the
+ *  sub-tree cache is looked up, a hit pushing the results kept and skipping
+ *  the sub-tree. The results of the sub-trees run are then kept.
+ */
+void Beagle::MPI::GP::VectorInterpreter::execute(const Bytecode& inProgram, std::vector<double>& outResults)
+{
+	outResults.resize(mNbCases);
+	if(mNbCases == 0) return;
+	if(mBuffers.size() < inProgram.getStackSize()) {
+		mBuffers.resize(inProgram.getStackSize(), std::vector<double>(mNbCases));
+	}
+
+	const std::vector<Bytecode::Instruction>& lCode = inProgram.getCode();
+	const std::vector<double>& lConstants = inProgram.getConstants();
+	const unsigned int lNbCases = mNbCases;
+	const bool lUseCache = (mSubtreeCache.getCapacity() > 0);
+	unsigned int lTop = 0;
+	for(unsigned int c = 0; c < lCode.size(); ++c) {
+		if(lUseCache) {
+			bool lHit = false;
+			for(unsigned int lRoot = inProgram.getLargestSubTree(c); lCode[lRoot].mSize >= mMinSubtreeSize;
+				lRoot = inProgram.getFirstArgument(lRoot)) {
+				++mNbLookups;
+				const std::vector<double>* lValues = mSubtreeCache.find(inProgram, lRoot);
+				if(lValues == NULL) continue;
+				std::copy(lValues->begin(), lValues->end(), mBuffers[lTop].begin());
+				++lTop;
+				++mNbHits;
+				mSavedWork += double(lCode[lRoot].mSize) * lNbCases;
+				c = lRoot;
+				lHit = true;
+				break;
+			}
+			if(lHit) continue;
+		}
+		double* lResult = NULL;
+		const double* lArgument = NULL;
+		switch(lCode[c].mOpCode) {
+			case Bytecode::eInput:
+				std::copy(mInputs[lCode[c].mArgument].begin(), mInputs[lCode[c].mArgument].end(), mBuffers[lTop].begin());
+				++lTop;
+				continue;
+			case Bytecode::eConstant:
+				std::fill(mBuffers[lTop].begin(), mBuffers[lTop].end(), lConstants[lCode[c].mArgument]);
+				++lTop;
+				continue;
+			case Bytecode::eSin:
+			case Bytecode::eCos:
+			case Bytecode::eExp:
+				lResult = &mBuffers[lTop-1][0];
+				break;
+			default:
+				lResult = &mBuffers[lTop-2][0];
+				lArgument = &mBuffers[lTop-1][0];
+				--lTop;
+				break;
+		}
+		switch(lCode[c].mOpCode) {
+			case Bytecode::eAdd:
+				for(unsigned int i = 0; i < lNbCases; ++i) lResult[i] += lArgument[i];
+				break;
+			case Bytecode::eSubtract:
+				for(unsigned int i = 0; i < lNbCases; ++i) lResult[i] -= lArgument[i];
+				break;
+			case Bytecode::eMultiply:
+				for(unsigned int i = 0; i < lNbCases; ++i) lResult[i] *= lArgument[i];
+				break;
+			case Bytecode::eDivide:
+				for(unsigned int i = 0; i < lNbCases; ++i) {
+					lResult[i] = (std::fabs(lArgument[i]) < 0.001) ? 1.0 : lResult[i]/lArgument[i];
+				}
+				break;
+			case Bytecode::eSin:
+				for(unsigned int i = 0; i < lNbCases; ++i) lResult[i] = std::sin(lResult[i]);
+				break;
+			case Bytecode::eCos:
+				for(unsigned int i = 0; i < lNbCases; ++i) lResult[i] = std::cos(lResult[i]);
+				break;
+			case Bytecode::eExp:
+				for(unsigned int i = 0; i < lNbCases; ++i) lResult[i] = std::exp(lResult[i]);
+				break;
+			default:
+				throw Beagle_RunTimeExceptionM("Unsupported instruction in the vector interpreter");
+		}
+		if(lUseCache && (lCode[c].mSize >= mMinSubtreeSize)) mSubtreeCache.insert(inProgram, c, mBuffers[lTop-1]);
+	}
+	std::copy(mBuffers[0].begin(), mBuffers[0].end(), outResults.begin());
+}
@@ -0,0 +1,98 @@
+/*
+ *  MPI_GP_VectorInterpreter.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_GP_VectorInterpreter_H
+#define MPI_GP_VectorInterpreter_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "beagle/GP.hpp"
+#include "MPI_GP_Bytecode.hpp"
+#include "MPI_GP_SubtreeCache.hpp"
+
+namespace Beagle {
+namespace MPI {
+namespace GP {
+
+/*!
+ *  \class VectorInterpreter MPI_GP_VectorInterpreter.hpp "MPI_GP_VectorInterpreter.hpp"
+ *  \brief Interpreter of GP trees over all the fitness cases at once.
+ *
+ *  Each named input, such as the "X" token of a symbolic regression, is given
+ *  as an array holding its value for every fitness case. A tree is compiled
+ *  to a postfix Bytecode program, run once on a stack of arrays, each
+ *  instruction being applied to whole arrays by plain loops the compiler can
+ *  vectorize, instead of walking the tree once per fitness case.
+ *
+ *  The compiled programs are kept in a cache indexed by the hash of their
+ *  tree, so that an individual sent again, or a copy of it, is not compiled
+ *  again. Trees holding a primitive without lowering in Bytecode must be run
+ *  by Beagle::GP::Individual::run.
+ *
+ *  The results of the sub-trees of at least a given size are also kept in a
+ *  SubtreeCache, and looked up before running a sub-tree.
+ */
+class VectorInterpreter {
+public:
+	VectorInterpreter();
+	~VectorInterpreter() { }
+
+	void setInput(const std::string& inName, const std::vector<double>& inValues);
+	//! Return the number of fitness cases of the inputs.
+	unsigned int getNbCases() const { return mNbCases; }
+	void setCacheSize(unsigned int inCacheSize);
+	void setSubtreeCache(unsigned long inNbValues, unsigned int inMinSize);
+	//! Return the number of sub-trees looked up in the sub-tree cache.
+	unsigned long getNbLookups() const { return mNbLookups; }
+	//! Return the number of sub-trees found in the sub-tree cache.
+	unsigned long getNbHits() const { return mNbHits; }
+	//! Return the number of instructions times fitness cases not run thanks to the sub-tree cache.
+	double getSavedWork() const { return mSavedWork; }
+	void resetStats();
+
+	bool isSupported(const Beagle::GP::Tree& inTree) const;
+	bool run(const Beagle::GP::Tree& inTree, std::vector<double>& outResults);
+	const Bytecode* compile(const Beagle::GP::Tree& inTree);
+	void getInputs(std::vector<const double*>& outInputs) const;
+
+protected:
+	void execute(const Bytecode& inProgram, std::vector<double>& outResults);
+
+	std::map<std::string,unsigned int> mInputIndexes;    //!< Index of the inputs, by name.
+	std::vector< std::vector<double> > mInputs;          //!< Values of the inputs.
+	unsigned int mNbCases;                               //!< Number of fitness cases.
+	std::vector< std::vector<double> > mBuffers;         //!< Stack of the program being run.
+	std::map<unsigned long,Bytecode> mPrograms;          //!< Compiled programs, by hash of their tree.
+	unsigned int mCacheSize;                             //!< Maximum number of programs kept.
+	Bytecode mProgram;                                   //!< Program compiled when the cache is disabled.
+	SubtreeCache mSubtreeCache;                          //!< Results of the sub-trees.
+	unsigned int mMinSubtreeSize;                        //!< Minimum size of the sub-trees kept.
+	unsigned long mNbLookups;                            //!< Number of sub-trees looked up.
+	unsigned long mNbHits;                               //!< Number of sub-trees found.
+	double mSavedWork;                                   //!< Instructions times fitness cases not run.
+};
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ *  MPI_Hierarchy.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/Beagle.hpp"
+#include "MPI_Hierarchy.hpp"
+
+#include <mpi.h>
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Construct a flat hierarchy, rank 0 serving every process.
+ */
+Beagle::MPI::Hierarchy::Hierarchy() :
+mBuilt(false),
+mRole(eRoot)
+{ }
+
+/*!
+ *  \brief Register the parameters of the hierarchy.
+ *  \param ioSystem System of the evolution.
+ */
+void Beagle::MPI::Hierarchy::initialize(System& ioSystem)
+{
+	if(ioSystem.getRegister().isRegistered("ec.mpi.hierarchy.arity")) {
+		mArity = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.hierarchy.arity"));
+	} else {
+		mArity = new UInt(0);
+		std::string lLongDescript = "Maximum number of workers served by a sub-master. The processes of ";
+		lLongDescript += "each node are grouped under sub-masters which receive blocks of individuals ";
+		lLongDescript += "from rank 0. The hierarchy does not use ec.mpi.worker.timeout: only the processes ";
+		lLongDescript += "that cannot be reached are dropped, and one which stops answering hangs the ";
+		lLongDescript += "generation. A value of 0 disables the hierarchy, rank 0 serving every worker.";
+		Register::Description lDescription(
+										   "MPI sub-master arity",
+										   "UInt",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.hierarchy.arity", mArity, lDescription);
+	}
+
+	if(ioSystem.getRegister().isRegistered("ec.mpi.hierarchy.block")) {
+		mBlockFactor = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.hierarchy.block"));
+	} else {
+		mBlockFactor = new UInt(4);
+		std::string lLongDescript = "Number of individuals per worker in the blocks sent to a sub-master. ";
+		lLongDescript += "Blocks get smaller at the end of a generation to balance the load.";
+		Register::Description lDescription(
+										   "MPI block size factor",
+										   "UInt",
+										   "4",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.hierarchy.block", mBlockFactor, lDescription);
+	}
+}
+
+/*!
+ *  \brief Build the hierarchy from the node topology.
+ *
+ *  Collective over MPI_COMM_WORLD when the hierarchy is enabled, it must be
+ *  called by every process. Does nothing once the hierarchy is built.
+ */
+void Beagle::MPI::Hierarchy::build()
+{
+	if(mBuilt) return;
+	mBuilt = true;
+
+	int lRank, lSize;
+	MPI_Comm_rank(MPI_COMM_WORLD, &lRank);
+	MPI_Comm_size(MPI_COMM_WORLD, &lSize);
+	mNbWorkers.assign(lSize, 0);
+	mChildren.clear();
+	mRole = (lRank == 0) ? eRoot : eWorker;
+	if(!isEnabled()) {
+		if(lRank == 0) for(int i = 1; i < lSize; ++i) mChildren.push_back(i);
+		return;
+	}
+
+	//Group the processes of each node, the key keeping the world order
+	MPI_Comm lNodeComm, lGroupComm;
+	int lNodeRank, lGroupSize;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, lRank, MPI_INFO_NULL, &lNodeComm);
+	MPI_Comm_rank(lNodeComm, &lNodeRank);
+	MPI_Comm_split(lNodeComm, lNodeRank / (mArity->getWrappedValue()+1), lRank, &lGroupComm);
+	MPI_Comm_size(lGroupComm, &lGroupSize);
+	std::vector<int> lMembers(lGroupSize);
+	MPI_Allgather(&lRank, 1, MPI_INT, &lMembers[0], 1, MPI_INT, lGroupComm);
+	MPI_Comm_free(&lGroupComm);
+	MPI_Comm_free(&lNodeComm);
+
+	//Tell rank 0 the number of workers of each sub-master, -1 for the workers
+	const bool lLeader = (lMembers[0] == lRank);
+	int lInfo = lLeader ? lGroupSize-1 : -1;
+	std::vector<int> lInfos(lSize);
+	MPI_Gather(&lInfo, 1, MPI_INT, &lInfos[0], 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	if(lRank == 0) {
+		for(unsigned int i = 1; i < lMembers.size(); ++i) mChildren.push_back(lMembers[i]);
+		for(int i = 1; i < lSize; ++i) {
+			if(lInfos[i] < 0) continue;
+			mChildren.push_back(i);
+			mNbWorkers[i] = lInfos[i];
+		}
+	} else if(lLeader && (lGroupSize > 1)) {
+		mRole = eSubMaster;
+		mChildren.assign(lMembers.begin()+1, lMembers.end());
+		mNbWorkers[lRank] = lGroupSize-1;
+	}
+}
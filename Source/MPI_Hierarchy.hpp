@@ -0,0 +1,88 @@
+/*
+ *  MPI_Hierarchy.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_Hierarchy_H
+#define MPI_Hierarchy_H
+
+#include <vector>
+
+#include "beagle/config.hpp"
+#include "beagle/macros.hpp"
+#include "beagle/Object.hpp"
+#include "beagle/PointerT.hpp"
+#include "beagle/System.hpp"
+#include "beagle/UInt.hpp"
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class Hierarchy MPI_Hierarchy.hpp "MPI_Hierarchy.hpp"
+ *  \brief Two levels dispatch tree of the evaluation processes.
+ *
+ *  The processes sharing a node, as given by MPI_Comm_split_type, are split in
+ *  groups of at most ec.mpi.hierarchy.arity workers plus a sub-master, the
+ *  process of lowest rank of the group. Rank 0 sends blocks of individuals to
+ *  the sub-masters, which dispatch them to their workers and send back the
+ *  fitnesses of a block all at once. The workers of the group of rank 0, and
+ *  the sub-masters without workers, are served directly by rank 0.
+ *
+ *  Disabled when the arity is 0, the default.
+ */
+class Hierarchy : public Object {
+public:
+	//! Hierarchy handle type.
+	typedef PointerT<Hierarchy,Object::Handle>
+	Handle;
+
+	//! Role of a process in the hierarchy.
+	enum Role { eRoot, eSubMaster, eWorker };
+
+	Hierarchy();
+	virtual ~Hierarchy() { }
+
+	void initialize(System& ioSystem);
+	void build();
+
+	//! Return true if the hierarchy is used.
+	bool isEnabled() const { return (mArity != NULL) && (mArity->getWrappedValue() > 0); }
+	//! Return the role of this process.
+	Role getRole() const { return mRole; }
+	//! Return the ranks of the processes served by this process.
+	const std::vector<int>& getChildren() const { return mChildren; }
+	//! Return the number of workers of a child, 0 if the child is a worker itself.
+	unsigned int getNbWorkers(int inRank) const { return mNbWorkers[inRank]; }
+	//! Return the number of individuals per worker in the blocks sent to the sub-masters.
+	unsigned int getBlockFactor() const { return (mBlockFactor == NULL) ? 4 : mBlockFactor->getWrappedValue(); }
+
+protected:
+	UInt::Handle mArity;        //!< Maximum number of workers of a sub-master, 0 to disable.
+	UInt::Handle mBlockFactor;  //!< Individuals per worker in a block.
+
+	bool                      mBuilt;      //!< True when the hierarchy is built.
+	Role                      mRole;       //!< Role of this process.
+	std::vector<int>          mChildren;   //!< Ranks of the processes served by this process.
+	std::vector<unsigned int> mNbWorkers;  //!< Number of workers of each process, indexed by rank.
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ *  MPI_Scheduler.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/Beagle.hpp"
+#include "MPI_Scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Beagle;
+
+namespace {
+	const double gSmoothing = 0.3;      //!< Weight of a new measure in the estimates.
+	const double gOverheadShare = 0.1;  //!< Largest share of the evaluation time spent in message overhead.
+	const double gSlowShare = 0.75;     //!< Relative throughput under which an evaluator is slow.
+
+	//! Compare deme indices by decreasing cost.
+	class LongerCost {
+	public:
+		explicit LongerCost(const std::vector<double>& inCosts) : mCosts(inCosts) { }
+		bool operator()(unsigned int inLeft, unsigned int inRight) const { return mCosts[inLeft] > mCosts[inRight]; }
+	private:
+		const std::vector<double>& mCosts;
+	};
+
+	//! Compare deme indices by increasing cost.
+	class ShorterCost {
+	public:
+		explicit ShorterCost(const std::vector<double>& inCosts) : mCosts(inCosts) { }
+		bool operator()(unsigned int inLeft, unsigned int inRight) const { return mCosts[inLeft] < mCosts[inRight]; }
+	private:
+		const std::vector<double>& mCosts;
+	};
+}
+
+
+/*!
+ *  \brief Construct a scheduler without estimates.
+ */
+Beagle::MPI::Scheduler::Scheduler() :
+mEvaluationTime(-1.),
+mOverhead(0.),
+mThroughputSum(0.),
+mFastest(0.),
+mNbKnown(0)
+{ }
+
+/*!
+ *  \brief Register the parameters of the scheduler.
+ *  \param ioSystem System of the evolution.
+ */
+void Beagle::MPI::Scheduler::initialize(System& ioSystem)
+{
+	if(ioSystem.getRegister().isRegistered("ec.mpi.schedule")) {
+		mPolicy = castHandleT<String>(ioSystem.getRegister().getEntry("ec.mpi.schedule"));
+	} else {
+		mPolicy = new String("longest");
+		std::string lLongDescript = "Order in which the individuals are sent to the evaluators: \"longest\" ";
+		lLongDescript += "to send first the individuals of highest expected evaluation cost (e.g. the largest ";
+		lLongDescript += "trees), \"shortest\" for the reverse, or \"index\" to keep the order of the deme.";
+		Register::Description lDescription(
+										   "MPI scheduling policy",
+										   "String",
+										   "longest",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.schedule", mPolicy, lDescription);
+	}
+
+	if(ioSystem.getRegister().isRegistered("ec.mpi.chunk")) {
+		mChunkPolicy = castHandleT<String>(ioSystem.getRegister().getEntry("ec.mpi.chunk"));
+	} else {
+		mChunkPolicy = new String("single");
+		std::string lLongDescript = "Number of individuals sent together to an evaluator: \"single\" for one ";
+		lLongDescript += "at a time, \"guided\" for the remaining individuals divided by the number of ";
+		lLongDescript += "evaluators, or \"factoring\" for half of it. Chunks are enlarged when the measured ";
+		lLongDescript += "message overhead is large compared to the evaluation time. Not used with sub-masters.";
+		Register::Description lDescription(
+										   "MPI chunk policy",
+										   "String",
+										   "single",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.chunk", mChunkPolicy, lDescription);
+	}
+}
+
+/*!
+ *  \brief Order the individuals to dispatch according to the policy.
+ *  \param inCosts Expected cost of the individuals, indexed as in the deme.
+ *  \param ioOrder Deme indices of the individuals to dispatch, reordered.
+ *
+ *  Individuals of equal cost keep their relative order.
+ */
+void Beagle::MPI::Scheduler::order(const std::vector<double>& inCosts, std::vector<unsigned int>& ioOrder) const
+{
+	const std::string& lPolicy = mPolicy->getWrappedValue();
+	if(lPolicy == "longest") {
+		std::stable_sort(ioOrder.begin(), ioOrder.end(), LongerCost(inCosts));
+	} else if(lPolicy == "shortest") {
+		std::stable_sort(ioOrder.begin(), ioOrder.end(), ShorterCost(inCosts));
+	} else if(lPolicy != "index") {
+		throw Beagle_RunTimeExceptionM(std::string("Unknown MPI scheduling policy \"")+lPolicy+"\"");
+	}
+}
+
+/*!
+ *  \brief Return the number of individuals of the next chunk.
+ *  \param inRemaining Number of individuals not yet sent.
+ *  \param inNbWorkers Number of evaluators.
+ */
+unsigned int Beagle::MPI::Scheduler::getChunkSize(unsigned int inRemaining, unsigned int inNbWorkers) const
+{
+	if(inRemaining == 0) return 0;
+	const std::string& lPolicy = mChunkPolicy->getWrappedValue();
+	double lChunk = 1.;
+	if(lPolicy == "guided") {
+		lChunk = std::ceil(double(inRemaining) / inNbWorkers);
+	} else if(lPolicy == "factoring") {
+		lChunk = std::ceil(double(inRemaining) / (2*inNbWorkers));
+	} else if(lPolicy != "single") {
+		throw Beagle_RunTimeExceptionM(std::string("Unknown MPI chunk policy \"")+lPolicy+"\"");
+	}
+	if((lPolicy != "single") && (mEvaluationTime >= 0.)) {
+		//Smallest chunk keeping the overhead below its share of the evaluation time,
+		//but no more than the fair share of an evaluator
+		const double lFairShare = std::ceil(double(inRemaining) / inNbWorkers);
+		if(mOverhead >= gOverheadShare*mEvaluationTime*lFairShare) lChunk = lFairShare;
+		else lChunk = std::max(lChunk, std::ceil(mOverhead / (gOverheadShare*mEvaluationTime)));
+	}
+	return std::min<unsigned int>(std::max(lChunk, 1.), inRemaining);
+}
+
+/*!
+ *  \brief Return the number of individuals of the next chunk of an evaluator.
+ *  \param inRemaining Number of individuals not yet sent.
+ *  \param inNbWorkers Number of evaluators.
+ *  \param inRank Rank of the evaluator.
+ *
+ *  The chunk is scaled by the speed of the evaluator relative to the mean.
+ */
+unsigned int Beagle::MPI::Scheduler::getChunkSize(unsigned int inRemaining, unsigned int inNbWorkers, int inRank) const
+{
+	const double lChunk = getChunkSize(inRemaining, inNbWorkers) * getRelativeSpeed(inRank);
+	return std::min<unsigned int>(std::max(std::floor(lChunk+0.5), 1.), inRemaining);
+}
+
+/*!
+ *  \brief Update the estimates with the times of a chunk.
+ *  \param inNbIndividuals Number of individuals of the chunk.
+ *  \param inRoundTrip Time from the sending of the chunk to the reception of its fitnesses.
+ *  \param inEvaluationTime Time spent by the evaluator in the evaluations.
+ */
+void Beagle::MPI::Scheduler::recordChunk(unsigned int inNbIndividuals, double inRoundTrip, double inEvaluationTime)
+{
+	if(inNbIndividuals == 0) return;
+	const double lEvaluationTime = inEvaluationTime / inNbIndividuals;
+	const double lOverhead = std::max(inRoundTrip-inEvaluationTime, 0.);
+	if(mEvaluationTime < 0.) {
+		mEvaluationTime = lEvaluationTime;
+		mOverhead = lOverhead;
+	} else {
+		mEvaluationTime = (1.-gSmoothing)*mEvaluationTime + gSmoothing*lEvaluationTime;
+		mOverhead = (1.-gSmoothing)*mOverhead + gSmoothing*lOverhead;
+	}
+}
+
+/*!
+ *  \brief Update the throughput estimate of an evaluator.
+ *  \param inRank Rank of the evaluator.
+ *  \param inCost Expected cost of the individuals it evaluated.
+ *  \param inSeconds Time from the sending of the individuals to the reception of their fitnesses.
+ */
+void Beagle::MPI::Scheduler::recordWorker(int inRank, double inCost, double inSeconds)
+{
+	if((inCost <= 0.) || (inSeconds <= 0.)) return;
+	if(inRank >= (int)mThroughputs.size()) mThroughputs.resize(inRank+1, 0.);
+	const double lThroughput = inCost / inSeconds;
+	mThroughputSum -= mThroughputs[inRank];
+	if(mThroughputs[inRank] == 0.) {
+		mThroughputs[inRank] = lThroughput;
+		++mNbKnown;
+	} else {
+		mThroughputs[inRank] = (1.-gSmoothing)*mThroughputs[inRank] + gSmoothing*lThroughput;
+	}
+	mThroughputSum += mThroughputs[inRank];
+	//The fastest is taken from the current estimates, as it may slow down too
+	mFastest = *std::max_element(mThroughputs.begin(), mThroughputs.end());
+}
+
+/*!
+ *  \brief Return the throughput of an evaluator relative to the mean, 1 if unknown.
+ *  \param inRank Rank of the evaluator.
+ */
+double Beagle::MPI::Scheduler::getRelativeSpeed(int inRank) const
+{
+	if((inRank >= (int)mThroughputs.size()) || (mThroughputs[inRank] == 0.)) return 1.;
+	return mThroughputs[inRank] * mNbKnown / mThroughputSum;
+}
+
+/*!
+ *  \brief Return true if an evaluator is much slower than the fastest one.
+ *  \param inRank Rank of the evaluator.
+ */
+bool Beagle::MPI::Scheduler::isSlow(int inRank) const
+{
+	if((inRank >= (int)mThroughputs.size()) || (mThroughputs[inRank] == 0.)) return false;
+	return mThroughputs[inRank] < gSlowShare*mFastest;
+}
+
+/*!
+ *  \brief Return the fastest idle evaluator.
+ *  \param inProcess Work of each process, -1 for the idle ones.
+ *  \return Rank of the evaluator, the size of inProcess if none is idle.
+ */
+unsigned int Beagle::MPI::Scheduler::selectWorker(const std::vector<int>& inProcess) const
+{
+	unsigned int lBest = inProcess.size();
+	double lBestSpeed = 0.;
+	for(unsigned int i = 0; i < inProcess.size(); ++i) {
+		if(inProcess[i] != -1) continue;
+		const double lSpeed = getRelativeSpeed(i);
+		if((lBest == inProcess.size()) || (lSpeed > lBestSpeed)) {
+			lBest = i;
+			lBestSpeed = lSpeed;
+		}
+	}
+	return lBest;
+}
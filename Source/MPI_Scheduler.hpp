@@ -0,0 +1,103 @@
+/*
+ *  MPI_Scheduler.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_Scheduler_H
+#define MPI_Scheduler_H
+
+#include <vector>
+
+#include "beagle/config.hpp"
+#include "beagle/macros.hpp"
+#include "beagle/Object.hpp"
+#include "beagle/PointerT.hpp"
+#include "beagle/System.hpp"
+#include "beagle/String.hpp"
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class Scheduler MPI_Scheduler.hpp "MPI_Scheduler.hpp"
+ *  \brief Order in which rank 0 dispatches the individuals of a deme.
+ *
+ *  With the "longest" policy, the default, the individuals expected to take
+ *  the longest to evaluate are sent first, so that no long evaluation starts
+ *  at the end of the generation while the other evaluators are idle. The
+ *  expected cost of an individual is given by EvaluationOp::getEvaluationCost.
+ *  The "index" policy keeps the order of the deme.
+ *
+ *  The scheduler also sizes the chunks of individuals sent together to an
+ *  evaluator. With guided self-scheduling, a chunk holds the number of
+ *  remaining individuals divided by the number of evaluators, and with
+ *  factoring half of it, so that the chunks shrink toward the end of the
+ *  generation. The evaluators report the time spent evaluating each chunk,
+ *  from which the time per individual and the overhead per message are
+ *  estimated. Chunks are never made so small that the overhead exceeds a
+ *  tenth of the evaluation time.
+ *
+ *  Evaluators may not run at the same speed. The throughput of each one, in
+ *  cost units per second, is estimated from the round trips of its messages.
+ *  Idle evaluators are served fastest first, chunks are scaled by the relative
+ *  speed of their evaluator, and at the end of the generation the evaluators
+ *  much slower than the fastest one only receive the cheapest individuals.
+ */
+class Scheduler : public Object {
+public:
+	//! Scheduler handle type.
+	typedef PointerT<Scheduler,Object::Handle>
+	Handle;
+
+	Scheduler();
+	virtual ~Scheduler() { }
+
+	void initialize(System& ioSystem);
+
+	//! Return true if the individuals are ordered by their expected cost.
+	bool isCostOrdered() const { return (mPolicy != NULL) && (mPolicy->getWrappedValue() != "index"); }
+
+	//! Return true if the individuals are sent in chunks.
+	bool isChunked() const { return (mChunkPolicy != NULL) && (mChunkPolicy->getWrappedValue() != "single"); }
+
+	void         order(const std::vector<double>& inCosts, std::vector<unsigned int>& ioOrder) const;
+	unsigned int getChunkSize(unsigned int inRemaining, unsigned int inNbWorkers) const;
+	unsigned int getChunkSize(unsigned int inRemaining, unsigned int inNbWorkers, int inRank) const;
+	void         recordChunk(unsigned int inNbIndividuals, double inRoundTrip, double inEvaluationTime);
+
+	void         recordWorker(int inRank, double inCost, double inSeconds);
+	double       getRelativeSpeed(int inRank) const;
+	bool         isSlow(int inRank) const;
+	unsigned int selectWorker(const std::vector<int>& inProcess) const;
+
+protected:
+	String::Handle mPolicy;       //!< Dispatch order, "longest", "shortest" or "index".
+	String::Handle mChunkPolicy;  //!< Chunk sizing, "single", "guided" or "factoring".
+
+	double mEvaluationTime;  //!< Estimated evaluation time of an individual in seconds, negative if unknown.
+	double mOverhead;        //!< Estimated time per message not spent evaluating, in seconds.
+	std::vector<double> mThroughputs;  //!< Estimated throughput of each evaluator, 0 if unknown.
+	double       mThroughputSum;       //!< Sum of the known throughputs.
+	double       mFastest;             //!< Highest current throughput estimate.
+	unsigned int mNbKnown;             //!< Number of evaluators of known throughput.
+};
+
+}
+}
+
+#endif
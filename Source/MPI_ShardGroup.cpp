@@ -0,0 +1,119 @@
+/*
+ *  MPI_ShardGroup.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/Beagle.hpp"
+#include "MPI_ShardGroup.hpp"
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Construct the groups, each evaluator evaluating all the fitness cases.
+ */
+Beagle::MPI::ShardGroup::ShardGroup() :
+mBuilt(false),
+mRole(eNone),
+mComm(MPI_COMM_NULL),
+mGroupRank(0),
+mGroupSize(1)
+{ }
+
+/*!
+ *  \brief Register the parameters of the groups.
+ *  \param ioSystem System of the evolution.
+ */
+void Beagle::MPI::ShardGroup::initialize(System& ioSystem)
+{
+	if(ioSystem.getRegister().isRegistered("ec.mpi.shard.size")) {
+		mSize = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.shard.size"));
+	} else {
+		mSize = new UInt(1);
+		std::string lLongDescript = "Number of evaluators sharing the fitness cases of an individual. ";
+		lLongDescript += "The evaluators are split in groups of that many consecutive ranks, rank 0 sending ";
+		lLongDescript += "the individuals to the first process of each group, which broadcasts them to its ";
+		lLongDescript += "group and reduces the results of every shard. The evaluation operator must ";
+		lLongDescript += "overload evaluateShard and combineShards. Not used with sub-masters nor with ";
+		lLongDescript += "ec.mpi.eval.timeout. A value of 0 or 1 disables the sharding.";
+		Register::Description lDescription(
+										   "MPI fitness case shards",
+										   "UInt",
+										   "1",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.shard.size", mSize, lDescription);
+	}
+}
+
+/*!
+ *  \brief Split the evaluators in groups.
+ *
+ *  Collective over MPI_COMM_WORLD when the sharding is enabled, it must be
+ *  called by every process. Does nothing once the groups are built. A group
+ *  left with a single process, the last one, evaluates all the fitness cases.
+ */
+void Beagle::MPI::ShardGroup::build()
+{
+	if(mBuilt) return;
+	mBuilt = true;
+	if(!isEnabled()) return;
+
+	int lRank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &lRank);
+	const int lColor = (lRank == 0) ? MPI_UNDEFINED : (lRank-1) / int(mSize->getWrappedValue());
+	MPI_Comm lComm;
+	MPI_Comm_split(MPI_COMM_WORLD, lColor, lRank, &lComm);
+	if(lComm == MPI_COMM_NULL) return;
+
+	MPI_Comm_rank(lComm, &mGroupRank);
+	MPI_Comm_size(lComm, &mGroupSize);
+	if(mGroupSize == 1) {
+		MPI_Comm_free(&lComm);
+		return;
+	}
+	mComm = lComm;
+	mRole = (mGroupRank == 0) ? eLeader : eMember;
+}
+
+/*!
+ *  \brief Return true if a process only evaluates the shards of its leader.
+ *  \param inRank Rank of the process in MPI_COMM_WORLD.
+ *
+ *  Rank 0 uses it to send the individuals to the leaders only.
+ */
+bool Beagle::MPI::ShardGroup::isMember(int inRank) const
+{
+	if(!isEnabled() || (inRank <= 0)) return false;
+	return ((inRank-1) % int(mSize->getWrappedValue())) != 0;
+}
+
+/*!
+ *  \brief Return the fitness cases evaluated by this process.
+ *  \param inNbCases Total number of fitness cases.
+ *  \param outBegin Index of the first fitness case of the shard.
+ *  \param outEnd Index past the last fitness case of the shard.
+ *
+ *  The fitness cases are split in contiguous shards of sizes differing by at
+ *  most one, in the order of the ranks of the group.
+ */
+void Beagle::MPI::ShardGroup::getShardRange(unsigned int inNbCases, unsigned int& outBegin, unsigned int& outEnd) const
+{
+	outBegin = static_cast<unsigned int>((static_cast<unsigned long>(inNbCases)*mGroupRank) / mGroupSize);
+	outEnd = static_cast<unsigned int>((static_cast<unsigned long>(inNbCases)*(mGroupRank+1)) / mGroupSize);
+}
@@ -0,0 +1,92 @@
+/*
+ *  MPI_ShardGroup.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_ShardGroup_H
+#define MPI_ShardGroup_H
+
+#include <mpi.h>
+
+#include "beagle/config.hpp"
+#include "beagle/macros.hpp"
+#include "beagle/Object.hpp"
+#include "beagle/PointerT.hpp"
+#include "beagle/System.hpp"
+#include "beagle/UInt.hpp"
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class ShardGroup MPI_ShardGroup.hpp "MPI_ShardGroup.hpp"
+ *  \brief Groups of evaluators sharing the fitness cases of each individual.
+ *
+ *  The evaluators are split in groups of ec.mpi.shard.size consecutive ranks.
+ *  Rank 0 only sends individuals to the leader of each group, its lowest rank.
+ *  The leader broadcasts each individual to its group, every process of the
+ *  group evaluates it on its own shard of the fitness cases, and the partial
+ *  results are reduced to the leader which computes the fitness. Individuals
+ *  are thus evaluated in parallel across the groups, and each one in parallel
+ *  over the fitness cases within a group.
+ *
+ *  Disabled when the group size is 0 or 1, the default.
+ */
+class ShardGroup : public Object {
+public:
+	//! ShardGroup handle type.
+	typedef PointerT<ShardGroup,Object::Handle>
+	Handle;
+
+	//! Role of a process in its group.
+	enum Role { eNone, eLeader, eMember };
+
+	ShardGroup();
+	virtual ~ShardGroup() { }
+
+	void initialize(System& ioSystem);
+	void build();
+
+	//! Return true if the fitness cases are sharded.
+	bool isEnabled() const { return (mSize != NULL) && (mSize->getWrappedValue() > 1); }
+	//! Return the role of this process, eNone if it does not belong to a group of several processes.
+	Role getRole() const { return mRole; }
+	//! Return the communicator of the group of this process, MPI_COMM_NULL if none.
+	MPI_Comm getComm() const { return mComm; }
+	//! Return the rank of this process in its group.
+	int getGroupRank() const { return mGroupRank; }
+	//! Return the number of processes of the group of this process.
+	int getGroupSize() const { return mGroupSize; }
+
+	bool isMember(int inRank) const;
+	void getShardRange(unsigned int inNbCases, unsigned int& outBegin, unsigned int& outEnd) const;
+
+protected:
+	UInt::Handle mSize;  //!< Number of evaluators per group, 0 or 1 to disable.
+
+	bool     mBuilt;      //!< True when the groups are built.
+	Role     mRole;       //!< Role of this process.
+	MPI_Comm mComm;       //!< Communicator of the group of this process.
+	int      mGroupRank;  //!< Rank of this process in its group.
+	int      mGroupSize;  //!< Number of processes of the group of this process.
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ *  MPI_SharedChannel.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/Beagle.hpp"
+#include "MPI_SharedChannel.hpp"
+
+#include <cstring>
+
+using namespace Beagle;
+
+namespace {
+	//! Slot header: generation and size of the message.
+	const unsigned int gHeaderSize = 2*sizeof(unsigned int);
+}
+
+
+/*!
+ *  \brief Construct a disabled shared channel.
+ */
+Beagle::MPI::SharedChannel::SharedChannel() :
+mBuilt(false),
+mWindow(MPI_WIN_NULL),
+mCapacity(0)
+{ }
+
+/*!
+ *  \brief Register the parameters of the shared channel.
+ *  \param ioSystem System of the evolution.
+ */
+void Beagle::MPI::SharedChannel::initialize(System& ioSystem)
+{
+	if(ioSystem.getRegister().isRegistered("ec.mpi.shm.size")) {
+		mSlotSize = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.shm.size"));
+	} else {
+		mSlotSize = new UInt(0);
+		std::string lLongDescript = "Size in bytes of the shared memory slot of each evaluator running on ";
+		lLongDescript += "the node of rank 0. Individuals and fitnesses fitting in a slot are exchanged ";
+		lLongDescript += "through shared memory. A value of 0 disables shared memory.";
+		Register::Description lDescription(
+										   "MPI shared memory slot size",
+										   "UInt",
+										   "0",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.shm.size", mSlotSize, lDescription);
+	}
+}
+
+/*!
+ *  \brief Allocate the shared window on the node of rank 0.
+ *
+ *  Collective over MPI_COMM_WORLD when enabled, it must be called by every
+ *  process. Does nothing once built. The window lives until teardown.
+ */
+void Beagle::MPI::SharedChannel::build()
+{
+	if(mBuilt) return;
+	mBuilt = true;
+	if((mSlotSize == NULL) || (mSlotSize->getWrappedValue() <= gHeaderSize)) return;
+
+	int lRank, lSize;
+	MPI_Comm_rank(MPI_COMM_WORLD, &lRank);
+	MPI_Comm_size(MPI_COMM_WORLD, &lSize);
+	MPI_Comm lNodeComm;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, lRank, MPI_INFO_NULL, &lNodeComm);
+	int lLowest;
+	MPI_Allreduce(&lRank, &lLowest, 1, MPI_INT, MPI_MIN, lNodeComm);
+	if(lLowest != 0) {
+		MPI_Comm_free(&lNodeComm);
+		return;
+	}
+
+	int lNodeSize;
+	MPI_Comm_size(lNodeComm, &lNodeSize);
+	std::vector<int> lMembers(lNodeSize);
+	MPI_Allgather(&lRank, 1, MPI_INT, &lMembers[0], 1, MPI_INT, lNodeComm);
+
+	//Rank 0 holds all the slots, so that they are contiguous in its memory
+	const unsigned int lSlotSize = mSlotSize->getWrappedValue();
+	const MPI_Aint lWindowSize = (lRank == 0) ? MPI_Aint(lSlotSize)*lNodeSize : 0;
+	char* lBase;
+	MPI_Win_allocate_shared(lWindowSize, 1, MPI_INFO_NULL, lNodeComm, &lBase, &mWindow);
+	MPI_Aint lQuerySize;
+	int lDispUnit;
+	char* lSlab;
+	MPI_Win_shared_query(mWindow, 0, &lQuerySize, &lDispUnit, &lSlab);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, mWindow);
+	MPI_Comm_free(&lNodeComm);
+
+	mCapacity = lSlotSize - gHeaderSize;
+	mSlots.assign(lSize, NULL);
+	for(int i = 1; i < lNodeSize; ++i) mSlots[lMembers[i]] = lSlab + MPI_Aint(lSlotSize)*i;
+}
+
+/*!
+ *  \brief Free the shared window at the end of the evolution.
+ *
+ *  Collective over the node of rank 0 when a window was allocated, it must be
+ *  called by every process once the slots are no longer used. The channel is
+ *  disabled afterwards.
+ */
+void Beagle::MPI::SharedChannel::teardown()
+{
+	if(mWindow == MPI_WIN_NULL) return;
+	MPI_Win_unlock_all(mWindow);
+	MPI_Win_free(&mWindow);
+	mSlots.clear();
+	mCapacity = 0;
+}
+
+/*!
+ *  \brief Write a message in the slot of a process.
+ *  \param inRank Rank of the process owning the slot.
+ *  \param inMessage Message to write.
+ *  \param inSize Size of the message, at most the slot capacity.
+ *  \param inGeneration Generation stored with the message.
+ *
+ *  The other end must be notified by a message after this call.
+ */
+void Beagle::MPI::SharedChannel::write(int inRank, const char* inMessage, unsigned int inSize, unsigned int inGeneration)
+{
+	char* lSlot = mSlots[inRank];
+	std::memcpy(lSlot, &inGeneration, sizeof(unsigned int));
+	std::memcpy(lSlot+sizeof(unsigned int), &inSize, sizeof(unsigned int));
+	std::memcpy(lSlot+gHeaderSize, inMessage, inSize);
+	MPI_Win_sync(mWindow);
+}
+
+/*!
+ *  \brief Read the message of the slot of a process, once notified.
+ *  \param inRank Rank of the process owning the slot.
+ *  \param outSize Size of the message.
+ *  \param outGeneration Generation stored with the message.
+ *  \return Message, in shared memory, valid until the slot is written again.
+ */
+const char* Beagle::MPI::SharedChannel::read(int inRank, unsigned int& outSize, unsigned int& outGeneration)
+{
+	MPI_Win_sync(mWindow);
+	const char* lSlot = mSlots[inRank];
+	std::memcpy(&outGeneration, lSlot, sizeof(unsigned int));
+	std::memcpy(&outSize, lSlot+sizeof(unsigned int), sizeof(unsigned int));
+	if(outSize > mCapacity) throw Beagle_IOExceptionMessageM("corrupted shared memory slot");
+	return lSlot+gHeaderSize;
+}
@@ -0,0 +1,82 @@
+/*
+ *  MPI_SharedChannel.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_SharedChannel_H
+#define MPI_SharedChannel_H
+
+#include <vector>
+#include <mpi.h>
+
+#include "beagle/config.hpp"
+#include "beagle/macros.hpp"
+#include "beagle/Object.hpp"
+#include "beagle/PointerT.hpp"
+#include "beagle/System.hpp"
+#include "beagle/UInt.hpp"
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class SharedChannel MPI_SharedChannel.hpp "MPI_SharedChannel.hpp"
+ *  \brief Shared memory slots between rank 0 and the evaluators of its node.
+ *
+ *  Rank 0 allocates with MPI_Win_allocate_shared one slot of ec.mpi.shm.size
+ *  bytes per process of its node. An individual is written once in the slot
+ *  of its evaluator, which decodes it in place and writes the fitness back in
+ *  the same slot. Only the message size travels as an MPI message, to notify
+ *  the other end. Messages too large for a slot go through the usual sends.
+ *
+ *  Disabled when the slot size is 0, the default.
+ */
+class SharedChannel : public Object {
+public:
+	//! SharedChannel handle type.
+	typedef PointerT<SharedChannel,Object::Handle>
+	Handle;
+
+	SharedChannel();
+	virtual ~SharedChannel() { }
+
+	void initialize(System& ioSystem);
+	void build();
+	void teardown();
+
+	//! Return true if a process has a slot.
+	bool hasSlot(int inRank) const { return (inRank < (int)mSlots.size()) && (mSlots[inRank] != NULL); }
+	//! Return true if a message of given size fits in a slot.
+	bool fits(unsigned int inSize) const { return inSize <= mCapacity; }
+
+	void        write(int inRank, const char* inMessage, unsigned int inSize, unsigned int inGeneration);
+	const char* read(int inRank, unsigned int& outSize, unsigned int& outGeneration);
+
+protected:
+	UInt::Handle mSlotSize;  //!< Size of a slot in bytes, 0 to disable.
+
+	bool               mBuilt;     //!< True when the window is built.
+	MPI_Win            mWindow;    //!< Shared memory window, MPI_WIN_NULL if none.
+	unsigned int       mCapacity;  //!< Maximum size of a message in a slot.
+	std::vector<char*> mSlots;     //!< Slot of each process, indexed by rank, NULL if none.
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,301 @@
+/*
+ *  MPI_WorkQueue.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/Beagle.hpp"
+#include "MPI_WorkQueue.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Construct a work queue, disabled until initialized.
+ */
+Beagle::MPI::WorkQueue::WorkQueue() :
+mBuilt(false),
+mRank(0),
+mWindow(MPI_WIN_NULL),
+mBase(NULL),
+mHeader(eHeaderSize, 0),
+mNext(0),
+mExited(0)
+{ }
+
+/*!
+ *  \brief Register the parameters of the work queue.
+ *  \param ioSystem System of the evolution.
+ */
+void Beagle::MPI::WorkQueue::initialize(System& ioSystem)
+{
+	if(ioSystem.getRegister().isRegistered("ec.mpi.dispatch")) {
+		mMode = castHandleT<String>(ioSystem.getRegister().getEntry("ec.mpi.dispatch"));
+	} else {
+		mMode = new String("push");
+		std::string lLongDescript = "Distribution of the individuals: \"push\" to have rank 0 send each ";
+		lLongDescript += "individual to an idle evaluator, or \"pull\" to have the evaluators take them from ";
+		lLongDescript += "a one-sided work queue. Pull is not used with sub-masters.";
+		Register::Description lDescription(
+										   "MPI dispatch mode",
+										   "String",
+										   "push",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.dispatch", mMode, lDescription);
+	}
+
+	if(ioSystem.getRegister().isRegistered("ec.mpi.pull.size")) {
+		mWindowSize = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.pull.size"));
+	} else {
+		mWindowSize = new UInt(16777216);
+		std::string lLongDescript = "Size in bytes of the work queue window of rank 0. A deme that does ";
+		lLongDescript += "not fit is distributed by push.";
+		Register::Description lDescription(
+										   "MPI work queue size",
+										   "UInt",
+										   "16777216",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.pull.size", mWindowSize, lDescription);
+	}
+
+	if(ioSystem.getRegister().isRegistered("ec.mpi.pull.fitsize")) {
+		mFitnessSize = castHandleT<UInt>(ioSystem.getRegister().getEntry("ec.mpi.pull.fitsize"));
+	} else {
+		mFitnessSize = new UInt(512);
+		std::string lLongDescript = "Size in bytes of the slot receiving the XML fitness of an individual in ";
+		lLongDescript += "the work queue, at least 128. Longer error replies are truncated, and longer ";
+		lLongDescript += "fitnesses are replaced by an error reply.";
+		Register::Description lDescription(
+										   "MPI work queue fitness size",
+										   "UInt",
+										   "512",
+										   lLongDescript
+										   );
+		ioSystem.getRegister().addEntry("ec.mpi.pull.fitsize", mFitnessSize, lDescription);
+	}
+}
+
+/*!
+ *  \brief Allocate the window of the work queue.
+ *
+ *  Collective over MPI_COMM_WORLD when enabled, it must be called by every
+ *  process. Does nothing once built. The window lives until teardown.
+ */
+void Beagle::MPI::WorkQueue::build()
+{
+	if(mBuilt) return;
+	mBuilt = true;
+	if(!isEnabled()) return;
+	if(mFitnessSize->getWrappedValue() < eMinFitnessSize) {
+		throw Beagle_RunTimeExceptionM(std::string("ec.mpi.pull.fitsize must be at least ")+uint2str(eMinFitnessSize)+" bytes");
+	}
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &mRank);
+	const MPI_Aint lSize = (mRank == 0) ? MPI_Aint(mWindowSize->getWrappedValue()) : 0;
+	MPI_Win_allocate(lSize, 1, MPI_INFO_NULL, MPI_COMM_WORLD, &mBase, &mWindow);
+	if(mRank == 0) std::memset(mBase, 0, eHeaderSize*sizeof(long));
+	MPI_Win_lock_all(0, mWindow);
+}
+
+/*!
+ *  \brief Free the window of the work queue at the end of the evolution.
+ *
+ *  Collective over MPI_COMM_WORLD when a window was allocated, it must be
+ *  called by every process once the queue is no longer used. The queue is
+ *  not built again afterwards.
+ */
+void Beagle::MPI::WorkQueue::teardown()
+{
+	if(mWindow == MPI_WIN_NULL) return;
+	MPI_Win_unlock_all(mWindow);
+	MPI_Win_free(&mWindow);
+	mBase = NULL;
+}
+
+/*!
+ *  \brief Publish the individuals of a deme and reset the counters.
+ *  \param inMessages Encoded individuals.
+ *  \param inGeneration Current generation.
+ *  \return False if the individuals do not fit in the window.
+ *
+ *  The evaluators must be notified after this call, and every evaluator of
+ *  the previous deme must have left the queue.
+ */
+bool Beagle::MPI::WorkQueue::publish(const std::vector<std::string>& inMessages, unsigned int inGeneration)
+{
+	const unsigned int lFitnessSize = mFitnessSize->getWrappedValue();
+	const unsigned long lTableOffset = eHeaderSize*sizeof(long);
+	const unsigned long lFitnessOffset = lTableOffset + inMessages.size()*eEntrySize*sizeof(long);
+	const unsigned long lDataOffset = lFitnessOffset + inMessages.size()*lFitnessSize;
+	unsigned long lEnd = lDataOffset;
+	for(unsigned int i = 0; i < inMessages.size(); ++i) lEnd += inMessages[i].size();
+	if(lEnd > mWindowSize->getWrappedValue()) return false;
+
+	long* lTable = reinterpret_cast<long*>(mBase+lTableOffset);
+	unsigned long lOffset = lDataOffset;
+	for(unsigned int i = 0; i < inMessages.size(); ++i) {
+		lTable[i*eEntrySize+eEntryOffset] = lOffset;
+		lTable[i*eEntrySize+eEntryLength] = inMessages[i].size();
+		lTable[i*eEntrySize+eEntryOwner] = 0;
+		lTable[i*eEntrySize+eEntryDone] = 0;
+		std::memcpy(mBase+lOffset, inMessages[i].data(), inMessages[i].size());
+		lOffset += inMessages[i].size();
+	}
+	MPI_Win_sync(mWindow);
+
+	long lHeader[eHeaderSize];
+	lHeader[eNext] = 0;
+	lHeader[eExited] = 0;
+	lHeader[eCount] = inMessages.size();
+	lHeader[eGeneration] = inGeneration;
+	lHeader[eFitnessOffset] = lFitnessOffset;
+	lHeader[eDataOffset] = lDataOffset;
+	MPI_Accumulate(lHeader, eHeaderSize, MPI_LONG, 0, 0, eHeaderSize, MPI_LONG, MPI_REPLACE, mWindow);
+	MPI_Win_flush(0, mWindow);
+	mTable.assign(inMessages.size()*eEntrySize, 0);
+	mNext = 0;
+	mExited = 0;
+	return true;
+}
+
+/*!
+ *  \brief Read the counters and the entry table, on rank 0.
+ *
+ *  The values are read atomically with respect to the updates of the evaluators.
+ */
+void Beagle::MPI::WorkQueue::refresh()
+{
+	mNext = readCounter(eNext);
+	mExited = readCounter(eExited);
+	if(mTable.empty()) return;
+	MPI_Get_accumulate(NULL, 0, MPI_LONG, &mTable[0], mTable.size(), MPI_LONG, 0, getEntryOffset(0, eEntryOffset),
+					   mTable.size(), MPI_LONG, MPI_NO_OP, mWindow);
+	MPI_Win_flush(0, mWindow);
+}
+
+/*!
+ *  \brief Stop the claims of the individuals left in the queue, on rank 0.
+ *  \return Number of individuals claimed before the queue was closed.
+ *
+ *  The evaluators finish the individuals they claimed, then leave the queue.
+ */
+unsigned int Beagle::MPI::WorkQueue::close()
+{
+	const long lCount = mTable.size()/eEntrySize;
+	long lNext;
+	MPI_Fetch_and_op(&lCount, &lNext, MPI_LONG, 0, eNext*sizeof(long), MPI_REPLACE, mWindow);
+	MPI_Win_flush(0, mWindow);
+	//Claims made after the closing get indices past the end, and are counted out
+	mNext = lNext;
+	return std::min(lNext, lCount);
+}
+
+/*!
+ *  \brief Return the fitness written for an individual, once flagged as done.
+ *  \param inIndex Index of the individual.
+ *  \param outSize Size of the fitness message.
+ */
+const char* Beagle::MPI::WorkQueue::getFitness(unsigned int inIndex, unsigned int& outSize)
+{
+	MPI_Win_sync(mWindow);
+	const char* lSlot = mBase + reinterpret_cast<long*>(mBase)[eFitnessOffset] + inIndex*mFitnessSize->getWrappedValue();
+	long lSize;
+	std::memcpy(&lSize, lSlot, sizeof(long));
+	outSize = lSize;
+	return lSlot+sizeof(long);
+}
+
+/*!
+ *  \brief Claim the next individual of the queue.
+ *  \param outIndex Index of the claimed individual.
+ *  \param outGeneration Generation of the individuals.
+ *  \return False if the queue is empty, the evaluator is then counted out.
+ */
+bool Beagle::MPI::WorkQueue::claim(unsigned int& outIndex, unsigned int& outGeneration)
+{
+	const long lOne = 1;
+	long lIndex;
+	MPI_Fetch_and_op(&lOne, &lIndex, MPI_LONG, 0, eNext*sizeof(long), MPI_SUM, mWindow);
+	MPI_Get(&mHeader[eCount], eHeaderSize-eCount, MPI_LONG, 0, eCount*sizeof(long), eHeaderSize-eCount, MPI_LONG, mWindow);
+	MPI_Win_flush(0, mWindow);
+	if(lIndex >= mHeader[eCount]) {
+		MPI_Accumulate(&lOne, 1, MPI_LONG, 0, eExited*sizeof(long), 1, MPI_LONG, MPI_SUM, mWindow);
+		MPI_Win_flush(0, mWindow);
+		return false;
+	}
+	const long lOwner = mRank;
+	MPI_Accumulate(&lOwner, 1, MPI_LONG, 0, getEntryOffset(lIndex, eEntryOwner), 1, MPI_LONG, MPI_REPLACE, mWindow);
+	MPI_Win_flush(0, mWindow);
+	outIndex = lIndex;
+	outGeneration = mHeader[eGeneration];
+	return true;
+}
+
+/*!
+ *  \brief Read a claimed individual.
+ *  \param inIndex Index of the individual.
+ *  \param outMessage Encoded individual.
+ */
+void Beagle::MPI::WorkQueue::fetch(unsigned int inIndex, std::vector<char>& outMessage)
+{
+	long lEntry[2];
+	MPI_Get(lEntry, 2, MPI_LONG, 0, getEntryOffset(inIndex, eEntryOffset), 2, MPI_LONG, mWindow);
+	MPI_Win_flush(0, mWindow);
+	outMessage.resize(lEntry[1]+1);
+	MPI_Get(&outMessage[0], lEntry[1], MPI_CHAR, 0, lEntry[0], lEntry[1], MPI_CHAR, mWindow);
+	MPI_Win_flush(0, mWindow);
+	outMessage.resize(lEntry[1]);
+}
+
+/*!
+ *  \brief Write the fitness of a claimed individual and flag it as done.
+ *  \param inIndex Index of the individual.
+ *  \param inFitness Fitness message.
+ *  \param inSize Size of the fitness message, at most getFitnessCapacity.
+ *
+ *  A larger message is cut to the size of the slot, the caller being expected
+ *  to fit it beforehand.
+ */
+void Beagle::MPI::WorkQueue::putFitness(unsigned int inIndex, const char* inFitness, unsigned int inSize)
+{
+	const unsigned int lFitnessSize = mFitnessSize->getWrappedValue();
+	const long lSize = std::min(inSize, getFitnessCapacity());
+	mSlot.assign(reinterpret_cast<const char*>(&lSize), sizeof(long));
+	mSlot.append(inFitness, lSize);
+	const MPI_Aint lSlotOffset = mHeader[eFitnessOffset] + MPI_Aint(inIndex)*lFitnessSize;
+	MPI_Put(const_cast<char*>(mSlot.data()), mSlot.size(), MPI_CHAR, 0, lSlotOffset, mSlot.size(), MPI_CHAR, mWindow);
+	MPI_Win_flush(0, mWindow);
+	const long lOne = 1;
+	MPI_Accumulate(&lOne, 1, MPI_LONG, 0, getEntryOffset(inIndex, eEntryDone), 1, MPI_LONG, MPI_REPLACE, mWindow);
+	MPI_Win_flush(0, mWindow);
+}
+
+/*!
+ *  \brief Read a counter of the header atomically.
+ */
+long Beagle::MPI::WorkQueue::readCounter(HeaderField inField)
+{
+	long lValue;
+	MPI_Fetch_and_op(NULL, &lValue, MPI_LONG, 0, inField*sizeof(long), MPI_NO_OP, mWindow);
+	MPI_Win_flush(0, mWindow);
+	return lValue;
+}
@@ -0,0 +1,126 @@
+/*
+ *  MPI_WorkQueue.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_WorkQueue_H
+#define MPI_WorkQueue_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+#include "beagle/config.hpp"
+#include "beagle/macros.hpp"
+#include "beagle/Object.hpp"
+#include "beagle/PointerT.hpp"
+#include "beagle/System.hpp"
+#include "beagle/UInt.hpp"
+#include "beagle/String.hpp"
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class WorkQueue MPI_WorkQueue.hpp "MPI_WorkQueue.hpp"
+ *  \brief One-sided work queue the evaluators pull individuals from.
+ *
+ *  Rank 0 publishes the encoded individuals of a deme in an RMA window, with a
+ *  table of their offsets and one fitness slot per individual. Each evaluator
+ *  then claims indices with MPI_Fetch_and_op on a shared counter, records its
+ *  rank as owner of the entry, reads the individuals with MPI_Get and writes
+ *  the fitnesses with MPI_Put, flagging the entry as done with MPI_Accumulate.
+ *  Rank 0 polls the table to collect the fitnesses as they come and to find
+ *  the claims left unanswered, and may close the queue early. An evaluator
+ *  that finds the queue empty counts itself out, so that the counters can be
+ *  reset for the next deme.
+ *
+ *  Window layout: header of counters, entry table, fitness slots, individuals.
+ */
+class WorkQueue : public Object {
+public:
+	//! WorkQueue handle type.
+	typedef PointerT<WorkQueue,Object::Handle>
+	Handle;
+
+	WorkQueue();
+	virtual ~WorkQueue() { }
+
+	void initialize(System& ioSystem);
+	void build();
+	void teardown();
+
+	//! Return true if the evaluators pull their work.
+	bool isEnabled() const { return (mMode != NULL) && (mMode->getWrappedValue() == "pull"); }
+
+	//! Return the largest fitness message fitting in a slot, in bytes.
+	unsigned int getFitnessCapacity() const { return mFitnessSize->getWrappedValue()-sizeof(long); }
+
+	bool         publish(const std::vector<std::string>& inMessages, unsigned int inGeneration);
+	void         refresh();
+	unsigned int close();
+	const char*  getFitness(unsigned int inIndex, unsigned int& outSize);
+
+	//! Return the number of individuals claimed, as of the last refresh.
+	unsigned int getNbClaimed() const { return std::min(mNext, long(mTable.size()/eEntrySize)); }
+	//! Return the number of evaluators that left the queue, as of the last refresh.
+	unsigned int getNbExited() const { return mExited; }
+	//! Return the rank of the evaluator of an individual, 0 if not known, as of the last refresh.
+	int getOwner(unsigned int inIndex) const { return mTable[inIndex*eEntrySize+eEntryOwner]; }
+	//! Return true if the fitness of an individual is written, as of the last refresh.
+	bool isDone(unsigned int inIndex) const { return mTable[inIndex*eEntrySize+eEntryDone] != 0; }
+
+	bool claim(unsigned int& outIndex, unsigned int& outGeneration);
+	void fetch(unsigned int inIndex, std::vector<char>& outMessage);
+	void putFitness(unsigned int inIndex, const char* inFitness, unsigned int inSize);
+
+protected:
+	//! Position of the values in the header.
+	enum HeaderField { eNext=0, eExited, eCount, eGeneration, eFitnessOffset, eDataOffset, eHeaderSize };
+	//! Position of the values in an entry of the table.
+	enum EntryField { eEntryOffset=0, eEntryLength, eEntryOwner, eEntryDone, eEntrySize };
+	//! Smallest fitness slot, holding at least an error reply.
+	enum { eMinFitnessSize = 128 };
+
+	long readCounter(HeaderField inField);
+	//! Return the offset of a value of an entry in the window.
+	MPI_Aint getEntryOffset(unsigned int inIndex, EntryField inField) const
+	{
+		return (eHeaderSize + MPI_Aint(inIndex)*eEntrySize + inField)*sizeof(long);
+	}
+
+	String::Handle mMode;         //!< Dispatch mode, "push" or "pull".
+	UInt::Handle   mWindowSize;   //!< Size of the window of rank 0 in bytes.
+	UInt::Handle   mFitnessSize;  //!< Size of a fitness slot in bytes.
+
+	bool              mBuilt;     //!< True when the window is built.
+	int               mRank;      //!< Rank of this process.
+	MPI_Win           mWindow;    //!< Window of rank 0, MPI_WIN_NULL if none.
+	char*             mBase;      //!< Base of the window, on rank 0.
+	std::vector<long> mHeader;    //!< Header read by the last claim.
+	std::string       mSlot;      //!< Fitness slot being written.
+	std::vector<long> mTable;     //!< Entry table read by the last refresh, on rank 0.
+	long              mNext;      //!< Claim counter read by the last refresh, on rank 0.
+	long              mExited;    //!< Exit counter read by the last refresh, on rank 0.
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ *  MPI_XMLCodec.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/Beagle.hpp"
+#include "MPI_XMLCodec.hpp"
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Append the XML representation of an individual, null terminated, to a message.
+ *  \param inIndividual Individual to encode.
+ *  \param inPeer Rank of the receiving process.
+ *  \param ioContext Evolutionary context.
+ *  \param ioMessage Message to append to.
+ *  \return Always true.
+ */
+bool Beagle::MPI::XMLCodec::encodeIndividual(const Individual& inIndividual, int inPeer, Context& ioContext, std::string& ioMessage)
+{
+	mStreamOut.str("");
+	inIndividual.write(mXMLStream);
+	ioMessage.append(mStreamOut.str());
+	ioMessage.append(1, '\0');
+	return true;
+}
+
+/*!
+ *  \brief Decode an individual from its XML representation.
+ *  \param inBuffer Encoded individual.
+ *  \param inSize Size of the encoded individual.
+ *  \param inPeer Rank of the sending process.
+ *  \param ioIndividual Individual to fill.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::XMLCodec::decodeIndividual(const char* inBuffer, unsigned int inSize, int inPeer, Individual& ioIndividual, Context& ioContext)
+{
+	mDecoder.readIndividual(inBuffer, inSize, ioIndividual, ioContext);
+}
+
+/*!
+ *  \brief Append the XML markup common to the individuals and fitnesses to the dictionary.
+ *  \param ioContext Evolutionary context.
+ *  \param ioDictionary Dictionary to append to.
+ */
+void Beagle::MPI::XMLCodec::appendDictionary(Context& ioContext, std::string& ioDictionary)
+{
+	ioDictionary += "<Individual size=\"\"></Individual>";
+	ioDictionary += "<Genotype type=\"\" size=\"\"></Genotype>";
+	ioDictionary += "<Fitness type=\"simple\"><Obj></Obj></Fitness>";
+}
@@ -0,0 +1,62 @@
+/*
+ *  MPI_XMLCodec.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_XMLCodec_H
+#define MPI_XMLCodec_H
+
+#include <sstream>
+#include <XML.hpp>
+
+#include "MPI_Codec.hpp"
+#include "MPI_XMLStreamDecoder.hpp"
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class XMLCodec MPI_XMLCodec.hpp "MPI_XMLCodec.hpp"
+ *  \brief Generic codec sending the individuals in their XML representation.
+ *
+ *  Any individual can be encoded this way, so this codec is always the first
+ *  of the bag and is used when no specialized codec applies.
+ */
+class XMLCodec : public Codec {
+public:
+	//! XMLCodec handle type.
+	typedef PointerT<XMLCodec,Codec::Handle>
+	Handle;
+
+	XMLCodec() : Codec("xml"), mXMLStream(mStreamOut) { }
+	virtual ~XMLCodec() { }
+
+	virtual bool encodeIndividual(const Individual& inIndividual, int inPeer, Context& ioContext, std::string& ioMessage);
+	virtual void decodeIndividual(const char* inBuffer, unsigned int inSize, int inPeer, Individual& ioIndividual, Context& ioContext);
+	virtual void appendDictionary(Context& ioContext, std::string& ioDictionary);
+
+protected:
+	std::ostringstream   mStreamOut;  //!< Output stream of the XML streamer.
+	PACC::XML::Streamer  mXMLStream;  //!< XML streamer used to write the individuals.
+	XMLStreamDecoder     mDecoder;    //!< Streaming decoder of received individuals.
+};
+
+}
+}
+
+#endif
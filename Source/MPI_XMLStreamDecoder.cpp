@@ -0,0 +1,293 @@
+/*
+ *  MPI_XMLStreamDecoder.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/Beagle.hpp"
+#include "beagle/GA.hpp"
+#include "beagle/GP.hpp"
+#include "MPI_XMLStreamDecoder.hpp"
+
+#include <string>
+#include <sstream>
+#include <XML.hpp>
+
+using namespace Beagle;
+
+
+/*!
+ *  \brief Decode an individual from a message buffer.
+ *  \param inBuffer Buffer holding the XML individual.
+ *  \param inSize Size of the buffer.
+ *  \param ioIndividual Individual to fill.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::XMLStreamDecoder::readIndividual(const char* inBuffer,
+												   unsigned int inSize,
+												   Individual& ioIndividual,
+												   Context& ioContext)
+{
+	XMLStreamReader lReader(inBuffer, inSize);
+	if(lReader.next() != XMLStreamReader::eStartTag) {
+		throw Beagle_IOExceptionMessageM("tag <Individual> expected!");
+	}
+	readIndividual(lReader, ioIndividual, ioContext);
+}
+
+/*!
+ *  \brief Decode a fitness from a message buffer.
+ *  \param inBuffer Buffer holding the XML fitness.
+ *  \param inSize Size of the buffer.
+ *  \param ioFitness Fitness to fill.
+ */
+void Beagle::MPI::XMLStreamDecoder::readFitness(const char* inBuffer,
+												unsigned int inSize,
+												Fitness& ioFitness)
+{
+	XMLStreamReader lReader(inBuffer, inSize);
+	if(lReader.next() != XMLStreamReader::eStartTag) {
+		throw Beagle_IOExceptionMessageM("tag <Fitness> expected!");
+	}
+	readFitness(lReader, ioFitness);
+}
+
+/*!
+ *  \brief Decode an individual, the reader being on its start tag.
+ *  \param ioReader Reader positioned on the <Individual> tag. On return, it is on the matching end tag.
+ *  \param ioIndividual Individual to fill.
+ *  \param ioContext Evolutionary context.
+ */
+void Beagle::MPI::XMLStreamDecoder::readIndividual(XMLStreamReader& ioReader,
+												   Individual& ioIndividual,
+												   Context& ioContext)
+{
+	if(ioReader.getName() != "Individual") {
+		throw Beagle_IOExceptionMessageM(std::string("tag <Individual> expected, got <")+ioReader.getName()+">!");
+	}
+	const std::string& lSize = ioReader.getAttribute("size");
+	if(lSize.empty() == false) ioIndividual.resize(str2uint(lSize));
+
+	unsigned int lGenotypeIndex = 0;
+	while(ioReader.next() != XMLStreamReader::eEndTag) {
+		if(ioReader.getEvent() == XMLStreamReader::eEnd) {
+			throw Beagle_IOExceptionMessageM("unexpected end of message while reading an individual");
+		}
+		if(ioReader.getEvent() != XMLStreamReader::eStartTag) continue;
+
+		if(ioReader.getName() == "Fitness") {
+			if(ioReader.getAttribute("valid") == "no") {
+				if(ioIndividual.getFitness() != NULL) ioIndividual.getFitness()->setInvalid();
+				ioReader.skipElement();
+			} else {
+				if(ioIndividual.getFitness() == NULL) {
+					ioIndividual.setFitness(castHandleT<Fitness>(ioIndividual.getFitnessAlloc()->allocate()));
+				}
+				readFitness(ioReader, *ioIndividual.getFitness());
+			}
+		} else if(ioReader.getName() == "Genotype") {
+			if(lGenotypeIndex >= ioIndividual.size()) {
+				throw Beagle_IOExceptionMessageM("number of genotypes is bigger than the individual size attribute");
+			}
+			readGenotype(ioReader, *ioIndividual[lGenotypeIndex++], ioContext);
+		} else {
+			ioReader.skipElement();
+		}
+	}
+}
+
+/*!
+ *  \brief Decode a fitness, the reader being on its start tag.
+ *  \param ioReader Reader positioned on the <Fitness> tag. On return, it is on the matching end tag.
+ *  \param ioFitness Fitness to fill.
+ */
+void Beagle::MPI::XMLStreamDecoder::readFitness(XMLStreamReader& ioReader, Fitness& ioFitness)
+{
+	const unsigned int lBegin = ioReader.getStartOffset();
+	FitnessSimple* lSimple = dynamic_cast<FitnessSimple*>(&ioFitness);
+	if((lSimple != NULL) && (ioReader.getAttribute("type") == "simple") && (ioReader.getAttribute("valid") != "no")) {
+		if(ioReader.next() == XMLStreamReader::eText) {
+			const double lValue = str2dbl(ioReader.getText());
+			if(ioReader.next() == XMLStreamReader::eEndTag) {
+				lSimple->setValue(lValue);
+				lSimple->setValid();
+				return;
+			}
+		}
+		//Unexpected content, finish the element and let the DOM path read it
+		if(ioReader.getEvent() == XMLStreamReader::eStartTag) {
+			ioReader.skipElement();
+			ioReader.skipElement();
+		} else if(ioReader.getEvent() != XMLStreamReader::eEndTag) {
+			ioReader.skipElement();
+		}
+	} else {
+		ioReader.skipElement();
+	}
+	PACC::XML::Document lDocument;
+	parseElement(ioReader, lBegin, lDocument);
+	ioFitness.read(lDocument.getFirstRoot());
+}
+
+/*!
+ *  \brief Decode a genotype, the reader being on its start tag.
+ */
+void Beagle::MPI::XMLStreamDecoder::readGenotype(XMLStreamReader& ioReader,
+												 Genotype& ioGenotype,
+												 Context& ioContext)
+{
+	const unsigned int lBegin = ioReader.getStartOffset();
+	const std::string& lType = ioReader.getAttribute("type");
+	if(lType == "gptree") {
+		Beagle::GP::Tree* lTree = dynamic_cast<Beagle::GP::Tree*>(&ioGenotype);
+		Beagle::GP::Context* lGPContext = dynamic_cast<Beagle::GP::Context*>(&ioContext);
+		if((lTree != NULL) && (lGPContext != NULL)) {
+			readTree(ioReader, *lTree, *lGPContext);
+			return;
+		}
+	} else if(lType == "bitstring") {
+		Beagle::GA::BitString* lBitString = dynamic_cast<Beagle::GA::BitString*>(&ioGenotype);
+		if((lBitString != NULL) && readBitString(ioReader, *lBitString)) return;
+	}
+	if(ioReader.getStartOffset() == lBegin) ioReader.skipElement();
+	PACC::XML::Document lDocument;
+	parseElement(ioReader, lBegin, lDocument);
+	ioGenotype.readWithContext(lDocument.getFirstRoot(), ioContext);
+}
+
+/*!
+ *  \brief Decode the 0/1 characters of a bit string genotype.
+ *  \return False if the content is not a plain bit string. The reader is then
+ *    left on the genotype end tag for the DOM path to take over.
+ */
+bool Beagle::MPI::XMLStreamDecoder::readBitString(XMLStreamReader& ioReader, Beagle::GA::BitString& ioBitString)
+{
+	if(ioReader.next() == XMLStreamReader::eEndTag) {
+		ioBitString.resize(0);
+		return true;
+	}
+	bool lPlain = (ioReader.getEvent() == XMLStreamReader::eText);
+	if(lPlain) {
+		const std::string& lText = ioReader.getText();
+		unsigned int lNbBits = 0;
+		for(unsigned int i = 0; i < lText.size(); ++i) {
+			if((lText[i] == '0') || (lText[i] == '1')) ++lNbBits;
+			else if((lText[i] != ' ') && (lText[i] != '\n') && (lText[i] != '\r') && (lText[i] != '\t')) lPlain = false;
+		}
+		if(lPlain) {
+			ioBitString.resize(lNbBits);
+			unsigned int j = 0;
+			for(unsigned int i = 0; i < lText.size(); ++i) {
+				if(lText[i] == '0') ioBitString[j++] = false;
+				else if(lText[i] == '1') ioBitString[j++] = true;
+			}
+		}
+		ioReader.next();
+	}
+	if(ioReader.getEvent() == XMLStreamReader::eStartTag) {
+		ioReader.skipElement();
+		ioReader.skipElement();
+		return false;
+	}
+	if(ioReader.getEvent() != XMLStreamReader::eEndTag) {
+		ioReader.skipElement();
+		return false;
+	}
+	return lPlain;
+}
+
+/*!
+ *  \brief Decode a GP tree, the reader being on its genotype start tag.
+ *
+ *  Nodes are appended in prefix order as the primitive tags are met. As in
+ *  Beagle::GP::Tree::readSubTree, each node is then given by the primitive of
+ *  the set for its number of child elements and read by readWithContext, both
+ *  being done when the matching end tag is read, with the sub-tree size. The
+ *  element given to readWithContext only holds the attributes of the tag.
+ */
+void Beagle::MPI::XMLStreamDecoder::readTree(XMLStreamReader& ioReader,
+											 Beagle::GP::Tree& ioTree,
+											 Beagle::GP::Context& ioContext)
+{
+	const std::string& lPrimitSetId = ioReader.getAttribute("primitSetId");
+	ioTree.setPrimitiveSetIndex(lPrimitSetId.empty() ? 0 : str2uint(lPrimitSetId));
+	const std::string& lNbArgs = ioReader.getAttribute("nbArgs");
+	ioTree.setNumberArguments(lNbArgs.empty() ? 0 : str2uint(lNbArgs));
+
+	Beagle::GP::PrimitiveSuperSet& lSuperSet = ioContext.getSystem().getPrimitiveSuperSet();
+	if(ioTree.getPrimitiveSetIndex() >= lSuperSet.size()) {
+		throw Beagle_IOExceptionMessageM(std::string("primitive set index ")+lPrimitSetId+" is out of range");
+	}
+	Beagle::GP::PrimitiveSet& lPrimitSet = *lSuperSet[ioTree.getPrimitiveSetIndex()];
+
+	ioTree.clear();
+	mNodeStack.clear();
+	mChildCounts.clear();
+	for(;;) {
+		switch(ioReader.next()) {
+			case XMLStreamReader::eStartTag: {
+				Beagle::GP::Primitive::Handle lPrimitive = lPrimitSet.getPrimitiveByName(ioReader.getName());
+				if(lPrimitive == NULL) {
+					throw Beagle_IOExceptionMessageM(std::string("no primitive named \"")+ioReader.getName()+
+													 "\" found in the primitive set");
+				}
+				if(!mChildCounts.empty()) ++mChildCounts.back();
+				const unsigned int lDepth = mNodeStack.size();
+				if(mAttributes.size() <= lDepth) mAttributes.resize(lDepth+1);
+				mAttributes[lDepth].clear();
+				for(unsigned int i = 0; i < ioReader.getAttributeCount(); ++i) {
+					mAttributes[lDepth].push_back(std::make_pair(ioReader.getAttributeName(i), ioReader.getAttributeValue(i)));
+				}
+				mNodeStack.push_back(ioTree.size());
+				mChildCounts.push_back(0);
+				ioTree.push_back(Beagle::GP::Node(lPrimitive, 0));
+				break;
+			}
+			case XMLStreamReader::eEndTag: {
+				if(mNodeStack.empty()) return;
+				const unsigned int lIndex = mNodeStack.back();
+				const Attributes& lAttributes = mAttributes[mNodeStack.size()-1];
+				Beagle::GP::Node& lNode = ioTree[lIndex];
+				PACC::XML::Node lElement(lNode.mPrimitive->getName(), PACC::XML::eData);
+				for(unsigned int i = 0; i < lAttributes.size(); ++i) {
+					lElement.setAttribute(lAttributes[i].first, lAttributes[i].second);
+				}
+				lNode.mPrimitive = lNode.mPrimitive->giveReference(mChildCounts.back(), ioContext);
+				lNode.mPrimitive->readWithContext(PACC::XML::ConstIterator(&lElement), ioContext);
+				lNode.mSubTreeSize = ioTree.size() - lIndex;
+				mNodeStack.pop_back();
+				mChildCounts.pop_back();
+				break;
+			}
+			case XMLStreamReader::eEnd:
+				throw Beagle_IOExceptionMessageM("unexpected end of message while reading a GP tree");
+			default:
+				break;
+		}
+	}
+}
+
+/*!
+ *  \brief Parse with PACC the element that starts at given offset and ends at the reader position.
+ */
+void Beagle::MPI::XMLStreamDecoder::parseElement(XMLStreamReader& ioReader,
+												 unsigned int inBegin,
+												 PACC::XML::Document& outDocument)
+{
+	std::istringstream lStreamIn(std::string(ioReader.getBuffer()+inBegin, ioReader.getBuffer()+ioReader.getEndOffset()));
+	outDocument.parse(lStreamIn);
+}
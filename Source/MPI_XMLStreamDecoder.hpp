@@ -0,0 +1,77 @@
+/*
+ *  MPI_XMLStreamDecoder.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_XMLStreamDecoder_H
+#define MPI_XMLStreamDecoder_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "beagle/Individual.hpp"
+#include "beagle/Fitness.hpp"
+#include "beagle/Context.hpp"
+#include "beagle/GA.hpp"
+#include "beagle/GP.hpp"
+
+#include "MPI_XMLStreamReader.hpp"
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class XMLStreamDecoder MPI_XMLStreamDecoder.hpp "MPI_XMLStreamDecoder.hpp"
+ *  \brief Decode individuals and fitness sent as XML without building a DOM.
+ *
+ *  The decoder drives a XMLStreamReader over the received buffer and fills the
+ *  Beagle objects directly. Fitness of type "simple", bit string genotypes and GP
+ *  trees are decoded natively. Any other element is parsed on its own with
+ *  PACC::XML::Document and handed to the usual read method, so the result is
+ *  always the same as the one of the DOM path.
+ */
+class XMLStreamDecoder {
+public:
+	XMLStreamDecoder() { }
+	~XMLStreamDecoder() { }
+
+	void readIndividual(const char* inBuffer, unsigned int inSize, Individual& ioIndividual, Context& ioContext);
+	void readFitness(const char* inBuffer, unsigned int inSize, Fitness& ioFitness);
+
+	void readIndividual(XMLStreamReader& ioReader, Individual& ioIndividual, Context& ioContext);
+	void readFitness(XMLStreamReader& ioReader, Fitness& ioFitness);
+
+protected:
+	void readGenotype(XMLStreamReader& ioReader, Genotype& ioGenotype, Context& ioContext);
+	bool readBitString(XMLStreamReader& ioReader, Beagle::GA::BitString& ioBitString);
+	void readTree(XMLStreamReader& ioReader, Beagle::GP::Tree& ioTree, Beagle::GP::Context& ioContext);
+	void parseElement(XMLStreamReader& ioReader, unsigned int inBegin, PACC::XML::Document& outDocument);
+
+	//! Attributes of an XML element, as name and value pairs.
+	typedef std::vector< std::pair<std::string,std::string> > Attributes;
+
+	std::vector<unsigned int> mNodeStack;   //!< Index of the open GP nodes while reading a tree.
+	std::vector<unsigned int> mChildCounts; //!< Number of children of the open GP nodes.
+	std::vector<Attributes>   mAttributes;  //!< Attributes of the open GP nodes, by depth.
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,274 @@
+/*
+ *  MPI_XMLStreamReader.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "beagle/Beagle.hpp"
+#include "MPI_XMLStreamReader.hpp"
+
+#include <cstring>
+#include <cstdlib>
+
+using namespace Beagle;
+
+namespace {
+	inline bool isSpace(char inChar) {
+		return (inChar == ' ') || (inChar == '\n') || (inChar == '\r') || (inChar == '\t');
+	}
+	inline bool isNameDelimiter(char inChar) {
+		return isSpace(inChar) || (inChar == '>') || (inChar == '/') || (inChar == '=');
+	}
+}
+
+/*!
+ *  \brief Construct a reader on a message buffer.
+ *  \param inBuffer Buffer to read. It is not copied and must outlive the reader.
+ *  \param inSize Size of the buffer. Reading also stops at the first null character.
+ */
+Beagle::MPI::XMLStreamReader::XMLStreamReader(const char* inBuffer, unsigned int inSize) :
+mBuffer(inBuffer),
+mSize(inSize),
+mPosition(0),
+mStartOffset(0),
+mEvent(eEnd),
+mPendingEnd(false),
+mNbAttributes(0)
+{
+	const void* lNull = std::memchr(inBuffer, '\0', inSize);
+	if(lNull != NULL) mSize = static_cast<const char*>(lNull) - inBuffer;
+}
+
+/*!
+ *  \brief Return the value of the named attribute of the current start tag.
+ *  \param inName Attribute name.
+ *  \return Attribute value, or an empty string if the attribute is absent.
+ */
+const std::string& Beagle::MPI::XMLStreamReader::getAttribute(const std::string& inName) const
+{
+	static const std::string lEmpty;
+	for(unsigned int i = 0; i < mNbAttributes; ++i) {
+		if(mAttributes[i].first == inName) return mAttributes[i].second;
+	}
+	return lEmpty;
+}
+
+/*!
+ *  \brief Read the next event of the buffer.
+ *  \return Event read, eEnd when the buffer is exhausted.
+ */
+Beagle::MPI::XMLStreamReader::Event Beagle::MPI::XMLStreamReader::next()
+{
+	if(mPendingEnd) {
+		mPendingEnd = false;
+		mNbAttributes = 0;
+		mEvent = eEndTag;
+		return mEvent;
+	}
+	while(mPosition < mSize) {
+		mStartOffset = mPosition;
+		if(mBuffer[mPosition] != '<') {
+			if(readText()) return mEvent;
+			continue;
+		}
+		if(mPosition+1 >= mSize) break;
+		const char lNext = mBuffer[mPosition+1];
+		if(lNext == '?') {
+			skipPast("?>");
+		} else if(lNext == '!') {
+			if((mSize-mPosition >= 4) && (std::strncmp(mBuffer+mPosition, "<!--", 4) == 0)) {
+				skipPast("-->");
+			} else if((mSize-mPosition >= 9) && (std::strncmp(mBuffer+mPosition, "<![CDATA[", 9) == 0)) {
+				const unsigned int lBegin = mPosition+9;
+				if(!skipPast("]]>")) throw Beagle_IOExceptionMessageM("unexpected end of XML message in CDATA section");
+				mText.assign(mBuffer+lBegin, mBuffer+mPosition-3);
+				mEvent = eText;
+				return mEvent;
+			} else {
+				skipPast(">");
+			}
+		} else {
+			readTag();
+			return mEvent;
+		}
+	}
+	mStartOffset = mSize;
+	mEvent = eEnd;
+	return mEvent;
+}
+
+/*!
+ *  \brief Skip the content of the current element.
+ *
+ *  Must be called right after a start tag event. On return, the current event
+ *  is the matching end tag.
+ */
+void Beagle::MPI::XMLStreamReader::skipElement()
+{
+	unsigned int lDepth = 1;
+	while(lDepth > 0) {
+		switch(next()) {
+			case eStartTag: ++lDepth; break;
+			case eEndTag: --lDepth; break;
+			case eEnd: throw Beagle_IOExceptionMessageM("unexpected end of XML message while skipping an element");
+			default: break;
+		}
+	}
+}
+
+/*!
+ *  \brief Read a start or end tag at current position.
+ */
+void Beagle::MPI::XMLStreamReader::readTag()
+{
+	++mPosition;
+	mNbAttributes = 0;
+	if(mBuffer[mPosition] == '/') {
+		++mPosition;
+		readName(mName);
+		skipPast(">");
+		mEvent = eEndTag;
+		return;
+	}
+	readName(mName);
+	mEvent = eStartTag;
+	for(;;) {
+		skipSpaces();
+		if(mPosition >= mSize) {
+			throw Beagle_IOExceptionMessageM(std::string("unexpected end of XML message in tag <")+mName+">");
+		}
+		if(mBuffer[mPosition] == '>') {
+			++mPosition;
+			return;
+		}
+		if(mBuffer[mPosition] == '/') {
+			skipPast(">");
+			mPendingEnd = true;
+			return;
+		}
+		//Read an attribute
+		if(mNbAttributes == mAttributes.size()) mAttributes.resize(mNbAttributes+1);
+		std::pair<std::string,std::string>& lAttribute = mAttributes[mNbAttributes++];
+		readName(lAttribute.first);
+		skipSpaces();
+		if((mPosition >= mSize) || (mBuffer[mPosition] != '=')) {
+			throw Beagle_IOExceptionMessageM(std::string("malformed attribute \"")+lAttribute.first+"\" in tag <"+mName+">");
+		}
+		++mPosition;
+		skipSpaces();
+		if(mPosition >= mSize) break;
+		const char lQuote = mBuffer[mPosition];
+		if((lQuote != '"') && (lQuote != '\'')) {
+			throw Beagle_IOExceptionMessageM(std::string("unquoted attribute \"")+lAttribute.first+"\" in tag <"+mName+">");
+		}
+		const unsigned int lBegin = ++mPosition;
+		while((mPosition < mSize) && (mBuffer[mPosition] != lQuote)) ++mPosition;
+		unescape(lBegin, mPosition, lAttribute.second);
+		++mPosition;
+	}
+	throw Beagle_IOExceptionMessageM(std::string("unexpected end of XML message in tag <")+mName+">");
+}
+
+/*!
+ *  \brief Read character data up to the next markup.
+ *  \return False if the data read was only made of white spaces.
+ */
+bool Beagle::MPI::XMLStreamReader::readText()
+{
+	const unsigned int lBegin = mPosition;
+	bool lOnlySpaces = true;
+	while((mPosition < mSize) && (mBuffer[mPosition] != '<')) {
+		if(lOnlySpaces && !isSpace(mBuffer[mPosition])) lOnlySpaces = false;
+		++mPosition;
+	}
+	if(lOnlySpaces) return false;
+	unescape(lBegin, mPosition, mText);
+	mEvent = eText;
+	return true;
+}
+
+/*!
+ *  \brief Read a tag or attribute name at current position.
+ */
+void Beagle::MPI::XMLStreamReader::readName(std::string& outName)
+{
+	const unsigned int lBegin = mPosition;
+	while((mPosition < mSize) && !isNameDelimiter(mBuffer[mPosition])) ++mPosition;
+	outName.assign(mBuffer+lBegin, mBuffer+mPosition);
+}
+
+/*!
+ *  \brief Skip white spaces at current position.
+ */
+void Beagle::MPI::XMLStreamReader::skipSpaces()
+{
+	while((mPosition < mSize) && isSpace(mBuffer[mPosition])) ++mPosition;
+}
+
+/*!
+ *  \brief Move the current position just past the given delimiter.
+ *  \return False if the delimiter is not found, the position is then the end of the buffer.
+ */
+bool Beagle::MPI::XMLStreamReader::skipPast(const char* inDelimiter)
+{
+	const unsigned int lLength = std::strlen(inDelimiter);
+	while(mPosition+lLength <= mSize) {
+		if(std::strncmp(mBuffer+mPosition, inDelimiter, lLength) == 0) {
+			mPosition += lLength;
+			return true;
+		}
+		++mPosition;
+	}
+	mPosition = mSize;
+	return false;
+}
+
+/*!
+ *  \brief Copy a buffer range, replacing the XML entities by their character.
+ */
+void Beagle::MPI::XMLStreamReader::unescape(unsigned int inBegin, unsigned int inEnd, std::string& outValue) const
+{
+	const char* lAmpersand = static_cast<const char*>(std::memchr(mBuffer+inBegin, '&', inEnd-inBegin));
+	if(lAmpersand == NULL) {
+		outValue.assign(mBuffer+inBegin, mBuffer+inEnd);
+		return;
+	}
+	outValue.assign(mBuffer+inBegin, lAmpersand);
+	for(unsigned int i = lAmpersand-mBuffer; i < inEnd; ++i) {
+		if(mBuffer[i] != '&') {
+			outValue += mBuffer[i];
+			continue;
+		}
+		unsigned int lSemicolon = i+1;
+		while((lSemicolon < inEnd) && (mBuffer[lSemicolon] != ';')) ++lSemicolon;
+		const std::string lEntity(mBuffer+i+1, mBuffer+lSemicolon);
+		if(lEntity == "lt") outValue += '<';
+		else if(lEntity == "gt") outValue += '>';
+		else if(lEntity == "amp") outValue += '&';
+		else if(lEntity == "quot") outValue += '"';
+		else if(lEntity == "apos") outValue += '\'';
+		else if(!lEntity.empty() && (lEntity[0] == '#')) {
+			if((lEntity.size() > 1) && ((lEntity[1] == 'x') || (lEntity[1] == 'X'))) {
+				outValue += static_cast<char>(std::strtol(lEntity.c_str()+2, NULL, 16));
+			} else {
+				outValue += static_cast<char>(std::strtol(lEntity.c_str()+1, NULL, 10));
+			}
+		}
+		else outValue.append(mBuffer+i, mBuffer+((lSemicolon < inEnd) ? lSemicolon+1 : inEnd));
+		i = lSemicolon;
+	}
+}
@@ -0,0 +1,93 @@
+/*
+ *  MPI_XMLStreamReader.hpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MPI_XMLStreamReader_H
+#define MPI_XMLStreamReader_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace Beagle {
+namespace MPI {
+
+/*!
+ *  \class XMLStreamReader MPI_XMLStreamReader.hpp "MPI_XMLStreamReader.hpp"
+ *  \brief Pull (SAX-style) XML tokenizer working in place on a message buffer.
+ *
+ *  The reader walks the buffer once and reports start tags, end tags and text
+ *  without building any tree. Empty elements (<tag/>) are reported as a start
+ *  tag immediately followed by an end tag. Whitespace-only text, comments,
+ *  processing instructions and DOCTYPE declarations are skipped.
+ */
+class XMLStreamReader {
+public:
+	enum Event { eStartTag, eEndTag, eText, eEnd };
+
+	XMLStreamReader(const char* inBuffer, unsigned int inSize);
+	~XMLStreamReader() { }
+
+	Event next();
+	void  skipElement();
+
+	//! Return the last event read.
+	Event getEvent() const { return mEvent; }
+	//! Return the tag name of the current start or end tag.
+	const std::string& getName() const { return mName; }
+	//! Return the unescaped content of the current text event.
+	const std::string& getText() const { return mText; }
+	//! Return the number of attributes of the current start tag.
+	unsigned int getAttributeCount() const { return mNbAttributes; }
+	//! Return the name of the ith attribute of the current start tag.
+	const std::string& getAttributeName(unsigned int inIndex) const { return mAttributes[inIndex].first; }
+	//! Return the value of the ith attribute of the current start tag.
+	const std::string& getAttributeValue(unsigned int inIndex) const { return mAttributes[inIndex].second; }
+	const std::string& getAttribute(const std::string& inName) const;
+	//! Return the buffer offset of the markup that produced the current event.
+	unsigned int getStartOffset() const { return mStartOffset; }
+	//! Return the buffer offset just past the markup of the current event.
+	unsigned int getEndOffset() const { return mPosition; }
+	//! Return the message buffer being read.
+	const char* getBuffer() const { return mBuffer; }
+
+protected:
+	void readTag();
+	bool readText();
+	void readName(std::string& outName);
+	void skipSpaces();
+	bool skipPast(const char* inDelimiter);
+	void unescape(unsigned int inBegin, unsigned int inEnd, std::string& outValue) const;
+
+	const char*  mBuffer;        //!< Buffer read.
+	unsigned int mSize;          //!< Number of meaningful characters in buffer.
+	unsigned int mPosition;      //!< Current reading position.
+	unsigned int mStartOffset;   //!< Offset of the current event markup.
+	Event        mEvent;         //!< Last event read.
+	bool         mPendingEnd;    //!< True when an empty element end tag must be reported.
+	std::string  mName;          //!< Current tag name.
+	std::string  mText;          //!< Current text.
+	std::vector< std::pair<std::string,std::string> > mAttributes; //!< Attributes storage (reused).
+	unsigned int mNbAttributes;  //!< Number of valid attributes in storage.
+};
+
+}
+}
+
+#endif
@@ -52,6 +52,8 @@ MaxFctEvalOp::MaxFctEvalOp(UIntArray inEncoding, std::string inName) : Evaluatio
     GA::BitString::DecodingKey lKey(-200.0, 200.0, inEncoding[i]);
     mDecodingKeys.push_back(lKey);
   }
+  mBitStringCodec = new MPI::GA::BitStringCodec;
+  addCodec(mBitStringCodec);
 }
 
 
@@ -64,11 +66,15 @@ MaxFctEvalOp::MaxFctEvalOp(UIntArray inEncoding, std::string inName) : Evaluatio
 Fitness::Handle MaxFctEvalOp::evaluate(Individual& inIndividual, Context& ioContext)
 {
   Beagle_AssertM(inIndividual.size() == 1);
-  GA::BitString::Handle lBitString = castHandleT<GA::BitString>(inIndividual[0]);
 //  std::vector<double> lX;
 	Beagle::DoubleArray lX;
-//  lBitString->decodeGray(mDecodingKeys, lX);
-  lBitString->decode(mDecodingKeys, lX);
+  const MPI::GA::PackedBitString* lPacked = mBitStringCodec->getPackedBitString(inIndividual, 0);
+  if(lPacked != NULL) decodePacked(*lPacked, lX);
+  else {
+    GA::BitString::Handle lBitString = castHandleT<GA::BitString>(inIndividual[0]);
+//    lBitString->decodeGray(mDecodingKeys, lX);
+    lBitString->decode(mDecodingKeys, lX);
+  }
   double lU   = 10.0;
   double lSum = 0.0;
   for(unsigned int i=0; i<5; i++) {
@@ -79,3 +85,25 @@ Fitness::Handle MaxFctEvalOp::evaluate(Individual& inIndividual, Context& ioCont
   double lF = 161.8 / lSum;
   return new FitnessSimple(lF);
 }
+
+
+/*!
+ *  \brief Decode the variables from a bit string received packed, as GA::BitString::decode does.
+ *  \param inBitString Packed bit string.
+ *  \param outX Decoded variables.
+ */
+void MaxFctEvalOp::decodePacked(const MPI::GA::PackedBitString& inBitString, DoubleArray& outX) const
+{
+  outX.resize(mDecodingKeys.size());
+  unsigned int lPosition = 0;
+  for(unsigned int i=0; i<mDecodingKeys.size(); i++) {
+    const unsigned int lEncoding = mDecodingKeys[i].getEncoding();
+    if(lPosition+lEncoding > inBitString.mNbBits)
+      throw Beagle_RunTimeExceptionM("Bit string is shorter than the decoding keys");
+    const double lMaxValue = std::pow(2.0, double(lEncoding)) - 1.0;
+    const double lValue = double(inBitString.getBits(lPosition, lEncoding));
+    const double lRange = mDecodingKeys[i].getUpperBound() - mDecodingKeys[i].getLowerBound();
+    outX[i] = mDecodingKeys[i].getLowerBound() + (lValue / lMaxValue) * lRange;
+    lPosition += lEncoding;
+  }
+}
@@ -58,6 +58,7 @@
 #include <vector>
 #include "beagle/GA.hpp"
 #include "MPI_EvaluationOp.hpp"
+#include "MPI_GA_BitStringCodec.hpp"
 
 
 /*!
@@ -88,7 +89,10 @@ public:
                                            Beagle::Context& ioContext);
 
 protected:
+  void decodePacked(const Beagle::MPI::GA::PackedBitString& inBitString, Beagle::DoubleArray& outX) const;
+
   std::vector<Beagle::GA::BitString::DecodingKey> mDecodingKeys; //!< Decoding keys.
+  Beagle::MPI::GA::BitStringCodec::Handle mBitStringCodec;       //!< Codec of the received bit strings.
 
 };
 
@@ -37,6 +37,7 @@
 #include "SymbRegEvalOp.hpp"
 
 #include <cmath>
+#include <cfloat>
 
 using namespace Beagle;
 
@@ -50,7 +51,7 @@ SymbRegEvalOp::SymbRegEvalOp(std::string inName) :
 #else
 	MPI::GP::EvaluationOp(inName),
 #endif
-	mX(0), mY(0)
+	mX(0), mY(0), mXSlot(0)
 { }
 
 
@@ -63,20 +64,87 @@ SymbRegEvalOp::SymbRegEvalOp(std::string inName) :
 Fitness::Handle SymbRegEvalOp::evaluate(GP::Individual& inIndividual, GP::Context& ioContext)
 { 
 	double lSquareError = 0.0;
+#ifndef WITHOUT_MPI
+	if(runFitnessCases(inIndividual, ioContext, mResults)) {
+		for(unsigned int i=0; i<mX.size(); i++) {
+			double lError = mY[i]-mResults[i];
+			lSquareError += (lError*lError);
+		}
+		double lRMSE = sqrt(lSquareError / mX.size());
+		return new FitnessSimple(1.0 / (lRMSE + 1.0));
+	}
+	
+	//Squared error beyond which the fitness cannot reach the rejection bound
+	const double lBound = getRejectionBound();
+	const double lMaxRMSE = (lBound > 0.0) ? (1.0/lBound - 1.0) : -1.0;
+	const double lMaxSquareError = (lMaxRMSE >= 0.0) ? lMaxRMSE*lMaxRMSE*mX.size() : DBL_MAX;
+#endif
+	unsigned int lNbCases = mX.size();
 	for(unsigned int i=0; i<mX.size(); i++) {
+#ifdef WITHOUT_MPI
 		setValue("X", mX[i], ioContext);
+#else
+		setValue(mXSlot, mX[i]);
+#endif
 		Double lResult;
 		inIndividual.run(lResult, ioContext);
 		double lError = mY[i]-lResult;
 		lSquareError += (lError*lError);
+#ifndef WITHOUT_MPI
+		if(lSquareError > lMaxSquareError) {
+			rejectEvaluation(mX.size()-i-1);
+			lNbCases = i+1;
+			break;
+		}
+#endif
 	}
-	double lMSE  = lSquareError / mX.size();
+	//The error of a rejected individual is extrapolated over the skipped cases to keep their order
+	double lMSE  = lSquareError / lNbCases;
 	double lRMSE = sqrt(lMSE);
 	double lFitness = (1.0 / (lRMSE + 1.0));
 	return new FitnessSimple(lFitness);
 }
 
 
+#ifndef WITHOUT_MPI
+/*!
+ *  \brief Compute the squared error of the individual on the shard of this process.
+ *  \param inIndividual Individual to evaluate.
+ *  \param ioContext Evolutionary context.
+ *  \param outPartial Squared error on the fitness cases of the shard, summed over the group.
+ */
+void SymbRegEvalOp::evaluateShard(GP::Individual& inIndividual, GP::Context& ioContext, std::vector<double>& outPartial)
+{
+	unsigned int lBegin, lEnd;
+	getShardRange(mX.size(), lBegin, lEnd);
+	double lSquareError = 0.0;
+	for(unsigned int i=lBegin; i<lEnd; i++) {
+		setValue(mXSlot, mX[i]);
+		Double lResult;
+		inIndividual.run(lResult, ioContext);
+		double lError = mY[i]-lResult;
+		lSquareError += (lError*lError);
+	}
+	outPartial.assign(1, lSquareError);
+}
+
+
+/*!
+ *  \brief Compute the fitness from the squared error summed over every shard.
+ *  \param inIndividual Individual evaluated.
+ *  \param ioContext Evolutionary context.
+ *  \param inTotal Squared error on all the fitness cases.
+ *  \return Handle to the fitness measure,
+ */
+Fitness::Handle SymbRegEvalOp::combineShards(GP::Individual& inIndividual, GP::Context& ioContext,
+											 const std::vector<double>& inTotal)
+{
+	double lRMSE = sqrt(inTotal[0] / mX.size());
+	return new FitnessSimple(1.0 / (lRMSE + 1.0));
+}
+#endif
+
+
 /*!
  * \brief Post-initialize the operator by sampling the function to regress.
  * \param ioSystem System to use to sample.
@@ -97,4 +165,10 @@ void SymbRegEvalOp::postInit(System& ioSystem)
 		mX.push_back(i);
 		mY.push_back(mX[i]*(mX[i]*(mX[i]*(mX[i]+1.0)+1.0)+1.0));
 	}
+#ifndef WITHOUT_MPI
+	mXSlot = bindValue("X", ioSystem);
+	std::vector<double> lX(mX.size());
+	for(unsigned int i=0; i<mX.size(); i++) lX[i] = mX[i];
+	setFitnessCases("X", lX);
+#endif
 }
@@ -117,10 +117,18 @@ public:
   virtual Beagle::Fitness::Handle evaluate(Beagle::GP::Individual& inIndividual,
                                            Beagle::GP::Context& ioContext);
   virtual void postInit(Beagle::System& ioSystem);
+#ifndef WITHOUT_MPI
+  virtual void evaluateShard(Beagle::GP::Individual& inIndividual, Beagle::GP::Context& ioContext,
+                             std::vector<double>& outPartial);
+  virtual Beagle::Fitness::Handle combineShards(Beagle::GP::Individual& inIndividual, Beagle::GP::Context& ioContext,
+                                                const std::vector<double>& inTotal);
+#endif
   
 protected:
   std::vector<Beagle::Double> mX;
   std::vector<Beagle::Double> mY;
+  std::vector<double> mResults;   //!< Results of an individual over all the fitness cases.
+  unsigned int mXSlot;            //!< Slot of the X token.
 
 };
 
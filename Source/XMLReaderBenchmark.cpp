@@ -0,0 +1,145 @@
+/*
+ *  XMLReaderBenchmark.cpp
+ *  Copyright 2010 Jean-Francois Dupuis.
+ *
+ *  This file is part of MPIBeagle.
+ *
+ *  MPIBeagle is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MPIBeagle is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MPIBeagle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ *  \file   XMLReaderBenchmark.cpp
+ *  \brief  Compare the DOM and streaming decoding of the messages exchanged with the evaluators.
+ *
+ *  A GP individual of the given depth is serialized as it would be sent to an
+ *  evaluator, then decoded repeatedly with PACC::XML::Document and with the
+ *  MPI::XMLStreamDecoder. Both results must serialize to the same string, and
+ *  their trees must hold nodes of the same classes with the same sub-tree sizes.
+ *  Usage: XMLReaderBenchmark [depth] [repetitions]
+ */
+
+#include "beagle/GP.hpp"
+#include "GPBenchmarkTree.hpp"
+#include "MPI_XMLStreamDecoder.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <XML.hpp>
+#include <Util/Timer.hpp>
+
+using namespace std;
+using namespace Beagle;
+
+/*!
+ *  \brief Return true if two trees hold nodes of the same classes, names, arities and sub-tree sizes.
+ */
+static bool isSameTree(const GP::Tree& inLeft, const GP::Tree& inRight)
+{
+	if(inLeft.size() != inRight.size()) return false;
+	if(inLeft.getNumberArguments() != inRight.getNumberArguments()) return false;
+	for(unsigned int i = 0; i < inLeft.size(); ++i) {
+		const GP::Primitive& lLeft = *inLeft[i].mPrimitive;
+		const GP::Primitive& lRight = *inRight[i].mPrimitive;
+		if(typeid(lLeft) != typeid(lRight)) return false;
+		if(lLeft.getName() != lRight.getName()) return false;
+		if(lLeft.getNumberArguments() != lRight.getNumberArguments()) return false;
+		if(inLeft[i].mSubTreeSize != inRight[i].mSubTreeSize) return false;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	try {
+		const unsigned int lDepth = (argc > 1) ? std::atoi(argv[1]) : 14;
+		const unsigned int lRepetitions = (argc > 2) ? std::atoi(argv[2]) : 20;
+
+		GP::PrimitiveSet::Handle lSet = new GP::PrimitiveSet;
+		lSet->insert(new GP::Add);
+		lSet->insert(new GP::Subtract);
+		lSet->insert(new GP::Multiply);
+		lSet->insert(new GP::Divide);
+		lSet->insert(new GP::TokenT<Double>("X"));
+		lSet->insert(new GP::EphemeralDouble);
+		GP::System::Handle lSystem = new GP::System(lSet);
+		int lArgc = 1;
+		lSystem->initialize(lArgc, argv);
+		lSystem->postInit();
+
+		GP::Context::Handle lContext = new GP::Context;
+		lContext->setSystemHandle(lSystem);
+
+		//Build and serialize the individual
+		GP::Individual::Handle lOriginal = new GP::Individual(new GP::Tree::Alloc, new FitnessSimple::Alloc, 1);
+		buildTree(*(*lOriginal)[0], *lSet, *lContext, lDepth);
+		lOriginal->setFitness(new FitnessSimple(0.5f));
+		std::ostringstream lStreamOut;
+		PACC::XML::Streamer lXMLStream(lStreamOut);
+		lOriginal->write(lXMLStream);
+		const std::string lMessage = lStreamOut.str();
+		const std::string lReference = lOriginal->serialize();
+
+		cout << "Individual of " << (*lOriginal)[0]->size() << " nodes, message of ";
+		cout << lMessage.size() << " bytes, " << lRepetitions << " repetitions" << endl;
+
+		//DOM decoding
+		GP::Individual::Handle lDOMIndividual = new GP::Individual(new GP::Tree::Alloc, new FitnessSimple::Alloc);
+		PACC::Timer lTimer;
+		for(unsigned int i = 0; i < lRepetitions; ++i) {
+			std::istringstream lStreamIn(lMessage);
+			PACC::XML::Document lXMLParser;
+			lXMLParser.parse(lStreamIn);
+			lDOMIndividual->readWithContext(lXMLParser.getFirstRoot(), *lContext);
+		}
+		const double lDOMTime = lTimer.getValue();
+
+		//Streaming decoding
+		GP::Individual::Handle lStreamIndividual = new GP::Individual(new GP::Tree::Alloc, new FitnessSimple::Alloc);
+		MPI::XMLStreamDecoder lDecoder;
+		lTimer.reset();
+		for(unsigned int i = 0; i < lRepetitions; ++i) {
+			lDecoder.readIndividual(lMessage.c_str(), lMessage.size()+1, *lStreamIndividual, *lContext);
+		}
+		const double lStreamTime = lTimer.getValue();
+
+		cout << "DOM decoding:       " << (lDOMTime/lRepetitions)*1000. << " ms per individual" << endl;
+		cout << "Streaming decoding: " << (lStreamTime/lRepetitions)*1000. << " ms per individual" << endl;
+		if(lStreamTime > 0.) cout << "Speedup: " << lDOMTime/lStreamTime << endl;
+
+		if((lDOMIndividual->serialize() != lReference) || (lStreamIndividual->serialize() != lReference)) {
+			cerr << "Decoded individuals differ from the original!" << endl;
+			return 1;
+		}
+		if(!isSameTree(*(*lDOMIndividual)[0], *(*lStreamIndividual)[0])) {
+			cerr << "The DOM and streaming decoders give different trees!" << endl;
+			return 1;
+		}
+		cout << "Decoded individuals are identical." << endl;
+	}
+	catch(Exception& inException) {
+		inException.terminate();
+	}
+	catch(exception& inException) {
+		cerr << "Standard exception catched:" << endl;
+		cerr << inException.what() << endl << flush;
+		return 1;
+	}
+	catch(...) {
+		cerr << "Unknown exception catched!" << endl << flush;
+		return 1;
+	}
+	return 0;
+}